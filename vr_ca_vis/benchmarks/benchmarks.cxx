@@ -0,0 +1,67 @@
+#include <cstring>
+#include <functional>
+#include <iostream>
+
+#include "benchmarks.h"
+
+struct benchmark
+{
+	const char* name;
+	// name of the command line argument that follows the benchmark name or NULL
+	const char* argument;
+	std::function<void(const char* argument)> run;
+};
+
+static const benchmark benchmarks[] = {
+	{ "node_scanner", NULL, [](const char*) { benchmark_node_scanner(); } },
+	{ "logger_parser", NULL, [](const char*) { benchmark_logger_parser(); } },
+	{ "logger_cache", NULL, [](const char*) { benchmark_logger_cache(); } },
+	{ "cae_compression", NULL, [](const char*) { benchmark_cae_compression(); } },
+	{ "cae_attribute_columns", NULL, [](const char*) { benchmark_cae_attribute_columns(); } },
+	{ "cae_conversion", NULL, [](const char*) { benchmark_cae_conversion(); } },
+	{ "cae_writer", NULL, [](const char*) { benchmark_cae_writer(); } },
+	{ "snapshot_loader", "snapshot directory", [](const char* dir_name) { benchmark_snapshot_loader(dir_name); } }
+};
+
+int main(int argc, char** argv)
+{
+	if (argc < 2) {
+		std::cout << "usage: " << argv[0] << " all | <benchmark> ..." << std::endl << "benchmarks:";
+		for (const benchmark& b : benchmarks) {
+			std::cout << " " << b.name;
+			if (b.argument)
+				std::cout << " <" << b.argument << ">";
+		}
+		std::cout << std::endl << "all runs the benchmarks without arguments" << std::endl;
+		return 1;
+	}
+
+	int result = 0;
+	for (int ai = 1; ai < argc; ++ai) {
+		if (strcmp(argv[ai], "all") == 0) {
+			for (const benchmark& b : benchmarks)
+				if (!b.argument)
+					b.run(NULL);
+			continue;
+		}
+
+		const benchmark* found = NULL;
+		for (const benchmark& b : benchmarks)
+			if (strcmp(argv[ai], b.name) == 0)
+				found = &b;
+
+		if (!found) {
+			std::cerr << "unknown benchmark " << argv[ai] << std::endl;
+			result = 1;
+		}
+		else if (!found->argument)
+			found->run(NULL);
+		else if (ai + 1 < argc)
+			found->run(argv[++ai]);
+		else {
+			std::cerr << "benchmark " << found->name << " needs a " << found->argument << std::endl;
+			result = 1;
+		}
+	}
+	return result;
+}
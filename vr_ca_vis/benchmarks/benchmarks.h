@@ -0,0 +1,45 @@
+// Benchmarks of the parsers, caches and cae file I/O of vr_ca_vis on synthetic data
+//
+// Every benchmark generates its input, prints its measurements to std::cout and removes the files it wrote, except
+// for the snapshot loader benchmark, which loads the snapshots of a directory.
+//
+// Usage:
+// vr_ca_vis_benchmarks node_scanner cae_writer ...
+// vr_ca_vis_benchmarks snapshot_loader <snapshot directory>
+// vr_ca_vis_benchmarks all
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/// compare the string splitting scanner of the former DOM based parser with the scalar and the vectorized scanner
+/// on a synthetic node list and print the throughput of each
+void benchmark_node_scanner(size_t nr_nodes = 1 << 20, unsigned nr_repetitions = 5);
+
+/// write a synthetic logger file with nr_rows rows to file_name and compare the former parser that splits the
+/// whole file into lines and tokens with reading row by row and with reading columns in parallel
+void benchmark_logger_parser(const std::string& file_name = "logger_benchmark.csv", size_t nr_rows = 800000, unsigned nr_repetitions = 3);
+
+/// compare parsing 3 of 40 columns of a generated logger with reading them from the cache
+void benchmark_logger_cache(const std::string& file_name = "logger_cache_benchmark.csv", size_t nr_rows = size_t(1) << 20, unsigned nr_repetitions = 3);
+
+/// compare file size and random and sequential time step access of raw, compressed and delta encoded files with
+/// synthetic lattice frames
+void benchmark_cae_compression(const std::string& file_name = "cae_compression_benchmark", size_t nr_nodes = size_t(1) << 18, uint32_t nr_frames = 64);
+
+/// compare reading all attributes and a single one of frames with synthetic cell attributes stored entry by entry
+/// and as attribute columns
+void benchmark_cae_attribute_columns(const std::string& file_name = "cae_attribute_columns_benchmark", size_t nr_cells = size_t(1) << 18,
+	uint32_t nr_attributes = 8, uint32_t nr_frames = 16);
+
+/// compare throughput and results of the scalar templates and the dispatched kernels for the common pairs
+void benchmark_cae_conversion(size_t nr_values = size_t(1) << 24, unsigned nr_repetitions = 5);
+
+/// compare frames per second of append_time_step of binary_file with the writer for synthetic lattice frames
+void benchmark_cae_writer(const std::string& file_name = "cae_writer_benchmark", size_t nr_nodes = size_t(1) << 20, uint32_t nr_frames = 32);
+
+/// load the snapshots in dir_name with 1, 2, 4, ... up to max_nr_threads threads (0 for one per core) and print the
+/// wall time of each relative to loading them with a single thread
+void benchmark_snapshot_loader(const std::string& dir_name, unsigned max_nr_threads = 0);
@@ -0,0 +1,467 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmarks.h"
+#include "../cae_convert.h"
+#include "../cae_file_format.h"
+#include "../cae_writer.h"
+#include "../positional_file.h"
+
+using namespace cae;
+
+void benchmark_cae_compression(const std::string& file_name, size_t nr_nodes, uint32_t nr_frames)
+{
+	typedef cgv::math::fvec<uint16_t, 3> node_type;
+
+	// lattice nodes grouped into cubic cells, a few nodes per frame switch to a neighboring cell as in a potts model
+	uint32_t extent = 1;
+	while (size_t(extent) * extent * extent < nr_nodes)
+		++extent;
+	const uint32_t cell_size = 8;
+	uint32_t nr_cells_per_axis = (extent + cell_size - 1) / cell_size;
+
+	std::vector<node_type> points(nr_nodes);
+	std::vector<uint32_t> group_indices(nr_nodes);
+	std::vector<float> attr_values(nr_nodes);
+	auto generate_frame = [&](uint32_t ti) {
+		std::mt19937 generator(ti);
+		std::uniform_int_distribution<int> switch_cell(0, 49);
+		for (size_t i = 0; i < nr_nodes; ++i) {
+			uint32_t x = uint32_t(i % extent), y = uint32_t(i / extent % extent), z = uint32_t(i / extent / extent);
+			points[i] = node_type(uint16_t(x), uint16_t(y), uint16_t(z));
+			uint32_t cx = x / cell_size, cy = y / cell_size, cz = z / cell_size;
+			if (switch_cell(generator) == 0 && cx + 1 < nr_cells_per_axis)
+				++cx;
+			group_indices[i] = (cz * nr_cells_per_axis + cy) * nr_cells_per_axis + cx;
+			attr_values[i] = float(group_indices[i] % 7);
+		}
+	};
+
+	struct result
+	{
+		uint64_t file_size = 0;
+		double write_seconds = 0.0;
+		double seek_seconds = 0.0;
+		double play_seconds = 0.0;
+		double checksum = 0.0;
+	};
+
+	auto run = [&](const std::string& name, int flags) {
+		result r;
+		std::string caf_name = name + ".caf";
+		std::remove(caf_name.c_str());
+
+		binary_file writer;
+		writer.format.flags = FF_FRAME_BASED | FF_SEPARATE_FRAME_FILE | flags;
+		writer.format.point_coord_type = CT_UINT16;
+		writer.format.group_index_type = CT_UINT32;
+		writer.format.attribute_type = CT_FLT32;
+		writer.nr_attributes = 1;
+		writer.attr_names.push_back("cell_type");
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t ti = 0; ti < nr_frames; ++ti) {
+			generate_frame(ti);
+			if (!writer.append_time_step(name, float(ti), points, group_indices, attr_values, false))
+				return r;
+		}
+		if (!writer.write_header(name + ".cae"))
+			return r;
+		auto stop = std::chrono::high_resolution_clock::now();
+		r.write_seconds = std::chrono::duration<double>(stop - start).count();
+
+		positional_file caf;
+		if (caf.open(caf_name))
+			r.file_size = caf.get_size();
+		caf.close();
+
+		// seek to random frames of a freshly opened file
+		binary_file reader;
+		if (!reader.read_header(name + ".cae"))
+			return r;
+
+		std::mt19937 generator(1);
+		std::uniform_int_distribution<uint32_t> frame_index(0, nr_frames - 1);
+		const unsigned nr_seeks = 32;
+		std::vector<cgv::math::fvec<float, 3> > frame_points;
+		std::vector<uint32_t> frame_groups;
+		std::vector<float> frame_attrs;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned s = 0; s < nr_seeks; ++s) {
+			uint32_t ti = frame_index(generator);
+			if (!reader.read_time_step(name, ti, frame_points, frame_groups, frame_attrs))
+				return r;
+			r.checksum += frame_points.back()[2] + frame_groups.back() + frame_attrs.back();
+		}
+		stop = std::chrono::high_resolution_clock::now();
+		r.seek_seconds = std::chrono::duration<double>(stop - start).count() / nr_seeks;
+
+		// play all frames in order, delta encoded frames continue from the previous one
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t ti = 0; ti < nr_frames; ++ti) {
+			if (!reader.read_time_step(name, ti, frame_points, frame_groups, frame_attrs))
+				return r;
+			r.checksum += frame_points.back()[2] + frame_groups.back() + frame_attrs.back();
+		}
+		stop = std::chrono::high_resolution_clock::now();
+		r.play_seconds = std::chrono::duration<double>(stop - start).count() / nr_frames;
+		reader.close_frame_file();
+		return r;
+	};
+
+	struct variant
+	{
+		const char* name;
+		const char* suffix;
+		int flags;
+	};
+	const variant variants[] = {
+		{ "v1.0 raw:               ", "_v1_0", FF_NONE },
+		{ "v1.1 compressed:        ", "_v1_1", FF_COMPRESSED },
+		{ "v1.2 deltas:            ", "_v1_2", FF_TEMPORAL_DELTAS },
+		{ "v1.2 compressed deltas: ", "_v1_2c", FF_COMPRESSED | FF_TEMPORAL_DELTAS }
+	};
+
+	std::cout << "cae compression benchmark with " << nr_frames << " frames of " << nr_nodes << " nodes" << std::endl;
+
+	result raw;
+	for (const variant& v : variants) {
+		std::string name = file_name + v.suffix;
+		result r = run(name, v.flags);
+		if (v.flags == FF_NONE)
+			raw = r;
+
+		std::cout << "  " << v.name << r.file_size / 1048576.0 << " MB";
+		if (r.file_size > 0)
+			std::cout << " (ratio " << double(raw.file_size) / r.file_size << ")";
+		std::cout << ", write " << r.write_seconds << " s, seek to frame " << 1000.0 * r.seek_seconds
+			<< " ms, play " << 1000.0 * r.play_seconds << " ms per frame" << std::endl;
+		if (r.checksum != raw.checksum)
+			std::cout << "  frames differ" << std::endl;
+
+		std::remove((name + ".cae").c_str());
+		std::remove((name + ".caf").c_str());
+	}
+}
+void benchmark_cae_attribute_columns(const std::string& file_name, size_t nr_cells, uint32_t nr_attributes, uint32_t nr_frames)
+{
+	// cells with a center, an id and properties that change slowly over time
+	std::vector<cgv::math::fvec<float, 3> > points(nr_cells);
+	std::vector<uint32_t> group_indices(nr_cells);
+	std::vector<float> attr_values(nr_cells * nr_attributes);
+	auto generate_frame = [&](uint32_t ti) {
+		std::mt19937 generator(ti);
+		std::uniform_real_distribution<float> value(0.0f, 1.0f);
+		for (size_t i = 0; i < nr_cells; ++i) {
+			float offset = value(generator);
+			points[i] = cgv::math::fvec<float, 3>(float(i % 64) + offset, float(i / 64 % 64) + offset, float(i / 4096) + offset);
+			group_indices[i] = uint32_t(i);
+			for (uint32_t ai = 0; ai < nr_attributes; ++ai)
+				attr_values[i * nr_attributes + ai] = float(ai) + float(ti) * 0.01f + value(generator);
+		}
+	};
+
+	struct result
+	{
+		uint64_t file_size = 0;
+		double all_seconds = 0.0;
+		double one_seconds = 0.0;
+		double checksum = 0.0;
+	};
+
+	// the color-by attribute is the last one, which is farthest from the start of an entry
+	const std::vector<uint32_t> color_attribute(1, nr_attributes - 1);
+
+	auto run = [&](const std::string& name, int flags, uint32_t extended_flags) {
+		result r;
+		std::string caf_name = name + ".caf";
+		std::remove(caf_name.c_str());
+
+		binary_file writer;
+		writer.format.flags = FF_FRAME_BASED | FF_SEPARATE_FRAME_FILE | flags;
+		writer.extended_flags = extended_flags;
+		writer.format.point_coord_type = CT_FLT32;
+		writer.format.group_index_type = CT_UINT32;
+		writer.format.attribute_type = CT_FLT32;
+		writer.nr_attributes = nr_attributes;
+		for (uint32_t ai = 0; ai < nr_attributes; ++ai)
+			writer.attr_names.push_back("property_" + std::to_string(ai));
+
+		for (uint32_t ti = 0; ti < nr_frames; ++ti) {
+			generate_frame(ti);
+			if (!writer.append_time_step(name, float(ti), points, group_indices, attr_values, false))
+				return r;
+		}
+		if (!writer.write_header(name + ".cae"))
+			return r;
+
+		positional_file caf;
+		if (caf.open(caf_name))
+			r.file_size = caf.get_size();
+		caf.close();
+
+		binary_file reader;
+		if (!reader.read_header(name + ".cae"))
+			return r;
+
+		std::vector<cgv::math::fvec<float, 3> > frame_points;
+		std::vector<uint32_t> frame_groups;
+		std::vector<float> frame_attrs;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t ti = 0; ti < nr_frames; ++ti) {
+			if (!reader.read_time_step(name, ti, frame_points, frame_groups, frame_attrs))
+				return r;
+			r.checksum += frame_attrs.back();
+		}
+		auto stop = std::chrono::high_resolution_clock::now();
+		r.all_seconds = std::chrono::duration<double>(stop - start).count() / nr_frames;
+
+		// switching the color-by attribute only needs this attribute of every frame
+		start = std::chrono::high_resolution_clock::now();
+		for (uint32_t ti = 0; ti < nr_frames; ++ti) {
+			if (!reader.read_time_step(name, ti, frame_points, frame_groups, frame_attrs, color_attribute))
+				return r;
+			r.checksum += frame_attrs.back();
+		}
+		stop = std::chrono::high_resolution_clock::now();
+		r.one_seconds = std::chrono::duration<double>(stop - start).count() / nr_frames;
+		reader.close_frame_file();
+		return r;
+	};
+
+	struct variant
+	{
+		const char* name;
+		const char* suffix;
+		int flags;
+		uint32_t extended_flags;
+	};
+	const variant variants[] = {
+		{ "entries:                ", "_entries", FF_NONE, EF_NONE },
+		{ "columns:                ", "_columns", FF_NONE, EF_ATTRIBUTE_COLUMNS },
+		{ "compressed entries:     ", "_entries_c", FF_COMPRESSED, EF_NONE },
+		{ "compressed columns:     ", "_columns_c", FF_COMPRESSED, EF_ATTRIBUTE_COLUMNS }
+	};
+
+	std::cout << "cae attribute columns benchmark with " << nr_frames << " frames of " << nr_cells << " cells with "
+		<< nr_attributes << " attributes" << std::endl;
+
+	double checksum = 0.0;
+	for (const variant& v : variants) {
+		std::string name = file_name + v.suffix;
+		result r = run(name, v.flags, v.extended_flags);
+		if (v.flags == FF_NONE && v.extended_flags == EF_NONE)
+			checksum = r.checksum;
+
+		std::cout << "  " << v.name << r.file_size / 1048576.0 << " MB, read all attributes " << 1000.0 * r.all_seconds
+			<< " ms, read one attribute " << 1000.0 * r.one_seconds << " ms per frame" << std::endl;
+		if (r.checksum != checksum)
+			std::cout << "  frames differ" << std::endl;
+
+		std::remove((name + ".cae").c_str());
+		std::remove((name + ".caf").c_str());
+	}
+}
+void benchmark_cae_conversion(size_t nr_values, unsigned nr_repetitions)
+{
+	std::mt19937 generator(0);
+	std::vector<uint8_t> uint8_values(nr_values);
+	std::vector<uint16_t> uint16_values(nr_values);
+	std::vector<int32_t> int32_values(nr_values);
+	std::vector<float> float_values(nr_values);
+	std::uniform_real_distribution<float> float_distribution(-0.99f, 65535.99f);
+	for (size_t i = 0; i < nr_values; ++i) {
+		uint32_t bits = uint32_t(generator());
+		uint8_values[i] = uint8_t(bits);
+		uint16_values[i] = uint16_t(bits);
+		int32_values[i] = int32_t(bits);
+		float_values[i] = float_distribution(generator);
+	}
+	// three attributes with ranges, the floats are inside the ranges
+	range_vector ranges = { cgv::math::fvec<float, 2>(0.0f, 1.0f), cgv::math::fvec<float, 2>(-2.5f, 7.0f), cgv::math::fvec<float, 2>(10.0f, 65545.0f) };
+	std::vector<float> ranged_float_values(nr_values);
+	for (size_t i = 0; i < nr_values; ++i) {
+		const auto& r = ranges[i % ranges.size()];
+		ranged_float_values[i] = r[0] + (r[1] - r[0]) * (float_values[i] + 0.99f) / 65537.0f;
+	}
+
+	std::vector<uint8_t> scalar_result(nr_values * sizeof(float));
+	std::vector<uint8_t> kernel_result(nr_values * sizeof(float));
+
+	auto measure = [&](const std::function<void()>& convert) {
+		double best_seconds = std::numeric_limits<double>::max();
+		for (unsigned r = 0; r < nr_repetitions; ++r) {
+			auto start = std::chrono::high_resolution_clock::now();
+			convert();
+			auto stop = std::chrono::high_resolution_clock::now();
+			best_seconds = std::min(best_seconds, std::chrono::duration<double>(stop - start).count());
+		}
+		return best_seconds;
+	};
+	auto run = [&](const char* name, size_t result_size, const std::function<void(void*)>& scalar, const std::function<void(void*)>& kernel) {
+		double scalar_seconds = measure([&]() { scalar(scalar_result.data()); });
+		double kernel_seconds = measure([&]() { kernel(kernel_result.data()); });
+		bool equal = memcmp(scalar_result.data(), kernel_result.data(), nr_values * result_size) == 0;
+		std::cout << "  " << name << ": scalar " << 1e-6 * nr_values / scalar_seconds << " M/s, dispatched "
+			<< 1e-6 * nr_values / kernel_seconds << " M/s" << (equal ? "" : ", results differ") << std::endl;
+	};
+
+#if defined(CAE_CONVERT_AVX2)
+	const char* instruction_set = "AVX2";
+#elif defined(CAE_CONVERT_SSE2)
+	const char* instruction_set = "SSE2";
+#else
+	const char* instruction_set = "scalar";
+#endif
+	std::cout << "conversion benchmark with " << nr_values << " values (" << instruction_set << ")" << std::endl;
+
+	// explicit template arguments select the scalar templates instead of the kernels
+	run("uint8 to float", sizeof(float),
+		[&](void* dst) { convert_coordinate_vector<uint8_t, float>(uint8_values.data(), static_cast<float*>(dst), nr_values); },
+		[&](void* dst) { coordinate_converter::get_convert_function(CT_UINT8, CT_FLT32)(uint8_values.data(), dst, nr_values); });
+	run("uint16 to float", sizeof(float),
+		[&](void* dst) { convert_coordinate_vector<uint16_t, float>(uint16_values.data(), static_cast<float*>(dst), nr_values); },
+		[&](void* dst) { coordinate_converter::get_convert_function(CT_UINT16, CT_FLT32)(uint16_values.data(), dst, nr_values); });
+	run("int32 to float", sizeof(float),
+		[&](void* dst) { convert_coordinate_vector<int32_t, float>(int32_values.data(), static_cast<float*>(dst), nr_values); },
+		[&](void* dst) { coordinate_converter::get_convert_function(CT_INT32, CT_FLT32)(int32_values.data(), dst, nr_values); });
+	run("float to uint16", sizeof(uint16_t),
+		[&](void* dst) { convert_coordinate_vector<float, uint16_t>(float_values.data(), static_cast<uint16_t*>(dst), nr_values); },
+		[&](void* dst) { coordinate_converter::get_convert_function(CT_FLT32, CT_UINT16)(float_values.data(), dst, nr_values); });
+	run("uint8 ranges to float", sizeof(float),
+		[&](void* dst) { convert_from_coordinate_vector<uint8_t>(uint8_values.data(), 0, 255, static_cast<float*>(dst), ranges, nr_values); },
+		[&](void* dst) { coordinate_converter::get_convert_from_ranges_function(CT_UINT8)(uint8_values.data(), static_cast<float*>(dst), ranges, nr_values); });
+	run("uint16 ranges to float", sizeof(float),
+		[&](void* dst) { convert_from_coordinate_vector<uint16_t>(uint16_values.data(), 0, 65535, static_cast<float*>(dst), ranges, nr_values); },
+		[&](void* dst) { coordinate_converter::get_convert_from_ranges_function(CT_UINT16)(uint16_values.data(), static_cast<float*>(dst), ranges, nr_values); });
+	run("float ranges to uint16", sizeof(uint16_t),
+		[&](void* dst) { convert_to_coordinate_vector<uint16_t>(static_cast<uint16_t*>(dst), 0, 65535, ranged_float_values.data(), ranges, nr_values); },
+		[&](void* dst) { coordinate_converter::get_convert_to_ranges_function(CT_UINT16)(ranged_float_values.data(), dst, ranges, nr_values); });
+}
+void benchmark_cae_writer(const std::string& file_name, size_t nr_nodes, uint32_t nr_frames)
+{
+	typedef cgv::math::fvec<float, 3> point_type;
+
+	// frames are produced on the calling thread like by a simulation that moves nodes between cells
+	std::vector<point_type> points(nr_nodes);
+	std::vector<uint32_t> group_indices(nr_nodes);
+	std::vector<float> attr_values(2 * nr_nodes);
+	uint32_t extent = 1;
+	while (size_t(extent) * extent * extent < nr_nodes)
+		++extent;
+	auto produce_frame = [&](uint32_t ti) {
+		std::mt19937 generator(ti);
+		std::uniform_int_distribution<int> switch_cell(0, 49);
+		for (size_t i = 0; i < nr_nodes; ++i) {
+			uint32_t x = uint32_t(i % extent), y = uint32_t(i / extent % extent), z = uint32_t(i / extent / extent);
+			points[i] = point_type(float(x), float(y), float(z));
+			group_indices[i] = (z / 8 * 64 + y / 8) * 64 + x / 8 + (switch_cell(generator) == 0 ? 1 : 0);
+			attr_values[2 * i] = float(group_indices[i] % 7);
+			attr_values[2 * i + 1] = float(ti);
+		}
+	};
+
+	auto setup = [](binary_file& file) {
+		file.format.flags = FF_FRAME_BASED | FF_SEPARATE_FRAME_FILE | FF_COORDINATE_INTERVALS | FF_ATTRIBUTE_RANGES;
+		file.format.point_coord_type = CT_UINT16;
+		file.format.group_index_type = CT_UINT32;
+		file.format.attribute_type = CT_FLT32;
+		file.nr_attributes = 2;
+		file.attr_names = { "type", "time" };
+	};
+
+	auto report = [&](const char* name, double produce_seconds, double seconds) {
+		double frame_size = double(nr_nodes) * (3 * sizeof(uint16_t) + sizeof(uint32_t) + 2 * sizeof(float));
+		std::cout << "  " << name << nr_frames / seconds << " fps, " << nr_frames * frame_size / seconds / (1024 * 1024)
+			<< " MB/s, producing frames took " << produce_seconds << " of " << seconds << " s" << std::endl;
+	};
+
+	// the frame files of the runs are large, so they are removed after every run including failed ones
+	auto remove_files = [](const std::string& name) {
+		std::remove((name + ".cae").c_str());
+		std::remove((name + ".caf").c_str());
+	};
+
+	// append_time_step of binary_file reopens the frame file for every frame
+	auto run_append = [&](const std::string& name) {
+		binary_file file;
+		setup(file);
+
+		double produce_seconds = 0.0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (uint32_t ti = 0; ti < nr_frames; ++ti) {
+			auto produce_start = std::chrono::high_resolution_clock::now();
+			produce_frame(ti);
+			produce_seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - produce_start).count();
+			if (!file.append_time_step(name, float(ti), points, group_indices, attr_values)) {
+				std::cerr << "couldn't append time step to " << name << std::endl;
+				return false;
+			}
+		}
+		if (!file.write_header(name + ".cae")) {
+			std::cerr << "couldn't write " << name << std::endl;
+			return false;
+		}
+		report("append_time_step:          ", produce_seconds,
+			std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+		return true;
+	};
+
+	// the writer converts and writes a frame while the next one is produced if it has a worker thread
+	auto run_writer = [&](const std::string& name, bool background) {
+		binary_writer writer;
+		setup(writer);
+		writer.write_in_background = background;
+
+		double produce_seconds = 0.0;
+		auto start = std::chrono::high_resolution_clock::now();
+		if (!writer.open(name)) {
+			std::cerr << "couldn't open " << name << std::endl;
+			return false;
+		}
+		for (uint32_t ti = 0; ti < nr_frames; ++ti) {
+			auto produce_start = std::chrono::high_resolution_clock::now();
+			produce_frame(ti);
+			produce_seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - produce_start).count();
+			if (!writer.append_time_step(float(ti), points, group_indices, attr_values)) {
+				std::cerr << "couldn't append time step to " << name << std::endl;
+				writer.close();
+				return false;
+			}
+		}
+		if (!writer.close()) {
+			std::cerr << "couldn't write " << name << std::endl;
+			return false;
+		}
+		report(background ? "binary_writer with worker: " : "binary_writer:             ", produce_seconds,
+			std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+		return true;
+	};
+
+	std::cout << "cae writer benchmark with " << nr_frames << " frames of " << nr_nodes << " nodes" << std::endl;
+
+	std::string name = file_name + "_append";
+	remove_files(name);
+	bool success = run_append(name);
+	remove_files(name);
+	if (!success)
+		return;
+
+	name = file_name + "_writer";
+	for (bool background : { false, true }) {
+		remove_files(name);
+		success = run_writer(name, background);
+		remove_files(name);
+		if (!success)
+			return;
+	}
+}
@@ -0,0 +1,221 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmarks.h"
+#include "../logger_cache.h"
+#include "../logger_parser.h"
+
+void benchmark_logger_parser(const std::string& file_name, size_t nr_rows, unsigned nr_repetitions)
+{
+	const int nr_properties = 8;
+	{
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<double> coordinate(0.0, 100.0);
+
+		std::ofstream os(file_name);
+		os << "\"time\"\t\"cell.id\"\t\"l.x\"\t\"l.y\"\t\"l.z\"";
+		for (int p = 0; p < nr_properties; ++p)
+			os << "\t\"p" << p << "\"";
+		os << "\n";
+
+		for (size_t r = 0; r < nr_rows; ++r) {
+			os << r / 1000 << "\t" << r % 1000 << "\t" << coordinate(generator) << "\t" << coordinate(generator) << "\t" << coordinate(generator);
+			for (int p = 0; p < nr_properties; ++p)
+				os << "\t" << coordinate(generator);
+			os << "\n";
+		}
+	}
+
+	std::vector<std::string> headers = { "time", "cell.id", "l.x", "l.y", "l.z", "p7" };
+	double megabytes = 0.0;
+	{
+		mapped_file f;
+		if (f.open(file_name))
+			megabytes = f.get_size() / (1024.0 * 1024.0);
+	}
+
+	std::cout << "logger parser benchmark with " << nr_rows << " rows (" << megabytes << " MB)" << std::endl;
+
+	auto run = [&](const char* name, const std::function<double()>& scan) {
+		double best_seconds = std::numeric_limits<double>::max();
+		double checksum = 0.0;
+
+		for (unsigned r = 0; r < nr_repetitions; ++r) {
+			auto start = std::chrono::high_resolution_clock::now();
+			checksum = scan();
+			auto stop = std::chrono::high_resolution_clock::now();
+
+			best_seconds = std::min(best_seconds, std::chrono::duration<double>(stop - start).count());
+		}
+
+		std::cout << "  " << name << ": " << megabytes / best_seconds << " MB/s (" << 1e9 * best_seconds / nr_rows
+			<< " ns per row, checksum " << checksum << ")" << std::endl;
+	};
+
+	run("split to lines and tokens", [&]() {
+		// the former parser read the whole file and split every row into a new vector of tokens
+		std::string content;
+		cgv::utils::file::read(file_name, content, true);
+
+		std::vector<cgv::utils::line> lines;
+		cgv::utils::split_to_lines(content, lines);
+
+		std::vector<cgv::utils::token> header_tokens;
+		cgv::utils::split_to_tokens(lines.begin()->begin, lines.begin()->end, header_tokens, "");
+
+		std::vector<int> orders;
+		for (const auto& name : headers)
+			for (size_t i = 0; i < header_tokens.size(); ++i) {
+				cgv::utils::token token = header_tokens[i];
+				if (*token.begin == '"')
+					++token.begin;
+				if (token.end > token.begin && token.end[-1] == '"')
+					--token.end;
+				if (to_string(token) == name) {
+					orders.push_back(int(i));
+					break;
+				}
+			}
+
+		double checksum = 0.0;
+		for (size_t li = 1; li < lines.size(); ++li) {
+			std::vector<cgv::utils::token> tokens;
+			cgv::utils::split_to_tokens(lines[li].begin, lines[li].end, tokens, "");
+			if (tokens.size() < headers.size())
+				continue;
+
+			double time, x, y, z, p;
+			int id;
+			cgv::utils::is_double(tokens[orders[0]].begin, tokens[orders[0]].end, time);
+			cgv::utils::is_integer(tokens[orders[1]].begin, tokens[orders[1]].end, id);
+			cgv::utils::is_double(tokens[orders[2]].begin, tokens[orders[2]].end, x);
+			cgv::utils::is_double(tokens[orders[3]].begin, tokens[orders[3]].end, y);
+			cgv::utils::is_double(tokens[orders[4]].begin, tokens[orders[4]].end, z);
+			cgv::utils::is_double(tokens[orders[5]].begin, tokens[orders[5]].end, p);
+			checksum += time + id + x + y + z + p;
+		}
+		return checksum;
+	});
+	run("read_row", [&]() {
+		logger_parser lp(file_name);
+		lp.read_header(headers);
+
+		double checksum = 0.0;
+		double time, x, y, z, p;
+		int id;
+		while (lp.read_row(time, id, x, y, z, p))
+			checksum += time + id + x + y + z + p;
+		return checksum;
+	});
+	std::vector<unsigned> thread_counts(1, 1u);
+	if (std::thread::hardware_concurrency() > 1)
+		thread_counts.push_back(std::thread::hardware_concurrency());
+
+	for (unsigned nr_threads : thread_counts) {
+		std::string name = "read_columns with " + std::to_string(nr_threads) + " threads";
+		run(name.c_str(), [&]() {
+			logger_parser lp(file_name);
+			lp.read_header(headers);
+
+			std::vector<double> time, x, y, z, p;
+			std::vector<int> id;
+			lp.read_columns(nr_threads, time, id, x, y, z, p);
+
+			double checksum = 0.0;
+			for (size_t r = 0; r < time.size(); ++r)
+				checksum += time[r] + id[r] + x[r] + y[r] + z[r] + p[r];
+			return checksum;
+		});
+	}
+
+	std::remove(file_name.c_str());
+}
+void benchmark_logger_cache(const std::string& file_name, size_t nr_rows, unsigned nr_repetitions)
+{
+	const int nr_properties = 37;
+	{
+		std::mt19937 generator(0);
+		std::uniform_real_distribution<double> value(0.0, 100.0);
+
+		std::ofstream os(file_name);
+		os << "\"time\"\t\"cell.id\"\t\"l.x\"";
+		for (int p = 0; p < nr_properties; ++p)
+			os << "\t\"p" << p << "\"";
+		os << "\n";
+
+		for (size_t r = 0; r < nr_rows; ++r) {
+			os << r / 1000 << "\t" << r % 1000 << "\t" << value(generator);
+			for (int p = 0; p < nr_properties; ++p)
+				os << "\t" << value(generator);
+			os << "\n";
+		}
+	}
+
+	std::string cache_file_name = logger_cache::get_cache_file_name(file_name);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	bool converted = logger_cache::convert(file_name, cache_file_name);
+	auto stop = std::chrono::high_resolution_clock::now();
+
+	std::cout << "logger cache benchmark with " << nr_rows << " rows and " << nr_properties + 3 << " columns" << std::endl;
+	if (!converted) {
+		std::cout << "  couldn't convert " << file_name << std::endl;
+		std::remove(file_name.c_str());
+		return;
+	}
+	std::cout << "  convert: " << std::chrono::duration<double>(stop - start).count() << " s" << std::endl;
+
+	auto run = [&](const char* name, const std::function<double()>& scan) {
+		double best_seconds = std::numeric_limits<double>::max();
+		double checksum = 0.0;
+
+		for (unsigned r = 0; r < nr_repetitions; ++r) {
+			auto start = std::chrono::high_resolution_clock::now();
+			checksum = scan();
+			auto stop = std::chrono::high_resolution_clock::now();
+
+			best_seconds = std::min(best_seconds, std::chrono::duration<double>(stop - start).count());
+		}
+
+		std::cout << "  " << name << ": " << 1e3 * best_seconds << " ms (checksum " << checksum << ")" << std::endl;
+	};
+
+	run("read_columns of 3 columns", [&]() {
+		logger_parser lp(file_name);
+		lp.read_header({ "time", "cell.id", "p36" });
+
+		std::vector<double> time, p;
+		std::vector<int> id;
+		lp.read_columns(0, time, id, p);
+
+		double checksum = 0.0;
+		for (size_t r = 0; r < time.size(); ++r)
+			checksum += time[r] + id[r] + p[r];
+		return checksum;
+	});
+	run("cache spans of 3 columns", [&]() {
+		logger_cache cache;
+		if (!cache.open(cache_file_name))
+			return 0.0;
+
+		logger_cache::column_span<int32_t> time = cache.get_column<int32_t>("time");
+		logger_cache::column_span<int32_t> id = cache.get_column<int32_t>("cell.id");
+		logger_cache::column_span<double> p = cache.get_column<double>("p36");
+
+		double checksum = 0.0;
+		for (size_t r = 0; r < p.size; ++r)
+			checksum += time[r] + id[r] + p[r];
+		return checksum;
+	});
+
+	std::remove(cache_file_name.c_str());
+	std::remove(file_name.c_str());
+}
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmarks.h"
+#include "../node_scanner.h"
+
+void benchmark_node_scanner(size_t nr_nodes, unsigned nr_repetitions)
+{
+	typedef cgv::math::fvec<float, 3> vec3;
+
+	std::mt19937 generator(0);
+	std::uniform_int_distribution<int> coordinate(0, 999);
+
+	std::string text;
+	for (size_t i = 0; i < nr_nodes; ++i) {
+		text += std::to_string(coordinate(generator)) + ',';
+		text += std::to_string(coordinate(generator)) + ',';
+		text += std::to_string(coordinate(generator)) + ';';
+	}
+
+	double megabytes = text.size() / (1024.0 * 1024.0);
+
+	std::vector<vec3> reference;
+	node_scanner::parse_scalar(text.data(), text.data() + text.size(), true, reference);
+
+	auto run = [&](const char* name, const std::function<void(std::vector<vec3>&)>& scan) {
+		double best_seconds = std::numeric_limits<double>::max();
+		bool equal = true;
+
+		for (unsigned r = 0; r < nr_repetitions; ++r) {
+			std::vector<vec3> nodes;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			scan(nodes);
+			auto stop = std::chrono::high_resolution_clock::now();
+
+			best_seconds = std::min(best_seconds, std::chrono::duration<double>(stop - start).count());
+			equal = equal && nodes == reference;
+		}
+
+		std::cout << "  " << name << ": " << megabytes / best_seconds << " MB/s ("
+			<< 1e9 * best_seconds / nr_nodes << " ns per node)" << (equal ? "" : " RESULT MISMATCH") << std::endl;
+	};
+
+	std::cout << "node scanner benchmark with " << nr_nodes << " nodes (" << megabytes << " MB)" << std::endl;
+
+	std::string copy;
+	run("strtok + std::string", [&](std::vector<vec3>& nodes) {
+		// the former parser tokenized the text in place
+		copy = text;
+
+		std::vector<std::string> nodes_str_vector;
+		char* token = strtok(&copy[0], ";");
+		while (token != NULL) {
+			nodes_str_vector.push_back(token);
+			token = strtok(NULL, ";");
+		}
+
+		for (auto node_str : nodes_str_vector) {
+			std::vector<std::string> node_str_vector;
+			token = strtok(&node_str[0], ", ");
+			while (token != NULL) {
+				node_str_vector.push_back(token);
+				token = strtok(NULL, ", ");
+			}
+
+			if (node_str_vector.size() != 3)
+				continue;
+
+			int x, y, z;
+			if (!cgv::utils::is_integer(node_str_vector[0], x) || !cgv::utils::is_integer(node_str_vector[1], y) || !cgv::utils::is_integer(node_str_vector[2], z))
+				continue;
+
+			nodes.emplace_back(float(x), float(y), float(z));
+		}
+	});
+	run("scalar", [&](std::vector<vec3>& nodes) {
+		node_scanner::parse_scalar(text.data(), text.data() + text.size(), true, nodes);
+	});
+	run(node_scanner::get_instruction_set(), [&](std::vector<vec3>& nodes) {
+		node_scanner::parse(text.data(), text.data() + text.size(), true, nodes);
+	});
+}
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cgv/utils/dir.h>
+
+#include "benchmarks.h"
+#include "../cell_data.h"
+#include "../snapshot_loader.h"
+
+void benchmark_snapshot_loader(const std::string& dir_name, unsigned max_nr_threads)
+{
+	std::vector<std::string> found_file_names;
+	cgv::utils::dir::glob(dir_name, found_file_names, "*.xml");
+	if (found_file_names.empty())
+		cgv::utils::dir::glob(dir_name, found_file_names, "*.xml.gz");
+
+	std::vector<std::string> file_names;
+	for (const auto& file_name : found_file_names) {
+		float time;
+		if (snapshot_loader::get_time(file_name, time))
+			file_names.push_back(file_name);
+	}
+	if (file_names.empty()) {
+		std::cerr << "couldn't find snapshots in " << dir_name << std::endl;
+		return;
+	}
+
+	if (max_nr_threads == 0)
+		max_nr_threads = std::max(1u, std::thread::hardware_concurrency());
+	max_nr_threads = unsigned(std::min(size_t(max_nr_threads), file_names.size()));
+
+	// load and merge all snapshots like the application, compressed files are inflated by a single thread, so only
+	// the number of files parsed concurrently changes
+	auto run = [&](unsigned nr_threads) {
+		std::vector<cell> cells;
+		cell::types.clear();
+		cell::centers.clear();
+		cell::nodes.clear();
+		cell::properties.clear();
+
+		return snapshot_loader::load(file_names, nr_threads, [&](size_t index, cell_snapshot& snapshot, const snapshot_loader::file_statistics& file_stats) {
+			cell::append(snapshot, cells);
+		}, 1);
+	};
+
+	std::cout << "snapshot loader benchmark with " << file_names.size() << " snapshots of " << dir_name << std::endl;
+
+	// the first load reads the files into the page cache and builds missing indices of compressed files
+	run(1);
+
+	std::vector<unsigned> thread_counts;
+	for (unsigned nr_threads = 1; nr_threads < max_nr_threads; nr_threads *= 2)
+		thread_counts.push_back(nr_threads);
+	thread_counts.push_back(max_nr_threads);
+
+	double sequential_seconds = 0.0;
+	for (unsigned nr_threads : thread_counts) {
+		snapshot_loader::statistics stats = run(nr_threads);
+		if (nr_threads == 1)
+			sequential_seconds = stats.wall_seconds;
+
+		std::cout << "  " << nr_threads << " threads: " << stats.wall_seconds << " s (" << stats.get_throughput()
+			<< " MB/s), speedup " << (stats.wall_seconds > 0.0 ? sequential_seconds / stats.wall_seconds : 1.0) << std::endl;
+	}
+
+	cell::types.clear();
+	cell::centers.clear();
+	cell::nodes.clear();
+	cell::properties.clear();
+}
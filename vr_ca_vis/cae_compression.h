@@ -0,0 +1,145 @@
+// Block wise deflate compression of cae frames
+//
+// A frame is split into blocks of a fixed uncompressed size that are compressed independently, so that the blocks of
+// one frame can be compressed and decompressed on multiple threads. A compressed frame starts with the number of
+// blocks and the compressed size of each block as uint32 in the endianess of the file, followed by the blocks.
+//
+// Usage:
+// std::vector<uint8_t> compressed;
+// cae::compress_frame(data, size, block_size, Z_DEFAULT_COMPRESSION, 0, endian, compressed);
+// cae::decompress_frame(compressed.data(), compressed.size(), data, size, block_size, 0, endian);
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "zlib.h"
+
+#include "endian.h"
+
+namespace cae {
+
+/// call process(bi) for all blocks bi < nr_blocks on up to nr_threads threads (0 for one per core), return false if
+/// one of the calls failed
+template <typename F>
+bool for_each_block(size_t nr_blocks, unsigned nr_threads, F process)
+{
+	if (nr_threads == 0)
+		nr_threads = std::max(1u, std::thread::hardware_concurrency());
+	if (nr_threads > nr_blocks)
+		nr_threads = unsigned(std::max(size_t(1), nr_blocks));
+
+	std::atomic<size_t> next_block(0);
+	std::atomic<bool> success(true);
+	auto work = [&]() {
+		for (size_t bi = next_block++; bi < nr_blocks && success; bi = next_block++)
+			if (!process(bi))
+				success = false;
+	};
+
+	if (nr_threads == 1)
+		work();
+	else {
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < nr_threads; ++t)
+			threads.emplace_back(work);
+
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	return success;
+}
+
+/// compress size bytes at data into compressed, which holds the block sizes followed by the blocks
+inline bool compress_frame(const uint8_t* data, size_t size, uint32_t block_size, int level, unsigned nr_threads, Endian file_endian, std::vector<uint8_t>& compressed)
+{
+	if (block_size == 0)
+		return false;
+
+	size_t nr_blocks = (size + block_size - 1) / block_size;
+	if (nr_blocks > UINT32_MAX)
+		return false;
+
+	std::vector<std::vector<uint8_t> > blocks(nr_blocks);
+
+	bool success = for_each_block(nr_blocks, nr_threads, [&](size_t bi) {
+		size_t block_begin = bi * block_size;
+		size_t block_end = std::min(size, block_begin + block_size);
+
+		uLongf compressed_size = compressBound(uLong(block_end - block_begin));
+		blocks[bi].resize(compressed_size);
+		if (compress2(blocks[bi].data(), &compressed_size, data + block_begin, uLong(block_end - block_begin), level) != Z_OK)
+			return false;
+
+		blocks[bi].resize(compressed_size);
+		return true;
+	});
+
+	if (!success)
+		return false;
+
+	std::vector<uint32_t> prefix(1, uint32_t(nr_blocks));
+	size_t total_size = 0;
+	for (const auto& block : blocks) {
+		prefix.push_back(uint32_t(block.size()));
+		total_size += block.size();
+	}
+
+	Endian machine_endian = get_endian();
+	map_convert_endian(prefix.data(), prefix.size(), machine_endian, file_endian, uint32_t(sizeof(uint32_t)));
+
+	compressed.resize(prefix.size() * sizeof(uint32_t));
+	memcpy(compressed.data(), prefix.data(), compressed.size());
+
+	compressed.reserve(compressed.size() + total_size);
+	for (const auto& block : blocks)
+		compressed.insert(compressed.end(), block.begin(), block.end());
+
+	return true;
+}
+
+/// decompress a frame written by compress_frame into the size bytes at data
+inline bool decompress_frame(const uint8_t* compressed, size_t compressed_size, uint8_t* data, size_t size, uint32_t block_size, unsigned nr_threads, Endian file_endian)
+{
+	if (block_size == 0 || compressed_size < sizeof(uint32_t))
+		return false;
+
+	Endian machine_endian = get_endian();
+
+	uint32_t nr_blocks;
+	memcpy(&nr_blocks, compressed, sizeof(uint32_t));
+	map_convert_endian(nr_blocks, file_endian, machine_endian);
+
+	if (nr_blocks != (size + block_size - 1) / block_size || compressed_size < (size_t(nr_blocks) + 1) * sizeof(uint32_t))
+		return false;
+
+	std::vector<uint32_t> block_sizes(nr_blocks);
+	if (nr_blocks > 0)
+		memcpy(block_sizes.data(), compressed + sizeof(uint32_t), nr_blocks * sizeof(uint32_t));
+	map_convert_endian(block_sizes.data(), block_sizes.size(), file_endian, machine_endian, uint32_t(sizeof(uint32_t)));
+
+	// offsets of the blocks in the compressed frame
+	std::vector<size_t> block_offsets(nr_blocks + 1, (size_t(nr_blocks) + 1) * sizeof(uint32_t));
+	for (uint32_t bi = 0; bi < nr_blocks; ++bi)
+		block_offsets[bi + 1] = block_offsets[bi] + block_sizes[bi];
+
+	if (block_offsets.back() > compressed_size)
+		return false;
+
+	return for_each_block(nr_blocks, nr_threads, [&](size_t bi) {
+		size_t block_begin = bi * block_size;
+		uLongf block_length = uLongf(std::min(size, block_begin + block_size) - block_begin);
+		uLongf expected_length = block_length;
+
+		return uncompress(data + block_begin, &block_length, compressed + block_offsets[bi], uLong(block_sizes[bi])) == Z_OK &&
+			block_length == expected_length;
+	});
+}
+
+}
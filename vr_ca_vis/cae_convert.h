@@ -0,0 +1,363 @@
+// Conversion kernels between the coordinate types of cae files and their dispatch tables
+//
+// convert_vector_void looks up the kernel for a pair of coordinate types in tables that are generated at compile time
+// from the conversion templates of cae_file_format.h. The pairs that occur when reading lattice data (uint8, uint16 and
+// int32 to float, float to uint16, and the attribute range mappings of uint8 and uint16) are overloaded with SSE2 or
+// AVX2 kernels, depending on the instruction set the file is compiled for. The kernels perform the same float
+// operations in the same order as the scalar templates, so their results are identical for all values that the
+// destination type can represent.
+//
+// Usage:
+// coordinate_converter::get_convert_function(CT_UINT16, CT_FLT32)(src, dst, cnt);
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#define CAE_CONVERT_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CAE_CONVERT_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "cae_file_format.h"
+
+namespace cae {
+
+typedef std::vector<cgv::math::fvec<float, 2> > range_vector;
+
+#if defined(CAE_CONVERT_AVX2)
+namespace detail {
+/// values of src converted to int32 and stored in 16 bits by keeping the low bits as a scalar conversion does
+inline __m256i truncate_to_uint16(__m256 lo, __m256 hi)
+{
+	__m256i lo_values = _mm256_srai_epi32(_mm256_slli_epi32(_mm256_cvttps_epi32(lo), 16), 16);
+	__m256i hi_values = _mm256_srai_epi32(_mm256_slli_epi32(_mm256_cvttps_epi32(hi), 16), 16);
+	// packing works per 128 bit lane, so the 64 bit blocks are reordered afterwards
+	return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo_values, hi_values), _MM_SHUFFLE(3, 1, 2, 0));
+}
+}
+#elif defined(CAE_CONVERT_SSE2)
+namespace detail {
+inline __m128i truncate_to_uint16(__m128 lo, __m128 hi)
+{
+	__m128i lo_values = _mm_srai_epi32(_mm_slli_epi32(_mm_cvttps_epi32(lo), 16), 16);
+	__m128i hi_values = _mm_srai_epi32(_mm_slli_epi32(_mm_cvttps_epi32(hi), 16), 16);
+	return _mm_packs_epi32(lo_values, hi_values);
+}
+}
+#endif
+
+inline void convert_coordinate_vector(const uint8_t* src, float* dst, size_t cnt)
+{
+	size_t i = 0;
+#if defined(CAE_CONVERT_AVX2)
+	for (; i + 8 <= cnt; i += 8) {
+		__m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i));
+		_mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)));
+	}
+#elif defined(CAE_CONVERT_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= cnt; i += 16) {
+		__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		__m128i lo = _mm_unpacklo_epi8(bytes, zero);
+		__m128i hi = _mm_unpackhi_epi8(bytes, zero);
+		_mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+		_mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+		_mm_storeu_ps(dst + i + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+		_mm_storeu_ps(dst + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+	}
+#endif
+	for (; i < cnt; ++i)
+		dst[i] = float(src[i]);
+}
+
+inline void convert_coordinate_vector(const uint16_t* src, float* dst, size_t cnt)
+{
+	size_t i = 0;
+#if defined(CAE_CONVERT_AVX2)
+	for (; i + 8 <= cnt; i += 8) {
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		_mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(values)));
+	}
+#elif defined(CAE_CONVERT_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 8 <= cnt; i += 8) {
+		__m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		_mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(values, zero)));
+		_mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(values, zero)));
+	}
+#endif
+	for (; i < cnt; ++i)
+		dst[i] = float(src[i]);
+}
+
+/// also used in place, every block is loaded before it is stored
+inline void convert_coordinate_vector(const int32_t* src, float* dst, size_t cnt)
+{
+	size_t i = 0;
+#if defined(CAE_CONVERT_AVX2)
+	for (; i + 8 <= cnt; i += 8)
+		_mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i))));
+#elif defined(CAE_CONVERT_SSE2)
+	for (; i + 4 <= cnt; i += 4)
+		_mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+#endif
+	for (; i < cnt; ++i)
+		dst[i] = float(src[i]);
+}
+
+inline void convert_coordinate_vector(const float* src, uint16_t* dst, size_t cnt)
+{
+	size_t i = 0;
+#if defined(CAE_CONVERT_AVX2)
+	for (; i + 16 <= cnt; i += 16)
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), detail::truncate_to_uint16(_mm256_loadu_ps(src + i), _mm256_loadu_ps(src + i + 8)));
+#elif defined(CAE_CONVERT_SSE2)
+	for (; i + 8 <= cnt; i += 8)
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), detail::truncate_to_uint16(_mm_loadu_ps(src + i), _mm_loadu_ps(src + i + 4)));
+#endif
+	for (; i < cnt; ++i)
+		dst[i] = uint16_t(src[i]);
+}
+
+namespace detail {
+
+/// map unsigned integers of up to 16 bits to float with the attribute ranges, the factors and offsets of the ranges
+/// are repeated to a pattern whose length is a multiple of the vector width
+template <typename S>
+void convert_from_small_coordinate_vector(const S* src, const S& src_min, const S& src_max,
+	float* dst, const range_vector& ranges, size_t cnt)
+{
+	size_t nr_ranges = ranges.size();
+	size_t i = 0;
+#if defined(CAE_CONVERT_AVX2) || defined(CAE_CONVERT_SSE2)
+#if defined(CAE_CONVERT_AVX2)
+	const size_t width = 8;
+#else
+	const size_t width = 4;
+#endif
+	size_t pattern_size = width * nr_ranges;
+	if (pattern_size > 0 && cnt >= pattern_size) {
+		std::vector<float> scales(pattern_size);
+		std::vector<float> offsets(pattern_size);
+		for (size_t k = 0; k < pattern_size; ++k) {
+			const auto& r = ranges[k % nr_ranges];
+			scales[k] = (r[1] - r[0]) / (src_max - src_min);
+			offsets[k] = r[0];
+		}
+		int32_t min_value = int32_t(src_min);
+		for (; i + pattern_size <= cnt; i += pattern_size) {
+			for (size_t k = 0; k < pattern_size; k += width) {
+#if defined(CAE_CONVERT_AVX2)
+				__m256i values;
+				if (sizeof(S) == 1)
+					values = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i + k)));
+				else
+					values = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + k)));
+				__m256 x = _mm256_cvtepi32_ps(_mm256_sub_epi32(values, _mm256_set1_epi32(min_value)));
+				x = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&scales[k]), x), _mm256_loadu_ps(&offsets[k]));
+				_mm256_storeu_ps(dst + i + k, x);
+#else
+				const __m128i zero = _mm_setzero_si128();
+				__m128i values;
+				if (sizeof(S) == 1) {
+					int32_t bytes;
+					memcpy(&bytes, src + i + k, sizeof(bytes));
+					values = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+				}
+				else
+					values = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i + k)), zero);
+				__m128 x = _mm_cvtepi32_ps(_mm_sub_epi32(values, _mm_set1_epi32(min_value)));
+				x = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&scales[k]), x), _mm_loadu_ps(&offsets[k]));
+				_mm_storeu_ps(dst + i + k, x);
+#endif
+			}
+		}
+	}
+#endif
+	// i is a multiple of the number of ranges here
+	size_t j = 0;
+	for (; i < cnt; ++i) {
+		const auto& r = ranges[j];
+		dst[i] = float((r[1] - r[0]) / (src_max - src_min) * (src[i] - src_min) + r[0]);
+		if (++j == nr_ranges)
+			j = 0;
+	}
+}
+
+}
+
+inline void convert_from_coordinate_vector(const uint8_t* src, const uint8_t& src_min, const uint8_t& src_max,
+	float* dst, const range_vector& ranges, size_t cnt)
+{
+	detail::convert_from_small_coordinate_vector(src, src_min, src_max, dst, ranges, cnt);
+}
+
+inline void convert_from_coordinate_vector(const uint16_t* src, const uint16_t& src_min, const uint16_t& src_max,
+	float* dst, const range_vector& ranges, size_t cnt)
+{
+	detail::convert_from_small_coordinate_vector(src, src_min, src_max, dst, ranges, cnt);
+}
+
+inline void convert_to_coordinate_vector(uint16_t* dst, const uint16_t& dst_min, const uint16_t& dst_max,
+	const float* src, const range_vector& ranges, size_t cnt)
+{
+	size_t nr_ranges = ranges.size();
+	size_t i = 0;
+#if defined(CAE_CONVERT_AVX2) || defined(CAE_CONVERT_SSE2)
+#if defined(CAE_CONVERT_AVX2)
+	const size_t width = 16;
+#else
+	const size_t width = 8;
+#endif
+	size_t pattern_size = width * nr_ranges;
+	if (pattern_size > 0 && cnt >= pattern_size) {
+		std::vector<float> range_mins(pattern_size);
+		std::vector<float> range_sizes(pattern_size);
+		for (size_t k = 0; k < pattern_size; ++k) {
+			const auto& r = ranges[k % nr_ranges];
+			range_mins[k] = r[0];
+			range_sizes[k] = r[1] - r[0];
+		}
+		float scale = float(dst_max - dst_min);
+		float offset = float(dst_min);
+		for (; i + pattern_size <= cnt; i += pattern_size) {
+			for (size_t k = 0; k < pattern_size; k += width) {
+#if defined(CAE_CONVERT_AVX2)
+				__m256 x[2];
+				for (size_t l = 0; l < 2; ++l) {
+					x[l] = _mm256_div_ps(_mm256_sub_ps(_mm256_loadu_ps(src + i + k + 8 * l), _mm256_loadu_ps(&range_mins[k + 8 * l])),
+						_mm256_loadu_ps(&range_sizes[k + 8 * l]));
+					x[l] = _mm256_add_ps(_mm256_mul_ps(x[l], _mm256_set1_ps(scale)), _mm256_set1_ps(offset));
+				}
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + k), detail::truncate_to_uint16(x[0], x[1]));
+#else
+				__m128 x[2];
+				for (size_t l = 0; l < 2; ++l) {
+					x[l] = _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(src + i + k + 4 * l), _mm_loadu_ps(&range_mins[k + 4 * l])),
+						_mm_loadu_ps(&range_sizes[k + 4 * l]));
+					x[l] = _mm_add_ps(_mm_mul_ps(x[l], _mm_set1_ps(scale)), _mm_set1_ps(offset));
+				}
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + k), detail::truncate_to_uint16(x[0], x[1]));
+#endif
+			}
+		}
+	}
+#endif
+	size_t j = 0;
+	for (; i < cnt; ++i) {
+		const auto& r = ranges[j];
+		dst[i] = uint16_t((src[i] - r[0]) / (r[1] - r[0]) * (dst_max - dst_min) + dst_min);
+		if (++j == nr_ranges)
+			j = 0;
+	}
+}
+
+/// C++ type of a coordinate type
+template <CoordinateType C> struct coordinate_type;
+template <> struct coordinate_type<CT_UINT8>  { typedef uint8_t type; };
+template <> struct coordinate_type<CT_UINT16> { typedef uint16_t type; };
+template <> struct coordinate_type<CT_UINT32> { typedef uint32_t type; };
+template <> struct coordinate_type<CT_UINT64> { typedef uint64_t type; };
+template <> struct coordinate_type<CT_INT8>   { typedef int8_t type; };
+template <> struct coordinate_type<CT_INT16>  { typedef int16_t type; };
+template <> struct coordinate_type<CT_INT32>  { typedef int32_t type; };
+template <> struct coordinate_type<CT_INT64>  { typedef int64_t type; };
+template <> struct coordinate_type<CT_FLT32>  { typedef float type; };
+template <> struct coordinate_type<CT_FLT64>  { typedef double type; };
+
+class coordinate_converter
+{
+public:
+	typedef void(*convert_function)(const void* src, void* dst, size_t cnt);
+	typedef void(*convert_from_ranges_function)(const void* src, float* dst, const range_vector& ranges, size_t cnt);
+	typedef void(*convert_to_ranges_function)(const float* src, void* dst, const range_vector& ranges, size_t cnt);
+
+	static const size_t nr_types = 10;
+
+private:
+	template <CoordinateType S, CoordinateType D>
+	static void convert(const void* src, void* dst, size_t cnt)
+	{
+		typedef typename coordinate_type<S>::type source_type;
+		typedef typename coordinate_type<D>::type destination_type;
+		if (S == D)
+			memmove(dst, src, cnt * sizeof(source_type));
+		else
+			convert_coordinate_vector(static_cast<const source_type*>(src), static_cast<destination_type*>(dst), cnt);
+	}
+	/// integer types use their whole value range, floating point types the unit interval
+	template <CoordinateType C>
+	static typename coordinate_type<C>::type get_range_min()
+	{
+		typedef typename coordinate_type<C>::type value_type;
+		return std::numeric_limits<value_type>::is_integer ? std::numeric_limits<value_type>::min() : value_type(0);
+	}
+	template <CoordinateType C>
+	static typename coordinate_type<C>::type get_range_max()
+	{
+		typedef typename coordinate_type<C>::type value_type;
+		return std::numeric_limits<value_type>::is_integer ? std::numeric_limits<value_type>::max() : value_type(1);
+	}
+	template <CoordinateType S>
+	static void convert_from_ranges(const void* src, float* dst, const range_vector& ranges, size_t cnt)
+	{
+		typedef typename coordinate_type<S>::type source_type;
+		convert_from_coordinate_vector(static_cast<const source_type*>(src), get_range_min<S>(), get_range_max<S>(), dst, ranges, cnt);
+	}
+	template <CoordinateType D>
+	static void convert_to_ranges(const float* src, void* dst, const range_vector& ranges, size_t cnt)
+	{
+		typedef typename coordinate_type<D>::type destination_type;
+		convert_to_coordinate_vector(static_cast<destination_type*>(dst), get_range_min<D>(), get_range_max<D>(), src, ranges, cnt);
+	}
+
+	template <size_t... I>
+	static constexpr std::array<convert_function, nr_types * nr_types> make_convert_table(std::index_sequence<I...>)
+	{
+		return { { &convert<CoordinateType(I / nr_types), CoordinateType(I % nr_types)>... } };
+	}
+	template <size_t... I>
+	static constexpr std::array<convert_from_ranges_function, nr_types> make_convert_from_ranges_table(std::index_sequence<I...>)
+	{
+		return { { &convert_from_ranges<CoordinateType(I)>... } };
+	}
+	template <size_t... I>
+	static constexpr std::array<convert_to_ranges_function, nr_types> make_convert_to_ranges_table(std::index_sequence<I...>)
+	{
+		return { { &convert_to_ranges<CoordinateType(I)>... } };
+	}
+
+public:
+	/// return the function converting cnt values of type src_type to dst_type, which may be done in place if both have the same size
+	static convert_function get_convert_function(CoordinateType src_type, CoordinateType dst_type)
+	{
+		static constexpr std::array<convert_function, nr_types * nr_types> table =
+			make_convert_table(std::make_index_sequence<nr_types * nr_types>());
+		return table[src_type * nr_types + dst_type];
+	}
+	/// return the function mapping values of src_type to float with attribute ranges
+	static convert_from_ranges_function get_convert_from_ranges_function(CoordinateType src_type)
+	{
+		static constexpr std::array<convert_from_ranges_function, nr_types> table =
+			make_convert_from_ranges_table(std::make_index_sequence<nr_types>());
+		return table[src_type];
+	}
+	/// return the function mapping floats in attribute ranges to dst_type
+	static convert_to_ranges_function get_convert_to_ranges_function(CoordinateType dst_type)
+	{
+		static constexpr std::array<convert_to_ranges_function, nr_types> table =
+			make_convert_to_ranges_table(std::make_index_sequence<nr_types>());
+		return table[dst_type];
+	}
+};
+
+}
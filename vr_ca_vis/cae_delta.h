@@ -0,0 +1,254 @@
+// Temporal delta encoding of cae frames
+//
+// A frame in file layout holds the points, the group indices and the attributes of its entries as consecutive
+// columns, the attributes either as a single column of all attributes of an entry or as one column per attribute. A
+// delta frame describes a frame by runs of entries copied from the previous frame, each followed by
+// entries that are stored literally. Entries that the previous frame has and that are not copied are the removed
+// ones, lattice sites that change their group become literals. Decoding reproduces the frame in its original order.
+//
+// An encoded frame starts with its kind. A key frame continues with the frame itself. A delta frame continues with the
+// number of runs, for every run the index of its first entry in the previous frame, the number of copied entries and
+// the number of literal entries as uint64 in the endianess of the file, followed by the literal entries in file layout.
+//
+// Usage:
+// cae::frame_layout layout(3 * point_size, group_size, nr_attributes * attribute_size);
+// cae::frame_layout column_layout(3 * point_size, group_size, attribute_size, nr_attributes);
+// if (!cae::encode_delta_frame(layout, previous, frame, file_endian, encoded))
+//    cae::encode_key_frame(frame, encoded);
+// cae::decode_frame(layout, encoded, &previous, file_endian, frame);
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "endian.h"
+
+namespace cae {
+
+enum FrameKind
+{
+	FK_KEY = 0,  // complete frame
+	FK_DELTA = 1 // runs copied from the previous frame and literal entries
+};
+
+/// sizes of the columns of one entry in file layout, the attributes form nr_attribute_columns columns of
+/// attribute_size bytes per entry
+struct frame_layout
+{
+	size_t point_size;
+	size_t group_size;
+	size_t attribute_size;
+	size_t nr_attribute_columns;
+
+	frame_layout(size_t _point_size, size_t _group_size, size_t _attribute_size, size_t _nr_attribute_columns = 1)
+		: point_size(_point_size), group_size(_group_size), attribute_size(_attribute_size), nr_attribute_columns(_nr_attribute_columns)
+	{
+	}
+	size_t get_entry_size() const
+	{
+		return point_size + group_size + nr_attribute_columns * attribute_size;
+	}
+	/// number of entries of a frame with the given number of bytes
+	size_t get_nr_entries(size_t frame_size) const
+	{
+		return get_entry_size() == 0 ? 0 : frame_size / get_entry_size();
+	}
+};
+
+namespace detail {
+
+/// copy cnt entries starting at src_index of the frame src with src_cnt entries to dst_index of dst with dst_cnt entries
+inline void copy_entries(const frame_layout& layout, const uint8_t* src, size_t src_cnt, size_t src_index,
+	uint8_t* dst, size_t dst_cnt, size_t dst_index, size_t cnt)
+{
+	if (cnt == 0)
+		return;
+	memcpy(dst + dst_index * layout.point_size, src + src_index * layout.point_size, cnt * layout.point_size);
+	src += src_cnt * layout.point_size;
+	dst += dst_cnt * layout.point_size;
+	memcpy(dst + dst_index * layout.group_size, src + src_index * layout.group_size, cnt * layout.group_size);
+	src += src_cnt * layout.group_size;
+	dst += dst_cnt * layout.group_size;
+	for (size_t c = 0; c < layout.nr_attribute_columns; ++c) {
+		memcpy(dst + dst_index * layout.attribute_size, src + src_index * layout.attribute_size, cnt * layout.attribute_size);
+		src += src_cnt * layout.attribute_size;
+		dst += dst_cnt * layout.attribute_size;
+	}
+}
+
+/// compare entry i of frame a with a_cnt entries to entry j of frame b with b_cnt entries
+inline bool equal_entries(const frame_layout& layout, const uint8_t* a, size_t a_cnt, size_t i, const uint8_t* b, size_t b_cnt, size_t j)
+{
+	if (memcmp(a + i * layout.point_size, b + j * layout.point_size, layout.point_size) != 0 ||
+		memcmp(a + a_cnt * layout.point_size + i * layout.group_size, b + b_cnt * layout.point_size + j * layout.group_size, layout.group_size) != 0)
+		return false;
+	a += a_cnt * (layout.point_size + layout.group_size);
+	b += b_cnt * (layout.point_size + layout.group_size);
+	for (size_t c = 0; c < layout.nr_attribute_columns; ++c) {
+		if (memcmp(a + i * layout.attribute_size, b + j * layout.attribute_size, layout.attribute_size) != 0)
+			return false;
+		a += a_cnt * layout.attribute_size;
+		b += b_cnt * layout.attribute_size;
+	}
+	return true;
+}
+
+/// FNV-1a hash of entry i of a frame with cnt entries
+inline uint64_t hash_entry(const frame_layout& layout, const uint8_t* frame, size_t cnt, size_t i)
+{
+	uint64_t hash = 14695981039346656037ull;
+	auto add = [&hash](const uint8_t* bytes, size_t size) {
+		for (size_t k = 0; k < size; ++k)
+			hash = (hash ^ bytes[k]) * 1099511628211ull;
+	};
+	add(frame + i * layout.point_size, layout.point_size);
+	add(frame + cnt * layout.point_size + i * layout.group_size, layout.group_size);
+	frame += cnt * (layout.point_size + layout.group_size);
+	for (size_t c = 0; c < layout.nr_attribute_columns; ++c) {
+		add(frame + i * layout.attribute_size, layout.attribute_size);
+		frame += cnt * layout.attribute_size;
+	}
+	return hash;
+}
+
+}
+
+/// store the complete frame
+inline void encode_key_frame(const std::vector<uint8_t>& frame, std::vector<uint8_t>& encoded)
+{
+	encoded.clear();
+	encoded.reserve(frame.size() + 1);
+	encoded.push_back(uint8_t(FK_KEY));
+	encoded.insert(encoded.end(), frame.begin(), frame.end());
+}
+
+/// encode frame as difference to previous, return false if the delta frame would not be smaller than a key frame
+inline bool encode_delta_frame(const frame_layout& layout, const std::vector<uint8_t>& previous, const std::vector<uint8_t>& frame,
+	Endian file_endian, std::vector<uint8_t>& encoded)
+{
+	size_t previous_cnt = layout.get_nr_entries(previous.size());
+	size_t cnt = layout.get_nr_entries(frame.size());
+
+	// index of the entries of the previous frame by content, a lattice site is usually owned by the same group
+	std::unordered_map<uint64_t, size_t> previous_entries;
+	previous_entries.reserve(previous_cnt);
+	for (size_t j = 0; j < previous_cnt; ++j)
+		previous_entries.emplace(detail::hash_entry(layout, previous.data(), previous_cnt, j), j);
+
+	// runs as triples of first copied entry, number of copied and number of literal entries
+	std::vector<uint64_t> runs;
+	std::vector<size_t> literals;
+
+	size_t i = 0;
+	while (i < cnt) {
+		size_t copy_begin = 0;
+		size_t copy_count = 0;
+		auto iter = previous_entries.find(detail::hash_entry(layout, frame.data(), cnt, i));
+		if (iter != previous_entries.end() && detail::equal_entries(layout, frame.data(), cnt, i, previous.data(), previous_cnt, iter->second)) {
+			copy_begin = iter->second;
+			do
+				++copy_count;
+			while (i + copy_count < cnt && copy_begin + copy_count < previous_cnt &&
+				detail::equal_entries(layout, frame.data(), cnt, i + copy_count, previous.data(), previous_cnt, copy_begin + copy_count));
+		}
+
+		if (copy_count == 0) {
+			// literal entries extend the current run, only the first run may have nothing to copy
+			if (runs.empty())
+				runs.insert(runs.end(), { 0, 0, 0 });
+			++runs.back();
+			literals.push_back(i++);
+		}
+		else {
+			runs.insert(runs.end(), { uint64_t(copy_begin), uint64_t(copy_count), 0 });
+			i += copy_count;
+		}
+
+		size_t encoded_size = 1 + sizeof(uint64_t) * (runs.size() + 1) + literals.size() * layout.get_entry_size();
+		if (encoded_size >= frame.size() + 1)
+			return false;
+	}
+
+	size_t nr_runs = runs.size() / 3;
+	std::vector<uint64_t> prefix(1, uint64_t(nr_runs));
+	prefix.insert(prefix.end(), runs.begin(), runs.end());
+	map_convert_endian(prefix.data(), prefix.size(), get_endian(), file_endian, uint32_t(sizeof(uint64_t)));
+
+	encoded.resize(1 + prefix.size() * sizeof(uint64_t) + literals.size() * layout.get_entry_size());
+	encoded[0] = uint8_t(FK_DELTA);
+	memcpy(encoded.data() + 1, prefix.data(), prefix.size() * sizeof(uint64_t));
+
+	// literal entries form a frame on their own
+	uint8_t* literal_frame = encoded.data() + 1 + prefix.size() * sizeof(uint64_t);
+	for (size_t k = 0; k < literals.size(); ++k)
+		detail::copy_entries(layout, frame.data(), cnt, literals[k], literal_frame, literals.size(), k, 1);
+
+	return encoded.size() < frame.size() + 1;
+}
+
+/// decode an encoded frame, previous points to the decoded previous frame or is NULL if it is not available
+inline bool decode_frame(const frame_layout& layout, const std::vector<uint8_t>& encoded, const std::vector<uint8_t>* previous,
+	Endian file_endian, std::vector<uint8_t>& frame)
+{
+	if (encoded.empty())
+		return false;
+
+	if (encoded[0] == FK_KEY) {
+		frame.assign(encoded.begin() + 1, encoded.end());
+		return layout.get_entry_size() == 0 || frame.size() % layout.get_entry_size() == 0;
+	}
+
+	if (encoded[0] != FK_DELTA || previous == NULL || encoded.size() < 1 + sizeof(uint64_t))
+		return false;
+
+	Endian machine_endian = get_endian();
+	uint64_t nr_runs;
+	memcpy(&nr_runs, encoded.data() + 1, sizeof(uint64_t));
+	map_convert_endian(nr_runs, file_endian, machine_endian);
+
+	size_t literal_offset = 1 + sizeof(uint64_t);
+	if (nr_runs > (encoded.size() - literal_offset) / (3 * sizeof(uint64_t)))
+		return false;
+
+	std::vector<uint64_t> runs(size_t(3 * nr_runs));
+	if (!runs.empty())
+		memcpy(runs.data(), encoded.data() + literal_offset, runs.size() * sizeof(uint64_t));
+	map_convert_endian(runs.data(), runs.size(), file_endian, machine_endian, uint32_t(sizeof(uint64_t)));
+	literal_offset += runs.size() * sizeof(uint64_t);
+
+	size_t previous_cnt = layout.get_nr_entries(previous->size());
+	size_t nr_literals = layout.get_nr_entries(encoded.size() - literal_offset);
+	if (literal_offset + nr_literals * layout.get_entry_size() != encoded.size())
+		return false;
+
+	// validate the runs before writing any entry
+	uint64_t cnt = 0;
+	uint64_t literal_cnt = 0;
+	for (size_t r = 0; r < runs.size(); r += 3) {
+		if (runs[r] > previous_cnt || runs[r + 1] > previous_cnt - runs[r])
+			return false;
+		cnt += runs[r + 1] + runs[r + 2];
+		literal_cnt += runs[r + 2];
+	}
+	if (literal_cnt != nr_literals)
+		return false;
+
+	frame.resize(size_t(cnt) * layout.get_entry_size());
+	const uint8_t* literal_frame = encoded.data() + literal_offset;
+
+	size_t i = 0;
+	size_t literal = 0;
+	for (size_t r = 0; r < runs.size(); r += 3) {
+		detail::copy_entries(layout, previous->data(), previous_cnt, size_t(runs[r]), frame.data(), size_t(cnt), i, size_t(runs[r + 1]));
+		i += size_t(runs[r + 1]);
+		detail::copy_entries(layout, literal_frame, nr_literals, literal, frame.data(), size_t(cnt), i, size_t(runs[r + 2]));
+		i += size_t(runs[r + 2]);
+		literal += size_t(runs[r + 2]);
+	}
+	return true;
+}
+
+}
@@ -1,12 +1,69 @@
+#include <cstdio>
+#include <iostream>
+
 #include "cae_file_format.h"
+#include "cae_compression.h"
+#include "cae_convert.h"
+#include "cae_delta.h"
 
 namespace cae {
 
+	/// number of bytes converted at once when values are written in another endianess
+	static const size_t staging_buffer_size = size_t(1) << 20;
+
+	/// per thread buffer that receives values converted to the endianess of the file
+	static std::vector<uint8_t>& get_staging_buffer()
+	{
+		thread_local std::vector<uint8_t> staging_buffer;
+		return staging_buffer;
+	}
+
+	/// copy cnt values of type T from src to dst, where consecutive values are src_stride and dst_stride values apart
+	template <typename T>
+	static void copy_strided(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride, size_t cnt)
+	{
+		for (size_t i = 0; i < cnt; ++i)
+			memcpy(dst + i * dst_stride * sizeof(T), src + i * src_stride * sizeof(T), sizeof(T));
+	}
+	static void copy_strided(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride, size_t cnt, size_t value_size)
+	{
+		// fixed sizes let the copies of single values compile to plain loads and stores
+		switch (value_size) {
+		case 1: copy_strided<uint8_t>(src, src_stride, dst, dst_stride, cnt); break;
+		case 2: copy_strided<uint16_t>(src, src_stride, dst, dst_stride, cnt); break;
+		case 4: copy_strided<uint32_t>(src, src_stride, dst, dst_stride, cnt); break;
+		case 8: copy_strided<uint64_t>(src, src_stride, dst, dst_stride, cnt); break;
+		}
+	}
+	/// store the cnt values of a column as value k of the entries of dst, which have stride values each
+	static void interleave_column(const uint8_t* column, uint8_t* dst, size_t cnt, size_t stride, size_t k, size_t value_size)
+	{
+		copy_strided(column, 1, dst + k * value_size, stride, cnt, value_size);
+	}
+	/// gather value k of the cnt entries of src, which have stride values each, into a column
+	static void extract_column(const uint8_t* src, uint8_t* column, size_t cnt, size_t stride, size_t k, size_t value_size)
+	{
+		copy_strided(src + k * value_size, stride, column, 1, cnt, value_size);
+	}
+
+	/// sizes of the columns of an entry of a frame of the file described by header
+	static frame_layout get_frame_layout(const binary_header& header)
+	{
+		size_t attribute_size = type_sizes[header.format.attribute_type];
+		if (header.has_attribute_columns())
+			return frame_layout(3 * type_sizes[header.format.point_coord_type], type_sizes[header.format.group_index_type],
+				attribute_size, header.nr_attributes);
+		return frame_layout(3 * type_sizes[header.format.point_coord_type], type_sizes[header.format.group_index_type],
+			header.nr_attributes * attribute_size);
+	}
+
 	size_t binary_header::ensure_coordinate_intervals_allocated() const
 	{
 		size_t coord_size = type_sizes[format.point_coord_type];
-		coordinate_intervals = new uint8_t[6 * coord_size];
-		type_inits[format.point_coord_type](coordinate_intervals, 6);
+		if (!coordinate_intervals) {
+			coordinate_intervals = new uint8_t[6 * coord_size];
+			type_inits[format.point_coord_type](coordinate_intervals, 6);
+		}
 		return coord_size;
 	}
 	/// ensure that attribute ranges are allocated and initialized to invalid
@@ -29,6 +86,14 @@ namespace cae {
 			size += type_sizes[format.point_coord_type] * 6;
 		if ((format.flags & FF_ATTRIBUTE_RANGES) != 0)
 			size += sizeof(attribute_ranges.front())*nr_attributes;
+		if (is_compressed())
+			size += sizeof(compression_block_size);
+		if (has_temporal_deltas())
+			size += sizeof(keyframe_interval);
+		if (extended_flags != EF_NONE)
+			size += sizeof(extended_flags);
+		if (has_frame_offsets())
+			size += sizeof(uint64_t)*(size_t(nr_time_steps) + 1);
 		return size;
 	}
 	size_t binary_header::get_entry_size() const
@@ -56,6 +121,11 @@ namespace cae {
 		nr_attributes = 0;
 		total_nr_chars_in_attribute_names = 0;
 		coordinate_intervals = 0;
+		compression_block_size = 1 << 20;
+		compression_level = -1;
+		nr_compression_threads = 0;
+		keyframe_interval = 16;
+		extended_flags = EF_NONE;
 	}
 
 	/// deallocate coordinate_intervals
@@ -103,6 +173,7 @@ namespace cae {
 		// check file type
 		if (std::string(version.file_type, 3) != "cae") {
 			std::cerr << "did expect file <" << file_name << "> to be of type cae" << std::endl;
+			fclose(fp);
 			return false;
 		}
 		// check endianess and correct binary header lead if necessary
@@ -112,6 +183,7 @@ namespace cae {
 			map_convert_endian(nr_points, file_endian, machine_endian);
 			map_convert_endian(nr_groups, file_endian, machine_endian);
 			map_convert_endian(nr_time_steps, file_endian, machine_endian);
+			map_convert_endian(nr_attributes, file_endian, machine_endian);
 			map_convert_endian(total_nr_chars_in_attribute_names, file_endian, machine_endian);
 		}
 		// allocate temporary data
@@ -119,12 +191,13 @@ namespace cae {
 		std::string all_names(total_nr_chars_in_attribute_names, ' ');
 
 		// read variable length parts of header
-		if ((fread(&all_names[0], 1, total_nr_chars_in_attribute_names, fp) != total_nr_chars_in_attribute_names) &&
+		if ((fread(&all_names[0], 1, total_nr_chars_in_attribute_names, fp) == total_nr_chars_in_attribute_names) &&
 			read_vector(fp, name_lengths, nr_attributes) &&
 			read_vector(fp, times, nr_time_steps) &&
 			read_vector(fp, time_step_start, nr_time_steps)) {
 
 			// extract attrib names
+			attr_names.clear();
 			uint32_t char_offset = 0;
 			for (auto length : name_lengths) {
 				attr_names.push_back(all_names.substr(char_offset, length));
@@ -145,6 +218,37 @@ namespace cae {
 				if (!read_vector(fp, attribute_ranges, nr_attributes))
 					success = false;
 			}
+			// compression was introduced with version 1.1 and temporal deltas with version 1.2
+			if (success && is_compressed()) {
+				if (version.minor_version >= 1 && fread(&compression_block_size, sizeof(compression_block_size), 1, fp) == 1)
+					map_convert_endian(compression_block_size, file_endian, machine_endian);
+				else
+					success = false;
+			}
+			if (success && has_temporal_deltas()) {
+				if (version.minor_version >= 2 && fread(&keyframe_interval, sizeof(keyframe_interval), 1, fp) == 1 && keyframe_interval > 0)
+					map_convert_endian(keyframe_interval, file_endian, machine_endian);
+				else
+					success = false;
+			}
+			// extended flags were introduced with version 1.3, all of them need frame based files
+			extended_flags = EF_NONE;
+			if (success && version.minor_version >= 3) {
+				if (fread(&extended_flags, sizeof(extended_flags), 1, fp) == 1) {
+					map_convert_endian(extended_flags, file_endian, machine_endian);
+					if ((extended_flags & ~uint32_t(EF_ATTRIBUTE_COLUMNS)) != 0 || (format.flags & FF_FRAME_BASED) == 0)
+						success = false;
+				}
+				else
+					success = false;
+			}
+			// the frame offset table has an entry per time step and the end
+			if (success && has_frame_offsets()) {
+				if (!read_vector(fp, frame_offsets, size_t(nr_time_steps) + 1))
+					success = false;
+			}
+			else
+				frame_offsets.clear();
 			if (success) {
 				// pass back file pointer or close file 
 				if (fpp)
@@ -179,21 +283,19 @@ namespace cae {
 
 		Endian file_endian = Endian(format.endian);
 		Endian machine_endian = get_endian();
+		binary_header_lead lead(*this);
+		// the file gets the lowest minor version that knows all features it uses
+		lead.version.minor_version = extended_flags != EF_NONE ? 3 : (has_temporal_deltas() ? 2 : (is_compressed() ? 1 : 0));
 		if (machine_endian != file_endian) {
-			map_convert_endian(const_cast<binary_header*>(this)->nr_points, machine_endian, file_endian);
-			map_convert_endian(const_cast<binary_header*>(this)->nr_groups, machine_endian, file_endian);
-			map_convert_endian(const_cast<binary_header*>(this)->nr_time_steps, machine_endian, file_endian);
-			map_convert_endian(const_cast<binary_header*>(this)->total_nr_chars_in_attribute_names, machine_endian, file_endian);
+			map_convert_endian(lead.nr_points, machine_endian, file_endian);
+			map_convert_endian(lead.nr_groups, machine_endian, file_endian);
+			map_convert_endian(lead.nr_time_steps, machine_endian, file_endian);
+			map_convert_endian(lead.nr_attributes, machine_endian, file_endian);
+			map_convert_endian(lead.total_nr_chars_in_attribute_names, machine_endian, file_endian);
 		}
 		// write fixed length part of binary header
-		bool success = 1 == fwrite(static_cast<const binary_header_lead*>(this), sizeof(binary_header_lead), 1, fp);
+		bool success = 1 == fwrite(&lead, sizeof(binary_header_lead), 1, fp);
 
-		if (machine_endian != file_endian) {
-			map_convert_endian(const_cast<binary_header*>(this)->nr_points, file_endian, machine_endian);
-			map_convert_endian(const_cast<binary_header*>(this)->nr_groups, file_endian, machine_endian);
-			map_convert_endian(const_cast<binary_header*>(this)->nr_time_steps, file_endian, machine_endian);
-			map_convert_endian(const_cast<binary_header*>(this)->total_nr_chars_in_attribute_names, file_endian, machine_endian);
-		}
 		if (!success) {
 			fclose(fp);
 			return false;
@@ -211,17 +313,38 @@ namespace cae {
 					size_t coord_size = type_sizes[format.point_coord_type];
 					if (!coordinate_intervals) {
 						vec3 box[2] = { get_min_point(), get_max_point() };
-						const_cast<binary_header*>(this)->set_coordinate_intervals(box[0](0), box[0](1), box[0](1), box[1](0), box[1](1), box[1](2));
+						const_cast<binary_header*>(this)->set_coordinate_intervals(box[0](0), box[0](1), box[0](2), box[1](0), box[1](1), box[1](2));
 					}
-					map_convert_endian(coordinate_intervals, 6, machine_endian, file_endian, uint32_t(coord_size));
-					success = fwrite(coordinate_intervals, coord_size, 6, fp) == 6;
-					map_convert_endian(coordinate_intervals, 6, file_endian, machine_endian, uint32_t(coord_size));
+					uint8_t intervals[6 * sizeof(double)];
+					map_convert_endian(coordinate_intervals, intervals, 6, machine_endian, file_endian, uint32_t(coord_size));
+					success = fwrite(intervals, coord_size, 6, fp) == 6;
 				}
 
 				if (success && ((format.flags & FF_ATTRIBUTE_RANGES) != 0)) {
 					if (!write_vector(fp, attribute_ranges))
 						success = false;
 				}
+				if (success && is_compressed()) {
+					uint32_t block_size = compression_block_size;
+					map_convert_endian(block_size, machine_endian, file_endian);
+					success = fwrite(&block_size, sizeof(block_size), 1, fp) == 1;
+				}
+				if (success && has_temporal_deltas()) {
+					uint32_t interval = keyframe_interval;
+					map_convert_endian(interval, machine_endian, file_endian);
+					success = fwrite(&interval, sizeof(interval), 1, fp) == 1;
+				}
+				if (success && extended_flags != EF_NONE) {
+					uint32_t flags = extended_flags;
+					map_convert_endian(flags, machine_endian, file_endian);
+					success = fwrite(&flags, sizeof(flags), 1, fp) == 1;
+				}
+				// frames that are not written yet have zero offsets, which keeps the header size fixed
+				if (success && has_frame_offsets()) {
+					std::vector<uint64_t> offsets(frame_offsets);
+					offsets.resize(size_t(nr_time_steps) + 1, 0);
+					success = write_vector(fp, offsets);
+				}
 				if (success) {
 					// pass back file pointer or close file 
 					if (fpp)
@@ -237,165 +360,106 @@ namespace cae {
 		return false;
 	}
 
+	bool binary_header::read_stored_frame(uint32_t ti, const read_at_function& read_at, size_t frame_size, std::vector<uint8_t>& frame) const
+	{
+		if (size_t(ti) + 1 >= frame_offsets.size() || frame_offsets[ti + 1] < frame_offsets[ti] ||
+			frame_offsets[ti + 1] - frame_offsets[ti] > uint64_t(SIZE_MAX))
+			return false;
+
+		std::vector<uint8_t> stored(size_t(frame_offsets[ti + 1] - frame_offsets[ti]));
+		if (!read_at(frame_offsets[ti], stored.data(), stored.size()))
+			return false;
+
+		if (!is_compressed()) {
+			frame.swap(stored);
+			return true;
+		}
+
+		const uint8_t* compressed = stored.data();
+		size_t compressed_size = stored.size();
+		Endian file_endian = Endian(format.endian);
+
+		// the size of delta encoded frames is not known from the time steps
+		if (has_temporal_deltas()) {
+			uint64_t size;
+			if (compressed_size < sizeof(size))
+				return false;
+			memcpy(&size, compressed, sizeof(size));
+			map_convert_endian(size, file_endian, get_endian());
+			if (size > uint64_t(SIZE_MAX))
+				return false;
+			frame_size = size_t(size);
+			compressed += sizeof(size);
+			compressed_size -= sizeof(size);
+		}
+
+		frame.resize(frame_size);
+		return decompress_frame(compressed, compressed_size, frame.data(), frame.size(), compression_block_size, nr_compression_threads, file_endian);
+	}
+	bool binary_header::reconstruct_frame(uint32_t ti, const read_at_function& read_at, std::vector<uint8_t>& frame, uint32_t& frame_index) const
+	{
+		if (ti >= time_step_start.size() || keyframe_interval == 0)
+			return false;
+
+		// writers store a key frame at least every keyframe_interval frames
+		uint32_t key_index = ti - ti % keyframe_interval;
+		uint32_t first_index = key_index;
+		if (frame_index != UINT32_MAX && frame_index >= key_index && frame_index <= ti)
+			first_index = frame_index + 1;
+		else
+			frame_index = UINT32_MAX;
+
+		frame_layout layout = get_frame_layout(*this);
+		Endian file_endian = Endian(format.endian);
+
+		std::vector<uint8_t> encoded;
+		std::vector<uint8_t> decoded;
+		for (uint32_t fi = first_index; fi <= ti; ++fi) {
+			uint64_t cnt = get_time_step_end(fi) - time_step_start[fi];
+			if (!read_stored_frame(fi, read_at, 0, encoded) ||
+				!decode_frame(layout, encoded, frame_index == UINT32_MAX ? NULL : &frame, file_endian, decoded) ||
+				decoded.size() != cnt * layout.get_entry_size()) {
+				frame_index = UINT32_MAX;
+				return false;
+			}
+			frame.swap(decoded);
+			frame_index = fi;
+		}
+		return true;
+	}
+
 	void binary_header::convert_vector_void(CoordinateType src_type, const void* src_ptr, CoordinateType dst_type, void* dst_ptr, size_t cnt, bool is_attr) const
 	{
 		if (is_attr && ((format.flags & FF_ATTRIBUTE_RANGES) != 0)) {
 			if (dst_type == CT_FLT32) {
-				switch (src_type) {
-				case CT_UINT8:  convert_from_coordinate_vector(reinterpret_cast<const uint8_t*>(src_ptr), std::numeric_limits<uint8_t>::min(), std::numeric_limits<uint8_t>::max(), reinterpret_cast<float*>(dst_ptr), attribute_ranges, cnt); break;
-				case CT_UINT16: convert_from_coordinate_vector(reinterpret_cast<const uint16_t*>(src_ptr), std::numeric_limits<uint16_t>::min(), std::numeric_limits<uint16_t>::max(), reinterpret_cast<float*>(dst_ptr), attribute_ranges, cnt); break;
-				case CT_UINT32: convert_from_coordinate_vector(reinterpret_cast<const uint32_t*>(src_ptr), std::numeric_limits<uint32_t>::min(), std::numeric_limits<uint32_t>::max(), reinterpret_cast<float*>(dst_ptr), attribute_ranges, cnt); break;
-				case CT_UINT64: convert_from_coordinate_vector(reinterpret_cast<const uint64_t*>(src_ptr), std::numeric_limits<uint64_t>::min(), std::numeric_limits<uint64_t>::max(), reinterpret_cast<float*>(dst_ptr), attribute_ranges, cnt); break;
-				case CT_INT8:   convert_from_coordinate_vector(reinterpret_cast<const int8_t*>(src_ptr), std::numeric_limits<int8_t>::min(), std::numeric_limits<int8_t>::max(), reinterpret_cast<float*>(dst_ptr), attribute_ranges, cnt); break;
-				case CT_INT16:  convert_from_coordinate_vector(reinterpret_cast<const int16_t*>(src_ptr), std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max(), reinterpret_cast<float*>(dst_ptr), attribute_ranges, cnt); break;
-				case CT_INT32:  convert_from_coordinate_vector(reinterpret_cast<const int32_t*>(src_ptr), std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max(), reinterpret_cast<float*>(dst_ptr), attribute_ranges, cnt); break;
-				case CT_INT64:  convert_from_coordinate_vector(reinterpret_cast<const int64_t*>(src_ptr), std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(), reinterpret_cast<float*>(dst_ptr), attribute_ranges, cnt); break;
-				case CT_FLT32:  convert_from_coordinate_vector(reinterpret_cast<const float*>(src_ptr), 0.0f, 1.0f, reinterpret_cast<float*>(dst_ptr), attribute_ranges, cnt); break;
-				case CT_FLT64:  convert_from_coordinate_vector(reinterpret_cast<const double*>(src_ptr), 0.0, 1.0, reinterpret_cast<float*>(dst_ptr), attribute_ranges, cnt); break;
-				}
+				coordinate_converter::get_convert_from_ranges_function(src_type)(src_ptr, reinterpret_cast<float*>(dst_ptr), attribute_ranges, cnt);
 				return;
 			}
 			if (src_type == CT_FLT32) {
-				switch (dst_type) {
-				case CT_UINT8:  convert_to_coordinate_vector(reinterpret_cast<uint8_t*> (dst_ptr), std::numeric_limits<uint8_t>::min(), std::numeric_limits<uint8_t>::max(),   reinterpret_cast<const float*>(src_ptr), attribute_ranges, cnt); break;
-				case CT_UINT16: convert_to_coordinate_vector(reinterpret_cast<uint16_t*>(dst_ptr), std::numeric_limits<uint16_t>::min(), std::numeric_limits<uint16_t>::max(), reinterpret_cast<const float*>(src_ptr), attribute_ranges, cnt); break;
-				case CT_UINT32: convert_to_coordinate_vector(reinterpret_cast<uint32_t*>(dst_ptr), std::numeric_limits<uint32_t>::min(), std::numeric_limits<uint32_t>::max(), reinterpret_cast<const float*>(src_ptr), attribute_ranges, cnt); break;
-				case CT_UINT64: convert_to_coordinate_vector(reinterpret_cast<uint64_t*>(dst_ptr), std::numeric_limits<uint64_t>::min(), std::numeric_limits<uint64_t>::max(), reinterpret_cast<const float*>(src_ptr), attribute_ranges, cnt); break;
-				case CT_INT8:   convert_to_coordinate_vector(reinterpret_cast<int8_t*>  (dst_ptr), std::numeric_limits<int8_t>::min(), std::numeric_limits<int8_t>::max(),     reinterpret_cast<const float*>(src_ptr), attribute_ranges, cnt); break;
-				case CT_INT16:  convert_to_coordinate_vector(reinterpret_cast<int16_t*> (dst_ptr), std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max(),   reinterpret_cast<const float*>(src_ptr), attribute_ranges, cnt); break;
-				case CT_INT32:  convert_to_coordinate_vector(reinterpret_cast<int32_t*> (dst_ptr), std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max(),   reinterpret_cast<const float*>(src_ptr), attribute_ranges, cnt); break;
-				case CT_INT64:  convert_to_coordinate_vector(reinterpret_cast<int64_t*> (dst_ptr), std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::max(),   reinterpret_cast<const float*>(src_ptr), attribute_ranges, cnt); break;
-				case CT_FLT32:  convert_to_coordinate_vector(reinterpret_cast<float*>   (dst_ptr), 0.0f, 1.0f,                                                                 reinterpret_cast<const float*>(src_ptr), attribute_ranges, cnt); break;
-				case CT_FLT64:  convert_to_coordinate_vector(reinterpret_cast<double*>  (dst_ptr), 0.0, 1.0,                                                                   reinterpret_cast<const float*>(src_ptr), attribute_ranges, cnt); break;
-				}
+				coordinate_converter::get_convert_to_ranges_function(dst_type)(reinterpret_cast<const float*>(src_ptr), dst_ptr, attribute_ranges, cnt);
 				return;
 			}
 		}
-		switch (src_type) {
-		case CT_UINT8  :
-			switch (dst_type) {
-			case CT_UINT16: convert_coordinate_vector(reinterpret_cast<const uint8_t*>(src_ptr), reinterpret_cast<uint16_t*>(dst_ptr), cnt); break;
-			case CT_UINT32: convert_coordinate_vector(reinterpret_cast<const uint8_t*>(src_ptr), reinterpret_cast<uint32_t*>(dst_ptr), cnt); break;
-			case CT_UINT64: convert_coordinate_vector(reinterpret_cast<const uint8_t*>(src_ptr), reinterpret_cast<uint64_t*>(dst_ptr), cnt); break;
-			case CT_INT8:   convert_coordinate_vector(reinterpret_cast<const uint8_t*>(src_ptr), reinterpret_cast<int8_t*>(dst_ptr), cnt); break;
-			case CT_INT16:  convert_coordinate_vector(reinterpret_cast<const uint8_t*>(src_ptr), reinterpret_cast<int16_t*>(dst_ptr), cnt); break;
-			case CT_INT32:  convert_coordinate_vector(reinterpret_cast<const uint8_t*>(src_ptr), reinterpret_cast<int32_t*>(dst_ptr), cnt); break;
-			case CT_INT64:  convert_coordinate_vector(reinterpret_cast<const uint8_t*>(src_ptr), reinterpret_cast<int64_t*>(dst_ptr), cnt); break;
-			case CT_FLT32:  convert_coordinate_vector(reinterpret_cast<const uint8_t*>(src_ptr), reinterpret_cast<float*>(dst_ptr), cnt); break;
-			case CT_FLT64:  convert_coordinate_vector(reinterpret_cast<const uint8_t*>(src_ptr), reinterpret_cast<double*>(dst_ptr), cnt); break;
-			} break;
-		case CT_UINT16 :
-			switch (dst_type) {
-			case CT_UINT8:  convert_coordinate_vector(reinterpret_cast<const uint16_t*>(src_ptr), reinterpret_cast<uint8_t*>(dst_ptr), cnt); break;
-			case CT_UINT32: convert_coordinate_vector(reinterpret_cast<const uint16_t*>(src_ptr), reinterpret_cast<uint32_t*>(dst_ptr), cnt); break;
-			case CT_UINT64: convert_coordinate_vector(reinterpret_cast<const uint16_t*>(src_ptr), reinterpret_cast<uint64_t*>(dst_ptr), cnt); break;
-			case CT_INT8:   convert_coordinate_vector(reinterpret_cast<const uint16_t*>(src_ptr), reinterpret_cast<int8_t*>(dst_ptr), cnt); break;
-			case CT_INT16:  convert_coordinate_vector(reinterpret_cast<const uint16_t*>(src_ptr), reinterpret_cast<int16_t*>(dst_ptr), cnt); break;
-			case CT_INT32:  convert_coordinate_vector(reinterpret_cast<const uint16_t*>(src_ptr), reinterpret_cast<int32_t*>(dst_ptr), cnt); break;
-			case CT_INT64:  convert_coordinate_vector(reinterpret_cast<const uint16_t*>(src_ptr), reinterpret_cast<int64_t*>(dst_ptr), cnt); break;
-			case CT_FLT32:  convert_coordinate_vector(reinterpret_cast<const uint16_t*>(src_ptr), reinterpret_cast<float*>(dst_ptr), cnt); break;
-			case CT_FLT64:  convert_coordinate_vector(reinterpret_cast<const uint16_t*>(src_ptr), reinterpret_cast<double*>(dst_ptr), cnt); break;
-			} break;
-		case CT_UINT32 :
-			switch (dst_type) {
-			case CT_UINT8:  convert_coordinate_vector(reinterpret_cast<const uint32_t*>(src_ptr), reinterpret_cast<uint8_t*>(dst_ptr), cnt); break;
-			case CT_UINT16: convert_coordinate_vector(reinterpret_cast<const uint32_t*>(src_ptr), reinterpret_cast<uint16_t*>(dst_ptr), cnt); break;
-			case CT_UINT64: convert_coordinate_vector(reinterpret_cast<const uint32_t*>(src_ptr), reinterpret_cast<uint64_t*>(dst_ptr), cnt); break;
-			case CT_INT8:   convert_coordinate_vector(reinterpret_cast<const uint32_t*>(src_ptr), reinterpret_cast<int8_t*>(dst_ptr), cnt); break;
-			case CT_INT16:  convert_coordinate_vector(reinterpret_cast<const uint32_t*>(src_ptr), reinterpret_cast<int16_t*>(dst_ptr), cnt); break;
-			case CT_INT32:  convert_coordinate_vector(reinterpret_cast<const uint32_t*>(src_ptr), reinterpret_cast<int32_t*>(dst_ptr), cnt); break;
-			case CT_INT64:  convert_coordinate_vector(reinterpret_cast<const uint32_t*>(src_ptr), reinterpret_cast<int64_t*>(dst_ptr), cnt); break;
-			case CT_FLT32:  convert_coordinate_vector(reinterpret_cast<const uint32_t*>(src_ptr), reinterpret_cast<float*>(dst_ptr), cnt); break;
-			case CT_FLT64:  convert_coordinate_vector(reinterpret_cast<const uint32_t*>(src_ptr), reinterpret_cast<double*>(dst_ptr), cnt); break;
-			} break;
-		case CT_UINT64 :
-			switch (dst_type) {
-			case CT_UINT8:  convert_coordinate_vector(reinterpret_cast<const uint64_t*>(src_ptr), reinterpret_cast<uint8_t*>(dst_ptr), cnt); break;
-			case CT_UINT16: convert_coordinate_vector(reinterpret_cast<const uint64_t*>(src_ptr), reinterpret_cast<uint16_t*>(dst_ptr), cnt); break;
-			case CT_UINT32: convert_coordinate_vector(reinterpret_cast<const uint64_t*>(src_ptr), reinterpret_cast<uint32_t*>(dst_ptr), cnt); break;
-			case CT_INT8:   convert_coordinate_vector(reinterpret_cast<const uint64_t*>(src_ptr), reinterpret_cast<int8_t*>(dst_ptr), cnt); break;
-			case CT_INT16:  convert_coordinate_vector(reinterpret_cast<const uint64_t*>(src_ptr), reinterpret_cast<int16_t*>(dst_ptr), cnt); break;
-			case CT_INT32:  convert_coordinate_vector(reinterpret_cast<const uint64_t*>(src_ptr), reinterpret_cast<int32_t*>(dst_ptr), cnt); break;
-			case CT_INT64:  convert_coordinate_vector(reinterpret_cast<const uint64_t*>(src_ptr), reinterpret_cast<int64_t*>(dst_ptr), cnt); break;
-			case CT_FLT32:  convert_coordinate_vector(reinterpret_cast<const uint64_t*>(src_ptr), reinterpret_cast<float*>(dst_ptr), cnt); break;
-			case CT_FLT64:  convert_coordinate_vector(reinterpret_cast<const uint64_t*>(src_ptr), reinterpret_cast<double*>(dst_ptr), cnt); break;
-			} break;
-		case CT_INT8   :
-			switch (dst_type) {
-			case CT_UINT8:  convert_coordinate_vector(reinterpret_cast<const int8_t*>(src_ptr), reinterpret_cast<uint8_t*>(dst_ptr), cnt); break;
-			case CT_UINT16: convert_coordinate_vector(reinterpret_cast<const int8_t*>(src_ptr), reinterpret_cast<uint16_t*>(dst_ptr), cnt); break;
-			case CT_UINT32: convert_coordinate_vector(reinterpret_cast<const int8_t*>(src_ptr), reinterpret_cast<uint32_t*>(dst_ptr), cnt); break;
-			case CT_UINT64: convert_coordinate_vector(reinterpret_cast<const int8_t*>(src_ptr), reinterpret_cast<uint64_t*>(dst_ptr), cnt); break;
-			case CT_INT16:  convert_coordinate_vector(reinterpret_cast<const int8_t*>(src_ptr), reinterpret_cast<int16_t*>(dst_ptr), cnt); break;
-			case CT_INT32:  convert_coordinate_vector(reinterpret_cast<const int8_t*>(src_ptr), reinterpret_cast<int32_t*>(dst_ptr), cnt); break;
-			case CT_INT64:  convert_coordinate_vector(reinterpret_cast<const int8_t*>(src_ptr), reinterpret_cast<int64_t*>(dst_ptr), cnt); break;
-			case CT_FLT32:  convert_coordinate_vector(reinterpret_cast<const int8_t*>(src_ptr), reinterpret_cast<float*>(dst_ptr), cnt); break;
-			case CT_FLT64:  convert_coordinate_vector(reinterpret_cast<const int8_t*>(src_ptr), reinterpret_cast<double*>(dst_ptr), cnt); break;
-			} break;
-		case CT_INT16  :
-			switch (dst_type) {
-			case CT_UINT8:  convert_coordinate_vector(reinterpret_cast<const int16_t*>(src_ptr), reinterpret_cast<uint8_t*>(dst_ptr), cnt); break;
-			case CT_UINT16: convert_coordinate_vector(reinterpret_cast<const int16_t*>(src_ptr), reinterpret_cast<uint16_t*>(dst_ptr), cnt); break;
-			case CT_UINT32: convert_coordinate_vector(reinterpret_cast<const int16_t*>(src_ptr), reinterpret_cast<uint32_t*>(dst_ptr), cnt); break;
-			case CT_UINT64: convert_coordinate_vector(reinterpret_cast<const int16_t*>(src_ptr), reinterpret_cast<uint64_t*>(dst_ptr), cnt); break;
-			case CT_INT8:   convert_coordinate_vector(reinterpret_cast<const int16_t*>(src_ptr), reinterpret_cast<int8_t*>(dst_ptr), cnt); break;
-			case CT_INT32:  convert_coordinate_vector(reinterpret_cast<const int16_t*>(src_ptr), reinterpret_cast<int32_t*>(dst_ptr), cnt); break;
-			case CT_INT64:  convert_coordinate_vector(reinterpret_cast<const int16_t*>(src_ptr), reinterpret_cast<int64_t*>(dst_ptr), cnt); break;
-			case CT_FLT32:  convert_coordinate_vector(reinterpret_cast<const int16_t*>(src_ptr), reinterpret_cast<float*>(dst_ptr), cnt); break;
-			case CT_FLT64:  convert_coordinate_vector(reinterpret_cast<const int16_t*>(src_ptr), reinterpret_cast<double*>(dst_ptr), cnt); break;
-			} break;
-		case CT_INT32  :
-			switch (dst_type) {
-			case CT_UINT8:  convert_coordinate_vector(reinterpret_cast<const int32_t*>(src_ptr), reinterpret_cast<uint8_t*>(dst_ptr), cnt); break;
-			case CT_UINT16: convert_coordinate_vector(reinterpret_cast<const int32_t*>(src_ptr), reinterpret_cast<uint16_t*>(dst_ptr), cnt); break;
-			case CT_UINT32: convert_coordinate_vector(reinterpret_cast<const int32_t*>(src_ptr), reinterpret_cast<uint32_t*>(dst_ptr), cnt); break;
-			case CT_UINT64: convert_coordinate_vector(reinterpret_cast<const int32_t*>(src_ptr), reinterpret_cast<uint64_t*>(dst_ptr), cnt); break;
-			case CT_INT8:   convert_coordinate_vector(reinterpret_cast<const int32_t*>(src_ptr), reinterpret_cast<int8_t*>(dst_ptr), cnt); break;
-			case CT_INT16:  convert_coordinate_vector(reinterpret_cast<const int32_t*>(src_ptr), reinterpret_cast<int16_t*>(dst_ptr), cnt); break;
-			case CT_INT64:  convert_coordinate_vector(reinterpret_cast<const int32_t*>(src_ptr), reinterpret_cast<int64_t*>(dst_ptr), cnt); break;
-			case CT_FLT32:  convert_coordinate_vector(reinterpret_cast<const int32_t*>(src_ptr), reinterpret_cast<float*>(dst_ptr), cnt); break;
-			case CT_FLT64:  convert_coordinate_vector(reinterpret_cast<const int32_t*>(src_ptr), reinterpret_cast<double*>(dst_ptr), cnt); break;
-			} break;
-		case CT_INT64  :
-			switch (dst_type) {
-			case CT_UINT8:  convert_coordinate_vector(reinterpret_cast<const int64_t*>(src_ptr), reinterpret_cast<uint8_t*>(dst_ptr), cnt); break;
-			case CT_UINT16: convert_coordinate_vector(reinterpret_cast<const int64_t*>(src_ptr), reinterpret_cast<uint16_t*>(dst_ptr), cnt); break;
-			case CT_UINT32: convert_coordinate_vector(reinterpret_cast<const int64_t*>(src_ptr), reinterpret_cast<uint32_t*>(dst_ptr), cnt); break;
-			case CT_UINT64: convert_coordinate_vector(reinterpret_cast<const int64_t*>(src_ptr), reinterpret_cast<uint64_t*>(dst_ptr), cnt); break;
-			case CT_INT8:   convert_coordinate_vector(reinterpret_cast<const int64_t*>(src_ptr), reinterpret_cast<int8_t*>(dst_ptr), cnt); break;
-			case CT_INT16:  convert_coordinate_vector(reinterpret_cast<const int64_t*>(src_ptr), reinterpret_cast<int16_t*>(dst_ptr), cnt); break;
-			case CT_INT32:  convert_coordinate_vector(reinterpret_cast<const int64_t*>(src_ptr), reinterpret_cast<int32_t*>(dst_ptr), cnt); break;
-			case CT_FLT32:  convert_coordinate_vector(reinterpret_cast<const int64_t*>(src_ptr), reinterpret_cast<float*>(dst_ptr), cnt); break;
-			case CT_FLT64:  convert_coordinate_vector(reinterpret_cast<const int64_t*>(src_ptr), reinterpret_cast<double*>(dst_ptr), cnt); break;
-			} break;
-		case CT_FLT32  :
-			switch (dst_type) {
-			case CT_UINT8:  convert_coordinate_vector(reinterpret_cast<const float*>(src_ptr), reinterpret_cast<uint8_t*>(dst_ptr), cnt); break;
-			case CT_UINT16: convert_coordinate_vector(reinterpret_cast<const float*>(src_ptr), reinterpret_cast<uint16_t*>(dst_ptr), cnt); break;
-			case CT_UINT32: convert_coordinate_vector(reinterpret_cast<const float*>(src_ptr), reinterpret_cast<uint32_t*>(dst_ptr), cnt); break;
-			case CT_UINT64: convert_coordinate_vector(reinterpret_cast<const float*>(src_ptr), reinterpret_cast<uint64_t*>(dst_ptr), cnt); break;
-			case CT_INT8:   convert_coordinate_vector(reinterpret_cast<const float*>(src_ptr), reinterpret_cast<int8_t*>(dst_ptr), cnt); break;
-			case CT_INT16:  convert_coordinate_vector(reinterpret_cast<const float*>(src_ptr), reinterpret_cast<int16_t*>(dst_ptr), cnt); break;
-			case CT_INT32:  convert_coordinate_vector(reinterpret_cast<const float*>(src_ptr), reinterpret_cast<int32_t*>(dst_ptr), cnt); break;
-			case CT_INT64:  convert_coordinate_vector(reinterpret_cast<const float*>(src_ptr), reinterpret_cast<int64_t*>(dst_ptr), cnt); break;
-			case CT_FLT64:  convert_coordinate_vector(reinterpret_cast<const float*>(src_ptr), reinterpret_cast<double*>(dst_ptr), cnt); break;
-			} break;
-		case CT_FLT64  :
-			switch (dst_type) {
-			case CT_UINT8:  convert_coordinate_vector(reinterpret_cast<const double*>(src_ptr), reinterpret_cast<uint8_t*>(dst_ptr), cnt); break;
-			case CT_UINT16: convert_coordinate_vector(reinterpret_cast<const double*>(src_ptr), reinterpret_cast<uint16_t*>(dst_ptr), cnt); break;
-			case CT_UINT32: convert_coordinate_vector(reinterpret_cast<const double*>(src_ptr), reinterpret_cast<uint32_t*>(dst_ptr), cnt); break;
-			case CT_UINT64: convert_coordinate_vector(reinterpret_cast<const double*>(src_ptr), reinterpret_cast<uint64_t*>(dst_ptr), cnt); break;
-			case CT_INT8:   convert_coordinate_vector(reinterpret_cast<const double*>(src_ptr), reinterpret_cast<int8_t*>(dst_ptr), cnt); break;
-			case CT_INT16:  convert_coordinate_vector(reinterpret_cast<const double*>(src_ptr), reinterpret_cast<int16_t*>(dst_ptr), cnt); break;
-			case CT_INT32:  convert_coordinate_vector(reinterpret_cast<const double*>(src_ptr), reinterpret_cast<int32_t*>(dst_ptr), cnt); break;
-			case CT_INT64:  convert_coordinate_vector(reinterpret_cast<const double*>(src_ptr), reinterpret_cast<int64_t*>(dst_ptr), cnt); break;
-			case CT_FLT32:  convert_coordinate_vector(reinterpret_cast<const double*>(src_ptr), reinterpret_cast<float*>(dst_ptr), cnt); break;
-			} break;
+		coordinate_converter::get_convert_function(src_type, dst_type)(src_ptr, dst_ptr, cnt);
+	}
+	void binary_header::convert_attribute_column_void(CoordinateType src_type, const void* src_ptr, CoordinateType dst_type, void* dst_ptr, size_t cnt, uint32_t ai) const
+	{
+		if ((format.flags & FF_ATTRIBUTE_RANGES) != 0 && ai < attribute_ranges.size() && (src_type == CT_FLT32 || dst_type == CT_FLT32)) {
+			// a single range is repeated for all values
+			std::vector<vec2> range(1, attribute_ranges[ai]);
+			if (dst_type == CT_FLT32)
+				coordinate_converter::get_convert_from_ranges_function(src_type)(src_ptr, reinterpret_cast<float*>(dst_ptr), range, cnt);
+			else
+				coordinate_converter::get_convert_to_ranges_function(dst_type)(reinterpret_cast<const float*>(src_ptr), dst_ptr, range, cnt);
+			return;
 		}
+		coordinate_converter::get_convert_function(src_type, dst_type)(src_ptr, dst_ptr, cnt);
 	}
-	bool binary_file::read_variant_vector_void(FILE* fp, void* values, size_t cnt, CoordinateType file_type, CoordinateType value_type, bool is_attr) const
+	bool binary_file::read_variant_vector_void(const read_function& read, void* values, size_t cnt, CoordinateType file_type, CoordinateType value_type, bool is_attr) const
 	{
+		if (cnt == 0)
+			return true;
+
 		size_t file_size  = type_sizes[file_type];
 		size_t value_size = type_sizes[value_type];
 		Endian file = Endian(format.endian);
@@ -405,14 +469,14 @@ namespace cae {
 		if (file_size != value_size) {
 			size_t nr_bytes = cnt * file_size;
 			std::vector<uint8_t> temp(nr_bytes);
-			if (fread(&temp.front(), 1, nr_bytes, fp) != nr_bytes)
+			if (!read(&temp.front(), nr_bytes))
 				return false;
 			map_convert_endian(&temp.front(), cnt, file, machine, uint32_t(file_size));
 			convert_vector_void(file_type, &temp.front(), value_type, values, cnt, is_attr);
 		}
 		// otherwise read into target vector and convert in place
 		else {
-			if (fread(&values, file_size, cnt, fp) != cnt)
+			if (!read(values, cnt * file_size))
 				return false;
 			map_convert_endian(values, cnt, file, machine, uint32_t(file_size));
 			if (file_type != value_type)
@@ -420,8 +484,16 @@ namespace cae {
 		}
 		return true;
 	}
-	bool binary_file::write_variant_vector_void(FILE* fp, const void* values, size_t cnt, CoordinateType file_type, CoordinateType value_type, bool is_attr) const
+	bool binary_file::read_variant_vector_void(FILE* fp, void* values, size_t cnt, CoordinateType file_type, CoordinateType value_type, bool is_attr) const
+	{
+		return read_variant_vector_void([fp](void* data, size_t size) { return fread(data, 1, size, fp) == size; },
+			values, cnt, file_type, value_type, is_attr);
+	}
+	bool binary_file::write_variant_vector_void(const write_function& write, const void* values, size_t cnt, CoordinateType file_type, CoordinateType value_type, bool is_attr) const
 	{
+		if (cnt == 0)
+			return true;
+
 		size_t file_size = type_sizes[file_type];
 		size_t value_size = type_sizes[value_type];
 		Endian file = Endian(format.endian);
@@ -433,19 +505,151 @@ namespace cae {
 			std::vector<uint8_t> temp(nr_bytes);
 			convert_vector_void(value_type, values, file_type, &temp.front(), cnt, is_attr);
 			map_convert_endian(&temp.front(), cnt, machine, file, uint32_t(file_size));
-			if (fwrite(&temp.front(), 1, nr_bytes, fp) != nr_bytes)
+			if (!write(&temp.front(), nr_bytes))
 				return false;
 		}
-		// otherwise read into target vector and convert in place
+		// otherwise write values directly if no endianess conversion is needed
+		else if (file == machine || file_size == 1) {
+			if (!write(values, cnt * file_size))
+				return false;
+		}
+		// or convert chunks into the staging buffer, which leaves values untouched for concurrent readers
 		else {
-			map_convert_endian(const_cast<void*>(values), cnt, file, machine, uint32_t(file_size));
-			bool success = fwrite(&values, file_size, cnt, fp) == cnt;
-			map_convert_endian(const_cast<void*>(values), cnt, file, machine, uint32_t(file_size));
-			if (!success)
+			std::vector<uint8_t>& staging_buffer = get_staging_buffer();
+			size_t chunk_cnt = std::max(size_t(1), staging_buffer_size / file_size);
+			staging_buffer.resize(std::min(cnt, chunk_cnt) * file_size);
+			const uint8_t* value_bytes = static_cast<const uint8_t*>(values);
+			for (size_t i = 0; i < cnt; i += chunk_cnt) {
+				size_t n = std::min(chunk_cnt, cnt - i);
+				map_convert_endian(value_bytes + i * file_size, staging_buffer.data(), n, machine, file, uint32_t(file_size));
+				if (!write(staging_buffer.data(), n * file_size))
+					return false;
+			}
+		}
+		return true;
+	}
+	bool binary_file::write_variant_vector_void(FILE* fp, const void* values, size_t cnt, CoordinateType file_type, CoordinateType value_type, bool is_attr) const
+	{
+		return write_variant_vector_void([fp](const void* data, size_t size) { return fwrite(data, 1, size, fp) == size; },
+			values, cnt, file_type, value_type, is_attr);
+	}
+	bool binary_file::read_attributes_void(const read_at_function& read_at, uint64_t offset, size_t cnt,
+		void* att_ptr, CoordinateType att_type, const std::vector<uint32_t>* attr_indices) const
+	{
+		if (attr_indices)
+			for (uint32_t ai : *attr_indices)
+				if (ai >= nr_attributes)
+					return false;
+
+		CoordinateType file_type = CoordinateType(format.attribute_type);
+		size_t file_size = type_sizes[file_type];
+		size_t value_size = type_sizes[att_type];
+		size_t nr_selected = attr_indices ? attr_indices->size() : size_t(nr_attributes);
+		uint8_t* dst = static_cast<uint8_t*>(att_ptr);
+
+		if (cnt == 0 || nr_selected == 0)
+			return true;
+
+		if (!has_attribute_columns()) {
+			auto read = [&](void* data, size_t size) {
+				if (!read_at(offset, data, size))
+					return false;
+				offset += size;
+				return true;
+			};
+			if (!attr_indices)
+				return read_variant_vector_void(read, att_ptr, nr_attributes * cnt, file_type, att_type, true);
+
+			// the attributes of an entry follow each other, so all of them are read to pick the selected ones
+			std::vector<uint8_t> values(nr_attributes * cnt * value_size);
+			if (!read_variant_vector_void(read, values.data(), nr_attributes * cnt, file_type, att_type, true))
 				return false;
+			for (size_t k = 0; k < nr_selected; ++k)
+				copy_strided(values.data() + (*attr_indices)[k] * value_size, nr_attributes, dst + k * value_size, nr_selected, cnt, value_size);
+			return true;
+		}
+
+		// only the columns of the selected attributes are read, a single one directly into att_ptr
+		Endian file = Endian(format.endian);
+		Endian machine = get_endian();
+		std::vector<uint8_t> file_column(file_type != att_type ? cnt * file_size : 0);
+		std::vector<uint8_t> column(nr_selected > 1 ? cnt * value_size : 0);
+		for (size_t k = 0; k < nr_selected; ++k) {
+			uint32_t ai = attr_indices ? (*attr_indices)[k] : uint32_t(k);
+			uint64_t column_offset = offset + uint64_t(ai) * cnt * file_size;
+			uint8_t* values = nr_selected == 1 ? dst : column.data();
+			if (file_type == att_type) {
+				if (!read_at(column_offset, values, cnt * file_size))
+					return false;
+				map_convert_endian(values, cnt, file, machine, uint32_t(file_size));
+			}
+			else {
+				if (!read_at(column_offset, file_column.data(), file_column.size()))
+					return false;
+				map_convert_endian(file_column.data(), cnt, file, machine, uint32_t(file_size));
+				convert_attribute_column_void(file_type, file_column.data(), att_type, values, cnt, ai);
+			}
+			if (nr_selected > 1)
+				interleave_column(values, dst, cnt, nr_selected, k, value_size);
 		}
 		return true;
 	}
+	bool binary_file::write_attributes_void(const write_function& write, const void* att_ptr, size_t cnt, CoordinateType att_type) const
+	{
+		CoordinateType file_type = CoordinateType(format.attribute_type);
+		if (!has_attribute_columns())
+			return write_variant_vector_void(write, att_ptr, nr_attributes * cnt, file_type, att_type, true);
+
+		if (cnt == 0)
+			return true;
+
+		// the attributes are given entry by entry and written column by column
+		size_t file_size = type_sizes[file_type];
+		size_t value_size = type_sizes[att_type];
+		Endian file = Endian(format.endian);
+		Endian machine = get_endian();
+		std::vector<uint8_t> column(cnt * value_size);
+		std::vector<uint8_t> file_column(file_type != att_type ? cnt * file_size : 0);
+		for (uint32_t ai = 0; ai < nr_attributes; ++ai) {
+			extract_column(static_cast<const uint8_t*>(att_ptr), column.data(), cnt, nr_attributes, ai, value_size);
+			uint8_t* values = column.data();
+			if (file_type != att_type) {
+				convert_attribute_column_void(att_type, column.data(), file_type, file_column.data(), cnt, ai);
+				values = file_column.data();
+			}
+			map_convert_endian(values, cnt, machine, file, uint32_t(file_size));
+			if (!write(values, cnt * file_size))
+				return false;
+		}
+		return true;
+	}
+	std::shared_ptr<positional_file> binary_file::get_frame_file(const std::string& file_name) const
+	{
+		std::lock_guard<std::mutex> lock(frame_file_mutex);
+		if (!frame_file || frame_file_name != file_name) {
+			// readers that still use the previous file keep it open through their reference
+			std::shared_ptr<positional_file> file(new positional_file());
+			if (!file->open(file_name))
+				return nullptr;
+			frame_file = file;
+			frame_file_name = file_name;
+
+			std::lock_guard<std::mutex> decoded_lock(decoded_frame_mutex);
+			decoded_frame.clear();
+			decoded_frame_index = UINT32_MAX;
+		}
+		return frame_file;
+	}
+	void binary_file::close_frame_file() const
+	{
+		std::lock_guard<std::mutex> lock(frame_file_mutex);
+		frame_file.reset();
+		frame_file_name.clear();
+
+		std::lock_guard<std::mutex> decoded_lock(decoded_frame_mutex);
+		decoded_frame.clear();
+		decoded_frame_index = UINT32_MAX;
+	}
 
 	//bool binary_file::read_time_step_void(
 	//	const std::string& file_name, uint64_t beg, uint64_t cnt,
@@ -480,32 +684,82 @@ namespace cae {
 		const std::string& file_name, uint64_t beg, uint64_t cnt,
 		void* pnt_ptr, CoordinateType pnt_type,
 		void* grp_ptr, CoordinateType grp_type,
-		void* att_ptr, CoordinateType att_type) const
+		void* att_ptr, CoordinateType att_type, const std::vector<uint32_t>* attr_indices) const
 	{
 		uint64_t offset = 0;
-		FILE* fp = 0;
+		std::shared_ptr<positional_file> fp;
 		if ((format.flags & FF_SEPARATE_FRAME_FILE) != 0)
-			fp = fopen((file_name + ".caf").c_str(), "rb");
+			fp = get_frame_file(file_name + ".caf");
 		else {
-			fp = fopen((file_name + ".cae").c_str(), "rb");
+			fp = get_frame_file(file_name + ".cae");
 			offset = get_header_size();
 		}
 		if (!fp)
 			return false;
 
-		offset += beg * get_entry_size();
+		// the values of a time step are read into memory, so their number has to fit into size_t
+		if (cnt > uint64_t(SIZE_MAX) / get_entry_size())
+			return false;
 
-		bool success = true;
-		if (fseek(fp, long(offset), SEEK_SET) != 0) 
-			success = false;
-		else {
-			if (!read_variant_vector_void(fp, pnt_ptr, size_t(3 * cnt), CoordinateType(format.point_coord_type), pnt_type) ||
-				!read_variant_vector_void(fp, grp_ptr, size_t(cnt), CoordinateType(format.group_index_type), grp_type) ||
-				!read_variant_vector_void(fp, att_ptr, size_t(nr_attributes*cnt), CoordinateType(format.attribute_type), att_type, true))
-				success = false;
+		// read_at addresses the frame, attribute columns are read on their own
+		auto read_frame = [&](const read_at_function& read_at) {
+			uint64_t frame_offset = 0;
+			auto read = [&](void* data, size_t size) {
+				if (!read_at(frame_offset, data, size))
+					return false;
+				frame_offset += size;
+				return true;
+			};
+			return read_variant_vector_void(read, pnt_ptr, size_t(3 * cnt), CoordinateType(format.point_coord_type), pnt_type) &&
+				read_variant_vector_void(read, grp_ptr, size_t(cnt), CoordinateType(format.group_index_type), grp_type) &&
+				read_attributes_void(read_at, frame_offset, size_t(cnt), att_ptr, att_type, attr_indices);
+		};
+
+		if (has_frame_offsets()) {
+			if (cnt == 0)
+				return true;
+
+			// only whole frames can be decompressed or decoded, so the range has to be a time step
+			auto iter = std::upper_bound(time_step_start.begin(), time_step_start.end(), beg);
+			if (iter == time_step_start.begin())
+				return false;
+			uint32_t ti = uint32_t(iter - time_step_start.begin()) - 1;
+			if (time_step_start[ti] != beg || get_time_step_end(ti) != beg + cnt)
+				return false;
+
+			auto read_at = [&](uint64_t frame_offset, void* data, size_t size) {
+				return fp->read_at(offset + frame_offset, data, size);
+			};
+
+			std::vector<uint8_t> frame;
+			if (has_temporal_deltas()) {
+				// continue from the last decoded frame, which makes playing forward decode a single delta per frame
+				std::lock_guard<std::mutex> lock(decoded_frame_mutex);
+				if (!reconstruct_frame(ti, read_at, decoded_frame, decoded_frame_index))
+					return false;
+				frame = decoded_frame;
+			}
+			// read the compressed frame only and decompress its blocks in parallel
+			else if (!read_stored_frame(ti, read_at, size_t(cnt * get_entry_size()), frame))
+				return false;
+
+			if (frame.size() != cnt * get_entry_size())
+				return false;
+
+			return read_frame([&](uint64_t frame_offset, void* data, size_t size) {
+				if (frame_offset > frame.size() || size > frame.size() - frame_offset)
+					return false;
+				memcpy(data, frame.data() + frame_offset, size);
+				return true;
+			});
 		}
-		fclose(fp);
-		return success;
+
+		offset += beg * get_entry_size();
+
+		// reads are positional, so concurrent readers of the same file do not interfere
+		return read_frame([&](uint64_t frame_offset, void* data, size_t size) {
+			return fp->read_at(offset + frame_offset, data, size);
+		});
 	}
 	//bool binary_file::write_time_step_void(const std::string& file_name, uint64_t cnt,
 	//	const void* pnt_ptr, CoordinateType pnt_type,
@@ -531,31 +785,117 @@ namespace cae {
 	//		return write_header(file_name);
 	//	return success;
 	//}
+	bool binary_file::write_frame_void(const write_function& write_at_offset, uint64_t& offset, uint64_t cnt,
+		const void* pnt_ptr, CoordinateType pnt_type,
+		const void* grp_ptr, CoordinateType grp_type,
+		const void* att_ptr, CoordinateType att_type) const
+	{
+		if (cnt > uint64_t(SIZE_MAX) / get_entry_size())
+			return false;
+
+		auto write = [&](const void* data, size_t size) {
+			if (!write_at_offset(data, size))
+				return false;
+			offset += size;
+			return true;
+		};
+
+		auto write_frame = [&](const write_function& write) {
+			return write_variant_vector_void(write, pnt_ptr, size_t(3 * cnt), CoordinateType(format.point_coord_type), pnt_type) &&
+				write_variant_vector_void(write, grp_ptr, size_t(cnt), CoordinateType(format.group_index_type), grp_type) &&
+				write_attributes_void(write, att_ptr, size_t(cnt), att_type);
+		};
+
+		bool success = true;
+		if (has_frame_offsets()) {
+			// stage the frame in file layout, encode and compress it and record where it ends in the frame offset table
+			std::vector<uint8_t> frame;
+			frame.reserve(size_t(cnt * get_entry_size()));
+			if (!write_frame([&](const void* data, size_t size) {
+					const uint8_t* bytes = static_cast<const uint8_t*>(data);
+					frame.insert(frame.end(), bytes, bytes + size);
+					return true;
+				}))
+				success = false;
+			else {
+				uint32_t ti = frame_offsets.empty() ? 0 : uint32_t(frame_offsets.size() - 1);
+				Endian file_endian = Endian(format.endian);
+
+				std::vector<uint8_t> encoded;
+				if (has_temporal_deltas()) {
+					frame_layout layout = get_frame_layout(*this);
+
+					// a key frame is written periodically and whenever the previous frame is not known
+					std::lock_guard<std::mutex> lock(decoded_frame_mutex);
+					bool is_delta = keyframe_interval > 0 && ti % keyframe_interval != 0 && decoded_frame_index == ti - 1 &&
+						encode_delta_frame(layout, decoded_frame, frame, file_endian, encoded);
+					if (!is_delta)
+						encode_key_frame(frame, encoded);
+					decoded_frame.swap(frame);
+					decoded_frame_index = ti;
+				}
+				else
+					encoded.swap(frame);
+
+				if (frame_offsets.empty())
+					frame_offsets.push_back(offset);
+
+				if (is_compressed()) {
+					std::vector<uint8_t> compressed;
+					if (!compress_frame(encoded.data(), encoded.size(), compression_block_size, compression_level, nr_compression_threads,
+						file_endian, compressed))
+						success = false;
+					else {
+						// the reader needs the size of a delta encoded frame before decompressing it
+						if (has_temporal_deltas()) {
+							uint64_t size = encoded.size();
+							map_convert_endian(size, get_endian(), file_endian);
+							success = write(&size, sizeof(size));
+						}
+						success = success && write(compressed.data(), compressed.size());
+					}
+				}
+				else
+					success = write(encoded.data(), encoded.size());
+
+				if (success)
+					frame_offsets.push_back(offset);
+			}
+		}
+		else
+			success = write_frame(write);
+		return success;
+	}
 	bool binary_file::write_time_step_void(const std::string& file_name, uint64_t cnt,
 		const void* pnt_ptr, CoordinateType pnt_type,
 		const void* grp_ptr, CoordinateType grp_type,
 		const void* att_ptr, CoordinateType att_type, bool write_hdr) const
 	{
-		std::cout << "append time step to " << file_name << " with " << cnt << " items" << std::endl;
+		//std::cout << "append time step to " << file_name << " with " << cnt << " items" << std::endl;
 
-		FILE* fp = 0;
-		if ((format.flags & FF_SEPARATE_FRAME_FILE) != 0)
-			fp = fopen((file_name + ".caf").c_str(), "ab");
-		else {
-			fp = fopen((file_name + ".cae").c_str(), "ab");
+		// the header grows with every time step, so compressed or delta encoded frames can only follow each other in a frame file
+		if (has_frame_offsets() && (format.flags & (FF_FRAME_BASED | FF_SEPARATE_FRAME_FILE)) != (FF_FRAME_BASED | FF_SEPARATE_FRAME_FILE)) {
+			std::cerr << "compressed or delta encoded cae files need to be frame based with a separate frame file" << std::endl;
+			return false;
 		}
-		if (!fp)
+		if (has_attribute_columns() && (format.flags & FF_FRAME_BASED) == 0) {
+			std::cerr << "cae files with attribute columns need to be frame based" << std::endl;
 			return false;
+		}
 
-		bool success = true;
-		if (!write_variant_vector_void(fp, pnt_ptr, size_t(3 * cnt), CoordinateType(format.point_coord_type), pnt_type) ||
-			!write_variant_vector_void(fp, grp_ptr, size_t(cnt), CoordinateType(format.group_index_type), grp_type) ||
-			!write_variant_vector_void(fp, att_ptr, size_t(nr_attributes*cnt), CoordinateType(format.attribute_type), att_type, true))
-			success = false;
-		fclose(fp);
+		std::string frame_name = file_name + (((format.flags & FF_SEPARATE_FRAME_FILE) != 0) ? ".caf" : ".cae");
+
+		positional_file fp;
+		if (!fp.open(frame_name, positional_file::OM_WRITE))
+			return false;
+
+		// append with positional writes at the end of the file
+		uint64_t offset = fp.get_size();
+		bool success = write_frame_void([&](const void* data, size_t size) { return fp.write_at(offset, data, size); }, offset, cnt,
+			pnt_ptr, pnt_type, grp_ptr, grp_type, att_ptr, att_type);
+		fp.close();
 		if (write_hdr)
-			return write_header(file_name);
+			return write_header(file_name + ".cae") && success;
 		return success;
 	}
 }
-
@@ -1,12 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <limits>
 #include <string>
 #include <cstdint>
 #include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <cgv/utils/file.h>
 #include <cgv/math/fvec.h>
 #include <cgv/media/axis_aligned_box.h>
 #include "endian.h"
+#include "positional_file.h"
 
 namespace cae {
 
@@ -109,13 +116,17 @@ void convert_coordinate_vector(const S* src, D* dst, size_t cnt)
 		dst[i] = D(src[i]);
 }
 
+// the ranges repeat with the attributes of each entry, so the range index wraps around instead of taking a modulo
 template <typename S>
 void convert_from_coordinate_vector(const S* src, const S& src_min, const S& src_max,
 	float* dst, const std::vector<cgv::math::fvec<float,2> >& ranges, size_t cnt)
 {
+	size_t j = 0;
 	for (size_t i = 0; i < cnt; ++i) {
-		const cgv::math::fvec<float, 2>& r = ranges[i%ranges.size()];
+		const cgv::math::fvec<float, 2>& r = ranges[j];
 		dst[i] = float((r[1] - r[0]) / (src_max - src_min) * (src[i] - src_min) + r[0]);
+		if (++j == ranges.size())
+			j = 0;
 	}
 }
 
@@ -123,9 +134,12 @@ template <typename D>
 void convert_to_coordinate_vector(D* dst, const D& dst_min, const D& dst_max,
 	const float* src, const std::vector<cgv::math::fvec<float, 2> >& ranges, size_t cnt)
 {
+	size_t j = 0;
 	for (size_t i = 0; i < cnt; ++i) {
-		const cgv::math::fvec<float, 2>& r = ranges[i%ranges.size()];
+		const cgv::math::fvec<float, 2>& r = ranges[j];
 		dst[i] = D((src[i] - r[0]) / (r[1] - r[0]) * (dst_max - dst_min) + dst_min);
+		if (++j == ranges.size())
+			j = 0;
 	}
 }
 
@@ -143,7 +157,16 @@ enum FileFlags
 	FF_COORDINATE_INTERVALS = 1, // store for x, y, and z coordinates the min values followed by the max values arising in the dataset
 	FF_ATTRIBUTE_RANGES = 2,     // store for each attribute the ranges that they assume and to which they should be transformed
 	FF_FRAME_BASED = 4,          // data is ordered frame by frame
-	FF_SEPARATE_FRAME_FILE = 8   // frame data is stored in a separate file with extension "caf"
+	FF_SEPARATE_FRAME_FILE = 8,  // frame data is stored in a separate file with extension "caf"
+	FF_COMPRESSED = 16,          // frames are stored as deflate compressed blocks located through a frame offset table (version 1.1), requires FF_FRAME_BASED
+	FF_TEMPORAL_DELTAS = 32      // frames between periodic key frames store differences to the previous frame (version 1.2), requires FF_FRAME_BASED
+};
+
+// flags that do not fit into the six bits of FileFormat::flags, stored behind the optional header fields (version 1.3)
+enum ExtendedFileFlags
+{
+	EF_NONE = 0,
+	EF_ATTRIBUTE_COLUMNS = 1     // the attributes of a frame are stored as one column per attribute instead of entry by entry, requires FF_FRAME_BASED
 };
 
 struct FileFormat
@@ -177,6 +200,8 @@ protected:
 	bool read_vector(FILE* fp, std::vector<T>& V, size_t cnt) const
 	{
 		V.resize(cnt);
+		if (cnt == 0)
+			return true;
 		if (fread(&V.front(), sizeof(T), cnt, fp) != cnt)
 			return false;
 		Endian file = Endian(format.endian);
@@ -187,21 +212,35 @@ protected:
 	template <typename T>
 	bool write_vector(FILE* fp, const std::vector<T>& V) const
 	{
+		if (V.empty())
+			return true;
 		Endian file = Endian(format.endian);
 		Endian machine = get_endian();
-		map_convert_endian(const_cast<std::vector<T>&>(V), machine, file);
-		bool success = fwrite(&V.front(), sizeof(T), V.size(), fp) == V.size();
-		map_convert_endian(const_cast<std::vector<T>&>(V), file, machine);
-		return success;
+		if (file == machine)
+			return fwrite(&V.front(), sizeof(T), V.size(), fp) == V.size();
+		// convert a copy such that V can be shared with readers during writing
+		std::vector<T> converted(V);
+		map_convert_endian(converted, machine, file);
+		return fwrite(&converted.front(), sizeof(T), converted.size(), fp) == converted.size();
 	}
 	///
 	void convert_vector_void(CoordinateType src_type, const void* src_ptr, CoordinateType dst_type, void* dst_ptr, size_t cnt, bool is_attr = false) const;
+	/// convert the cnt values of a column of attribute ai, which all use the range of this attribute
+	void convert_attribute_column_void(CoordinateType src_type, const void* src_ptr, CoordinateType dst_type, void* dst_ptr, size_t cnt, uint32_t ai) const;
 	/// pointer to six values of the point coordinate type containing (min_x,min_y,min_z,max_x,max_y,max_z) 
 	mutable void* coordinate_intervals;
 	/// ensure that the coordinate intervals are allocated with the size needed by the point coordinate type stored in format member
 	size_t ensure_coordinate_intervals_allocated() const;
 	/// ensure that attribute ranges are allocated and initialized to invalid
 	void ensure_attribute_ranges();
+	/// read size bytes at offset into the frame data
+	typedef std::function<bool(uint64_t offset, void* data, size_t size)> read_at_function;
+	/// read frame ti as stored in a file with frame offsets and decompress it; frame_size is the size of the
+	/// decompressed frame, which is stored in front of the blocks of delta encoded frames
+	bool read_stored_frame(uint32_t ti, const read_at_function& read_at, size_t frame_size, std::vector<uint8_t>& frame) const;
+	/// reconstruct frame ti of a delta encoded file in file layout by decoding from the last key frame. If frame holds
+	/// the decoded frame frame_index between this key frame and ti, decoding continues from there. On success frame_index is ti.
+	bool reconstruct_frame(uint32_t ti, const read_at_function& read_at, std::vector<uint8_t>& frame, uint32_t& frame_index) const;
 public:
 	size_t get_header_size() const;
 	size_t get_entry_size() const;
@@ -224,6 +263,26 @@ public:
 	std::vector<float> times;
 	/// global index of first particle for each time step
 	std::vector<uint64_t> time_step_start;
+	/// uncompressed size of the independently compressed blocks of a frame if FF_COMPRESSED is set
+	uint32_t compression_block_size;
+	/// zlib compression level used when writing compressed frames, -1 for the zlib default
+	int compression_level;
+	/// number of threads compressing or decompressing the blocks of a frame, 0 for one per core
+	unsigned nr_compression_threads;
+	/// if FF_TEMPORAL_DELTAS is set, every keyframe_interval-th frame is a key frame
+	uint32_t keyframe_interval;
+	/// if frames are compressed or delta encoded, offset of each frame in the frame data followed by the end of the last frame
+	mutable std::vector<uint64_t> frame_offsets;
+	/// combination of ExtendedFileFlags
+	uint32_t extended_flags;
+	/// return whether frames are stored compressed
+	bool is_compressed() const { return (format.flags & FF_COMPRESSED) != 0; }
+	/// return whether frames are delta encoded
+	bool has_temporal_deltas() const { return (format.flags & FF_TEMPORAL_DELTAS) != 0; }
+	/// return whether frames have variable size and are located through frame_offsets
+	bool has_frame_offsets() const { return (format.flags & (FF_COMPRESSED | FF_TEMPORAL_DELTAS)) != 0; }
+	/// return whether the attributes of a frame are stored attribute by attribute
+	bool has_attribute_columns() const { return (extended_flags & EF_ATTRIBUTE_COLUMNS) != 0; }
 	/// return the end of a time step
 	uint64_t get_time_step_end(size_t ti) const { return (ti + 1 == time_step_start.size()) ? nr_points : time_step_start[ti + 1]; }
 	/// constructor initializes all fields
@@ -239,43 +298,157 @@ public:
 class binary_file : public binary_header
 {
 protected:
+	/// read or write size bytes and advance, used to share the conversion between sequential and positional I/O
+	typedef std::function<bool(void* data, size_t size)> read_function;
+	typedef std::function<bool(const void* data, size_t size)> write_function;
+
+	/// frame file shared by all readers of time steps, pread allows concurrent reads from one descriptor
+	mutable std::mutex frame_file_mutex;
+	mutable std::shared_ptr<positional_file> frame_file;
+	mutable std::string frame_file_name;
+
+	/// last frame of a delta encoded file in file layout that was written or reconstructed, the next one only needs its delta
+	mutable std::mutex decoded_frame_mutex;
+	mutable std::vector<uint8_t> decoded_frame;
+	mutable uint32_t decoded_frame_index = UINT32_MAX;
+
+	/// return the open frame file with the given name, a different file is opened instead of the current one
+	std::shared_ptr<positional_file> get_frame_file(const std::string& file_name) const;
+
+	bool read_variant_vector_void(const read_function& read, void* values, size_t cnt, CoordinateType file_type, CoordinateType value_type, bool is_attr = false) const;
 	bool read_variant_vector_void(FILE* fp, void* values, size_t cnt, CoordinateType file_type, CoordinateType value_type, bool is_attr = false) const;
 
 	template <typename T>
 	bool read_variant_vector(FILE* fp, std::vector<T>& V, size_t cnt, CoordinateType file_type, bool is_attr = false) const
 	{
 		V.resize(cnt);
-		return read_variant_vector_void(fp, &V.front(), cnt, file_type, coordinate_traits<T>::type, is_attr);
+		return read_variant_vector_void(fp, V.data(), cnt, file_type, coordinate_traits<T>::type, is_attr);
 	}
 	template <typename T>
 	bool read_variant_vector(FILE* fp, std::vector<cgv::math::fvec<T, 3> >& V, size_t cnt, CoordinateType file_type) const
 	{
 		V.resize(cnt);
-		return read_variant_vector_void(fp, &V.front(), 3 * cnt, file_type, coordinate_traits<T>::type);
+		return read_variant_vector_void(fp, V.data(), 3 * cnt, file_type, coordinate_traits<T>::type);
 	}
 
+	bool write_variant_vector_void(const write_function& write, const void* values, size_t cnt, CoordinateType file_type, CoordinateType value_type, bool is_attr = false) const;
 	bool write_variant_vector_void(FILE* fp, const void* values, size_t cnt, CoordinateType file_type, CoordinateType value_type, bool is_attr = false) const;
 
 	template <typename T>
 	bool write_variant_vector(FILE* fp, const std::vector<T>& V, CoordinateType file_type, bool is_attr = false) const
 	{
-		return write_variant_vector_void(fp, &V.front(), V.size(), file_type, coordinate_traits<T>::type, is_attr);
+		return write_variant_vector_void(fp, V.data(), V.size(), file_type, coordinate_traits<T>::type, is_attr);
 	}
 	template <typename T>
 	bool write_variant_vector(FILE* fp, const std::vector<cgv::math::fvec<T, 3> >& V, CoordinateType file_type) const
 	{
-		return write_variant_vector_void(fp, &V.front(), 3 * V.size(), file_type, coordinate_traits<T>::type);
+		return write_variant_vector_void(fp, V.data(), 3 * V.size(), file_type, coordinate_traits<T>::type);
 	}
 
+	/// read the attributes of a frame of cnt entries that start at offset of the frame in file layout; if attr_indices
+	/// is given, only these attributes are read and stored entry by entry in the order of attr_indices
+	bool read_attributes_void(const read_at_function& read_at, uint64_t offset, size_t cnt,
+		void* att_ptr, CoordinateType att_type, const std::vector<uint32_t>* attr_indices) const;
+	/// convert the attributes of a frame of cnt entries, which are given entry by entry, to file layout and write them
+	bool write_attributes_void(const write_function& write, const void* att_ptr, size_t cnt, CoordinateType att_type) const;
+
 	bool read_time_step_void(const std::string& file_name, uint64_t beg, uint64_t cnt,
 		void* pnt_ptr, CoordinateType pnt_type,
 		void* grp_ptr, CoordinateType grp_type,
-		void* att_ptr, CoordinateType att_type) const;
+		void* att_ptr, CoordinateType att_type, const std::vector<uint32_t>* attr_indices = NULL) const;
+	/// read a time step with nr_selected_attributes attributes per entry, all attributes if attr_indices is NULL
+	template <typename P, typename I, typename A>
+	bool read_time_step_selected(const std::string& file_name, uint32_t ti,
+		std::vector<cgv::math::fvec<P, 3> >& points,
+		std::vector<I>& group_indices,
+		std::vector<A>& attr_values,
+		size_t nr_selected_attributes, const std::vector<uint32_t>* attr_indices)
+	{
+		uint64_t beg = time_step_start[ti];
+		uint64_t end = get_time_step_end(ti);
+		uint64_t cnt = end - beg;
+
+		// a time step has to fit into memory, which also bounds the sizes of the vectors
+		if (cnt > uint64_t(SIZE_MAX) / std::max(size_t(3), nr_selected_attributes))
+			return false;
+
+		points.resize(size_t(cnt));
+		group_indices.resize(size_t(cnt));
+		attr_values.resize(size_t(cnt*nr_selected_attributes));
+
+		return read_time_step_void(file_name, beg, cnt,
+			points.data(), coordinate_traits<P>::type,
+			group_indices.data(), coordinate_traits<I>::type,
+			attr_values.data(), coordinate_traits<A>::type, attr_indices);
+	}
 
 	//bool read_time_step_void(const std::string& file_name, uint64_t beg, uint64_t cnt,
 	//	void* pnt_ptr, CoordinateType pnt_type,
 	//	void* grp_ptr, CoordinateType grp_type) const;
 
+	/// extend coordinate intervals, number of groups and attribute ranges by a time step of cnt entries
+	template <typename P, typename I, typename A>
+	void update_statistics_of_time_step(const cgv::math::fvec<P, 3>* points, const I* group_indices, const A* attr_values, size_t cnt)
+	{
+		if (cnt == 0)
+			return;
+
+		// update coordinate_intervals only if corresponding file flag is set
+		if ((format.flags & FF_COORDINATE_INTERVALS) != 0) {
+			ensure_coordinate_intervals_allocated();
+			cgv::media::axis_aligned_box<P, 3> box;
+			convert_vector_void(CoordinateType(format.point_coord_type), coordinate_intervals, coordinate_traits<P>::type, &box, 6);
+			// component wise minimum and maximum without the branches of add_point, which the compiler can vectorize
+			P lo[3] = { points[0][0], points[0][1], points[0][2] };
+			P hi[3] = { lo[0], lo[1], lo[2] };
+			const P* coords = &points[0][0];
+			for (size_t i = 0; i < cnt; ++i)
+				for (int c = 0; c < 3; ++c) {
+					P v = coords[3 * i + c];
+					lo[c] = v < lo[c] ? v : lo[c];
+					hi[c] = v > hi[c] ? v : hi[c];
+				}
+			box.add_point(cgv::math::fvec<P, 3>(lo[0], lo[1], lo[2]));
+			box.add_point(cgv::math::fvec<P, 3>(hi[0], hi[1], hi[2]));
+			convert_vector_void(coordinate_traits<P>::type, &box, CoordinateType(format.point_coord_type), coordinate_intervals, 6);
+		}
+		// always update nr_groups
+		I max_group_index = group_indices[0];
+		for (size_t i = 0; i < cnt; ++i)
+			max_group_index = group_indices[i] > max_group_index ? group_indices[i] : max_group_index;
+		if (uint64_t(max_group_index) + 1 > nr_groups)
+			nr_groups = uint32_t(max_group_index + 1);
+		// update attribute ranges only if corresponding file flag is set, values are compared in their own type and
+		// only the extrema are converted to float
+		if ((format.flags & FF_ATTRIBUTE_RANGES) != 0 && nr_attributes > 0) {
+			ensure_attribute_ranges();
+			for (uint32_t ai = 0; ai < nr_attributes; ++ai) {
+				A lo = attr_values[ai], hi = lo;
+				for (size_t i = ai; i < cnt * nr_attributes; i += nr_attributes) {
+					A v = attr_values[i];
+					lo = v < lo ? v : lo;
+					hi = v > hi ? v : hi;
+				}
+				vec2& r = attribute_ranges[ai];
+				if (r[1] < r[0]) {
+					r[0] = float(lo);
+					r[1] = float(hi);
+				}
+				else {
+					r[0] = std::min(r[0], float(lo));
+					r[1] = std::max(r[1], float(hi));
+				}
+			}
+		}
+	}
+
+	/// convert, encode and write one frame of cnt entries, which starts at offset in the frame file; offset is advanced
+	/// by the number of bytes written
+	bool write_frame_void(const write_function& write, uint64_t& offset, uint64_t cnt,
+		const void* pnt_ptr, CoordinateType pnt_type,
+		const void* grp_ptr, CoordinateType grp_type,
+		const void* att_ptr, CoordinateType att_type) const;
+
 	bool write_time_step_void(const std::string& file_name, uint64_t cnt,
 		const void* pnt_ptr, CoordinateType pnt_type,
 		const void* grp_ptr, CoordinateType grp_type,
@@ -286,6 +459,9 @@ protected:
 	//	const void* grp_ptr, CoordinateType grp_type, bool write_hdr) const;
 
 public:
+	/// close the frame file kept open for reading time steps
+	void close_frame_file() const;
+
 	//template <typename P, typename I, typename A>
 	//bool read(const std::string& file_name,
 	//	std::vector<cgv::math::fvec<P, 3> >& points,
@@ -358,6 +534,7 @@ public:
 				group_indices.insert(group_indices.end(), tmp_group_indices.begin(), tmp_group_indices.end());
 				attr_values.insert(attr_values.end(), tmp_attr_values.begin(), tmp_attr_values.end());
 			}
+			close_frame_file();
 			return true;
 		}
 	}
@@ -407,6 +584,10 @@ public:
 		       const std::vector<I>& group_indices,
 		       const std::vector<A>& attr_values) const
 	{
+		// attribute columns are only defined for frames
+		if (has_attribute_columns() && (format.flags & FF_FRAME_BASED) == 0)
+			return false;
+
 		FILE* fp = 0;
 		if (!write_header(file_name, &fp))
 			return false;
@@ -428,6 +609,8 @@ public:
 		}
 		else {
 			fclose(fp);
+			// compressed and delta encoded frames are located by their offsets, which are known after writing them
+			frame_offsets.clear();
 			for (size_t ti = 0; ti < nr_time_steps; ++ti) {
 				size_t beg = size_t(time_step_start[ti]);
 				size_t end = size_t(get_time_step_end(ti));
@@ -440,6 +623,8 @@ public:
 				if (!write_time_step(file_name, tmp_points, tmp_group_indices, tmp_attr_values))
 					return false;
 			}
+			if (has_frame_offsets())
+				return write_header(file_name);
 			return true;
 		}
 	}
@@ -450,18 +635,18 @@ public:
 		std::vector<I>& group_indices,
 		std::vector<A>& attr_values)
 	{
-		uint64_t beg = time_step_start[ti];
-		uint64_t end = ((ti + 1 == time_step_start.size()) ? size_t(nr_points) : time_step_start[ti + 1]);
-		uint64_t cnt = end - beg;
-
-		points.resize(size_t(cnt));
-		group_indices.resize(size_t(cnt));
-		attr_values.resize(size_t(cnt*nr_attributes));
-
-		return read_time_step_void(file_name, beg, cnt,
-			&points.front(), coordinate_traits<P>::type,
-			&group_indices.front(), coordinate_traits<I>::type,
-			&attr_values.front(), coordinate_traits<A>::type);
+		return read_time_step_selected(file_name, ti, points, group_indices, attr_values, nr_attributes, NULL);
+	}
+	/// read a single time step with the attributes of the given indices only, which are stored entry by entry in the
+	/// order of attr_indices; in files with attribute columns the other attributes are not read at all
+	template <typename P, typename I, typename A>
+	bool read_time_step(const std::string& file_name, uint32_t ti,
+		std::vector<cgv::math::fvec<P, 3> >& points,
+		std::vector<I>& group_indices,
+		std::vector<A>& attr_values,
+		const std::vector<uint32_t>& attr_indices)
+	{
+		return read_time_step_selected(file_name, ti, points, group_indices, attr_values, attr_indices.size(), &attr_indices);
 	}
 	/// read a single time step
 	template <typename P, typename I, typename A>
@@ -475,47 +660,10 @@ public:
 		assert((format.flags & FF_FRAME_BASED) != 0);
 		time_step_start.push_back(nr_points);
 		times.push_back(time);
+		nr_time_steps = uint32_t(times.size());
 		nr_points += points.size();
-		if (update_statistics) {
-			// update coordinate_intervals only if corresponding file flag is set
-			if ((format.flags & FF_COORDINATE_INTERVALS) != 0) {
-				ensure_coordinate_intervals_allocated();
-				cgv::media::axis_aligned_box<P, 3> box;
-				convert_vector_void(CoordinateType(format.point_coord_type), coordinate_intervals, coordinate_traits<P>::type, &box, 6);
-				for (const auto& p : points)
-					box.add_point(p);
-				convert_vector_void(coordinate_traits<P>::type, &box, CoordinateType(format.point_coord_type), coordinate_intervals, 6);
-			}
-			// always update nr_groups
-			for (auto idx : group_indices)
-				if (idx + 1 > nr_groups)
-					nr_groups = idx + 1;
-			// update attribute ranges only if corresponding file flag is set
-			if ((format.flags & FF_ATTRIBUTE_RANGES) != 0) {
-				ensure_attribute_ranges();
-				std::vector<float> float_attr_values;
-				const float* float_attr_value_ptr;
-				if (coordinate_traits<A>::type == CT_FLT32)
-					float_attr_value_ptr = &attr_values[0];
-				else {
-					float_attr_values.resize(points.size()*nr_attributes);
-					float_attr_value_ptr = &float_attr_values[0];
-					convert_vector_void(coordinate_traits<A>::type, &attr_values.front(), CT_FLT32, &float_attr_values[0], attr_values.size());
-				}
-				for (size_t i = 0; i < attr_values.size(); ++i) {
-					float f = float_attr_value_ptr[i];
-					vec2& r = attribute_ranges[i%nr_attributes];
-					if (r[1] < r[0])
-						r[0] = r[1] = f;
-					else {
-						if (f < r[0])
-							r[0] = f;
-						if (f > r[1])
-							r[1] = f;
-					}
-				}
-			}
-		}
+		if (update_statistics)
+			update_statistics_of_time_step(points.data(), group_indices.data(), attr_values.data(), points.size());
 		return write_time_step(file_name, points, group_indices, attr_values, write_hdr);
 	}
 	/// read a single time step
@@ -536,9 +684,9 @@ public:
 		const std::vector<A>& attr_values, bool write_hdr = false) const
 	{
 		return write_time_step_void(file_name, points.size(),
-			&points.front(), coordinate_traits<P>::type,
-			&group_indices.front(), coordinate_traits<I>::type,
-			&attr_values.front(), coordinate_traits<A>::type, write_hdr);
+			points.data(), coordinate_traits<P>::type,
+			group_indices.data(), coordinate_traits<I>::type,
+			attr_values.data(), coordinate_traits<A>::type, write_hdr);
 	}
 };
 
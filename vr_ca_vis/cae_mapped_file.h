@@ -0,0 +1,334 @@
+// Read only access to the time steps of a cae file through a memory mapping
+//
+// The frame data (the .caf file or the part of the .cae file behind the header) is mapped once when the file is
+// opened. A time step is returned as views of its points, group indices and attributes. If the type stored in the
+// file equals the requested type, the endianess matches and the data is aligned, a view points directly into the
+// mapping and nothing is copied, otherwise the view owns a converted copy. Views stay valid until the file is closed.
+// Compressed frames are decompressed into a buffer of the frame, which the views point into instead of the mapping.
+// Delta encoded frames are reconstructed in this buffer, starting from the frame it holds if that one is on the way
+// from the last key frame, so stepping forward with the same frame object decodes a single delta.
+// Attribute columns are interleaved into a copy, so that the attributes view is ordered entry by entry in any file.
+//
+// Usage:
+// cae::mapped_binary_file file;
+// if (file.open(<file_name without extension>)) {
+//    cae::mapped_binary_file::frame<float, uint32_t, float> f;
+//    if (file.get_time_step(ti, f))
+//       for (const auto& p : f.points) ...
+// }
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "cae_compression.h"
+#include "cae_file_format.h"
+#include "mapped_file.h"
+
+namespace cae {
+
+class mapped_binary_file : public binary_header
+{
+public:
+	/// read only array that either points into the mapping or owns a converted copy
+	template <typename T>
+	class view
+	{
+		friend class mapped_binary_file;
+
+		const T* ptr = NULL;
+		size_t count = 0;
+		std::vector<T> storage;
+
+	public:
+		view()
+		{
+		}
+		view(const view&) = delete;
+		view& operator=(const view&) = delete;
+		// moving a vector keeps its buffer, so ptr stays valid
+		view(view&&) = default;
+		view& operator=(view&&) = default;
+
+		const T* data() const
+		{
+			return ptr;
+		}
+		size_t size() const
+		{
+			return count;
+		}
+		bool empty() const
+		{
+			return count == 0;
+		}
+		const T* begin() const
+		{
+			return ptr;
+		}
+		const T* end() const
+		{
+			return ptr + count;
+		}
+		const T& operator[](size_t i) const
+		{
+			return ptr[i];
+		}
+		/// whether the view points into the mapping or the decompressed frame
+		bool is_mapped() const
+		{
+			return count == 0 || storage.empty();
+		}
+	};
+
+	/// views of one time step
+	template <typename P, typename I, typename A>
+	struct frame
+	{
+		view<cgv::math::fvec<P, 3> > points;
+		view<I> group_indices;
+		view<A> attributes;
+		// decompressed or reconstructed frame data if the file is compressed or delta encoded
+		std::vector<uint8_t> buffer;
+		// time step held by the buffer of a delta encoded file
+		uint32_t buffer_index = UINT32_MAX;
+	};
+
+private:
+	mapped_file file;
+	const char* data = NULL;
+	uint64_t data_size = 0;
+
+	/// set v to the cnt values of type T made of nr_components scalars of type S at offset into the size bytes at base
+	template <typename T, typename S>
+	bool get_view(const char* base, uint64_t size, uint64_t offset, size_t cnt, unsigned nr_components, CoordinateType file_type, bool is_attr, view<T>& v) const
+	{
+		v.ptr = NULL;
+		v.count = 0;
+		v.storage.clear();
+
+		if (cnt == 0)
+			return true;
+
+		size_t nr_values = cnt * nr_components;
+		uint64_t nr_bytes = uint64_t(nr_values) * type_sizes[file_type];
+		if (offset > size || nr_bytes > size - offset)
+			return false;
+
+		const char* src = base + offset;
+		CoordinateType value_type = coordinate_traits<S>::type;
+		Endian file_endian = Endian(format.endian);
+		Endian machine_endian = get_endian();
+
+		if (file_type == value_type && file_endian == machine_endian && reinterpret_cast<uintptr_t>(src) % alignof(S) == 0) {
+			v.ptr = reinterpret_cast<const T*>(src);
+			v.count = cnt;
+			return true;
+		}
+
+		v.storage.resize(cnt);
+		void* dst = v.storage.data();
+
+		if (type_sizes[file_type] == sizeof(S)) {
+			memcpy(dst, src, size_t(nr_bytes));
+			map_convert_endian(dst, nr_values, file_endian, machine_endian, uint32_t(sizeof(S)));
+			if (file_type != value_type)
+				convert_vector_void(file_type, dst, value_type, dst, nr_values, is_attr);
+		}
+		else {
+			std::vector<uint8_t> temp(src, src + nr_bytes);
+			map_convert_endian(temp.data(), nr_values, file_endian, machine_endian, uint32_t(type_sizes[file_type]));
+			convert_vector_void(file_type, temp.data(), value_type, dst, nr_values, is_attr);
+		}
+
+		v.ptr = v.storage.data();
+		v.count = cnt;
+		return true;
+	}
+
+	/// set v to the attributes of cnt entries stored as one column per attribute at offset, interleaved entry by entry
+	template <typename A>
+	bool get_attribute_columns(const char* base, uint64_t size, uint64_t offset, size_t cnt, CoordinateType file_type, view<A>& v) const
+	{
+		v.ptr = NULL;
+		v.count = 0;
+		v.storage.clear();
+
+		if (cnt == 0 || nr_attributes == 0)
+			return true;
+
+		size_t file_size = type_sizes[file_type];
+		uint64_t nr_bytes = uint64_t(cnt) * nr_attributes * file_size;
+		if (offset > size || nr_bytes > size - offset)
+			return false;
+
+		CoordinateType value_type = coordinate_traits<A>::type;
+		Endian file_endian = Endian(format.endian);
+		Endian machine_endian = get_endian();
+
+		v.storage.resize(cnt * nr_attributes);
+		std::vector<uint8_t> column(cnt * file_size);
+		std::vector<A> values(file_type != value_type ? cnt : 0);
+		for (uint32_t ai = 0; ai < nr_attributes; ++ai) {
+			memcpy(column.data(), base + offset + uint64_t(ai) * cnt * file_size, column.size());
+			map_convert_endian(column.data(), cnt, file_endian, machine_endian, uint32_t(file_size));
+			const A* src = reinterpret_cast<const A*>(column.data());
+			if (file_type != value_type) {
+				convert_attribute_column_void(file_type, column.data(), value_type, values.data(), cnt, ai);
+				src = values.data();
+			}
+			for (size_t i = 0; i < cnt; ++i)
+				v.storage[i * nr_attributes + ai] = src[i];
+		}
+
+		v.ptr = v.storage.data();
+		v.count = v.storage.size();
+		return true;
+	}
+
+public:
+	mapped_binary_file(const mapped_binary_file&) = delete;
+	mapped_binary_file& operator=(const mapped_binary_file&) = delete;
+
+	mapped_binary_file()
+	{
+	}
+
+	/// read the header of <file_name>.cae and map the frame data, return false if one of them fails
+	bool open(const std::string& file_name)
+	{
+		close();
+
+		if (!read_header(file_name + ".cae"))
+			return false;
+
+		uint64_t offset = 0;
+		if ((format.flags & FF_SEPARATE_FRAME_FILE) != 0) {
+			if (!file.open(file_name + ".caf"))
+				return false;
+		}
+		else {
+			if (!file.open(file_name + ".cae"))
+				return false;
+			offset = get_header_size();
+		}
+
+		if (file.get_size() < offset) {
+			close();
+			return false;
+		}
+
+		data_size = file.get_size() - offset;
+		if (data_size == 0)
+			return true;
+
+		// the mapping covers the whole file, which has to fit into the address space
+		if (file.get_size() > uint64_t(SIZE_MAX)) {
+			close();
+			return false;
+		}
+
+		// the whole file is mapped, so the view starts at the beginning of the file and is aligned to a page
+		const char* view = file.map(0, size_t(file.get_size()));
+		if (view == NULL) {
+			close();
+			return false;
+		}
+
+		data = view + offset;
+		return true;
+	}
+
+	void close()
+	{
+		file.close();
+		data = NULL;
+		data_size = 0;
+	}
+
+	bool is_open() const
+	{
+		return file.is_open();
+	}
+
+	/// get views of time step ti, the views stay valid until the file is closed
+	template <typename P, typename I, typename A>
+	bool get_time_step(uint32_t ti, frame<P, I, A>& f) const
+	{
+		if (ti >= time_step_start.size() || !file.is_open())
+			return false;
+
+		uint64_t beg = time_step_start[ti];
+		uint64_t end = get_time_step_end(ti);
+		if (end < beg || end > nr_points)
+			return false;
+
+		size_t cnt = size_t(end - beg);
+
+		CoordinateType point_type = CoordinateType(format.point_coord_type);
+		CoordinateType group_type = CoordinateType(format.group_index_type);
+		CoordinateType attribute_type = CoordinateType(format.attribute_type);
+
+		const char* base = data;
+		uint64_t size = data_size;
+
+		uint64_t point_offset, group_offset, attribute_offset;
+		if (has_temporal_deltas()) {
+			auto read_at = [this](uint64_t offset, void* dst, size_t size) {
+				if (offset > data_size || size > data_size - offset)
+					return false;
+				memcpy(dst, data + offset, size);
+				return true;
+			};
+			if (!reconstruct_frame(ti, read_at, f.buffer, f.buffer_index))
+				return false;
+		}
+		else if (is_compressed()) {
+			if (ti + 1 >= frame_offsets.size() || frame_offsets[ti + 1] < frame_offsets[ti] || frame_offsets[ti + 1] > data_size)
+				return false;
+
+			// decompress the frame, whose values follow each other as in an uncompressed frame
+			f.buffer.resize(cnt * get_entry_size());
+			f.buffer_index = UINT32_MAX;
+			if (!decompress_frame(reinterpret_cast<const uint8_t*>(data) + frame_offsets[ti], size_t(frame_offsets[ti + 1] - frame_offsets[ti]),
+					f.buffer.data(), f.buffer.size(), compression_block_size, nr_compression_threads, Endian(format.endian)))
+				return false;
+		}
+
+		if (has_frame_offsets()) {
+			base = reinterpret_cast<const char*>(f.buffer.data());
+			size = f.buffer.size();
+			point_offset = 0;
+			group_offset = 3 * cnt * type_sizes[point_type];
+			attribute_offset = group_offset + cnt * type_sizes[group_type];
+		}
+		else if ((format.flags & FF_FRAME_BASED) != 0) {
+			// points, group indices and attributes of each time step follow each other
+			point_offset = beg * get_entry_size();
+			group_offset = point_offset + 3 * cnt * type_sizes[point_type];
+			attribute_offset = group_offset + cnt * type_sizes[group_type];
+		}
+		else {
+			// points, group indices and attributes of all time steps follow each other
+			point_offset = 3 * beg * type_sizes[point_type];
+			group_offset = 3 * nr_points * type_sizes[point_type] + beg * type_sizes[group_type];
+			attribute_offset = 3 * nr_points * type_sizes[point_type] + nr_points * type_sizes[group_type] +
+				beg * nr_attributes * type_sizes[attribute_type];
+		}
+
+		if (!get_view<cgv::math::fvec<P, 3>, P>(base, size, point_offset, cnt, 3, point_type, false, f.points) ||
+			!get_view<I, I>(base, size, group_offset, cnt, 1, group_type, false, f.group_indices))
+			return false;
+
+		if (has_attribute_columns())
+			return get_attribute_columns<A>(base, size, attribute_offset, cnt, attribute_type, f.attributes);
+		return get_view<A, A>(base, size, attribute_offset, cnt * nr_attributes, 1, attribute_type, true, f.attributes);
+	}
+};
+
+}
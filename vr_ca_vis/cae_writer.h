@@ -0,0 +1,347 @@
+// Writer that appends time steps to a cae file through one open frame file
+//
+// binary_file::append_time_step opens the frame file for every time step and converts and writes the frame on the
+// calling thread. The writer keeps the frame file open, copies each appended frame and lets a worker thread update the
+// statistics, convert the frame to the file types and endianess, encode it and collect it in a large aligned write
+// buffer, while the caller produces the next frame. The buffer is written whenever it is full, so the frame file is
+// written in large blocks at aligned offsets. The header is written once when the writer is closed. On a single core
+// the worker cannot overlap with the caller, so frames are written directly in append_time_step instead.
+//
+// Frames have to go to a separate frame file, as the header grows with every time step.
+//
+// Usage:
+// cae::binary_writer writer;
+// writer.format.flags = cae::FF_FRAME_BASED | cae::FF_SEPARATE_FRAME_FILE;
+// writer.open(<base_name>);
+// for (...)
+//    writer.append_time_step(time, points, group_indices, attr_values);
+// writer.close();
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cae_file_format.h"
+#include "positional_file.h"
+
+namespace cae {
+
+class binary_writer : public binary_file
+{
+	/// copy of an appended frame in the types of the caller
+	struct job
+	{
+		uint64_t cnt = 0;
+		std::vector<uint8_t> points;
+		std::vector<uint8_t> group_indices;
+		std::vector<uint8_t> attr_values;
+		CoordinateType pnt_type = CT_FLT32;
+		CoordinateType grp_type = CT_UINT32;
+		CoordinateType att_type = CT_FLT32;
+		// update_statistics_of_time_step instantiated for the types of the caller
+		void (*update_statistics)(binary_writer& writer, const job& j) = NULL;
+	};
+
+	/// number of frames that are copied but not written yet, bounds the memory used by the writer
+	static const size_t max_nr_pending_jobs = 2;
+	/// alignment of the write buffer and of the offsets at which it is written
+	static const size_t buffer_alignment = 4096;
+
+	std::string base_name;
+	positional_file file;
+
+	// write buffer with its storage, bytes in the buffer and offset of the buffer in the file
+	std::vector<uint8_t> buffer_storage;
+	uint8_t* buffer = NULL;
+	size_t buffer_size = 0;
+	size_t buffer_fill = 0;
+	uint64_t buffer_offset = 0;
+	// offset of the next frame in the frame file
+	uint64_t frame_offset = 0;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<std::unique_ptr<job>> pending;
+	std::vector<std::unique_ptr<job>> spare;
+	bool busy = false;
+	bool stop = false;
+	bool failed = false;
+	std::thread worker;
+
+	/// extend the time step table, which is only read when the header is written at close
+	void add_time_step(float time, size_t cnt)
+	{
+		time_step_start.push_back(nr_points);
+		times.push_back(time);
+		nr_time_steps = uint32_t(times.size());
+		nr_points += cnt;
+	}
+
+	template <typename P, typename I, typename A>
+	static void update_statistics_of_job(binary_writer& writer, const job& j)
+	{
+		writer.update_statistics_of_time_step(reinterpret_cast<const cgv::math::fvec<P, 3>*>(j.points.data()),
+			reinterpret_cast<const I*>(j.group_indices.data()), reinterpret_cast<const A*>(j.attr_values.data()), size_t(j.cnt));
+	}
+
+	/// write the full part of the buffer to the file
+	bool flush(bool all)
+	{
+		size_t size = all ? buffer_fill : buffer_fill - buffer_fill % buffer_alignment;
+		if (size == 0)
+			return true;
+		if (!file.write_at(buffer_offset, buffer, size))
+			return false;
+
+		buffer_offset += size;
+		buffer_fill -= size;
+		memmove(buffer, buffer + size, buffer_fill);
+		return true;
+	}
+
+	/// append size bytes to the buffer and write it whenever it is full
+	bool write_buffered(const void* data, size_t size)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		while (size > 0) {
+			// large blocks go directly to the file while they keep the offsets aligned
+			if (buffer_fill == 0 && size >= buffer_size) {
+				size_t direct_size = size - size % buffer_size;
+				if (!file.write_at(buffer_offset, bytes, direct_size))
+					return false;
+				buffer_offset += direct_size;
+				bytes += direct_size;
+				size -= direct_size;
+				continue;
+			}
+			size_t n = std::min(size, buffer_size - buffer_fill);
+			memcpy(buffer + buffer_fill, bytes, n);
+			buffer_fill += n;
+			bytes += n;
+			size -= n;
+			if (buffer_fill == buffer_size && !flush(false))
+				return false;
+		}
+		return true;
+	}
+
+	/// update the statistics with, convert, encode and write one frame on the worker thread
+	bool process(const job& j)
+	{
+		if (j.update_statistics)
+			j.update_statistics(*this, j);
+
+		return write_frame_void([this](const void* data, size_t size) { return write_buffered(data, size); }, frame_offset, j.cnt,
+			j.points.data(), j.pnt_type, j.group_indices.data(), j.grp_type, j.attr_values.data(), j.att_type);
+	}
+
+	void work()
+	{
+		for (;;) {
+			std::unique_ptr<job> j;
+			bool skip;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&] { return stop || !pending.empty(); });
+
+				if (pending.empty())
+					return;
+
+				j = std::move(pending.front());
+				pending.pop_front();
+				busy = true;
+				// frames after a failed one are dropped
+				skip = failed;
+			}
+
+			bool success = !skip && process(*j);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				busy = false;
+				if (!success)
+					failed = true;
+				spare.push_back(std::move(j));
+			}
+			cv.notify_all();
+		}
+	}
+
+public:
+	/// whether frames are converted and written on a worker thread, which needs a second core to overlap with the
+	/// caller; otherwise they are written in append_time_step
+	bool write_in_background = std::thread::hardware_concurrency() > 1;
+
+	binary_writer(const binary_writer&) = delete;
+	binary_writer& operator=(const binary_writer&) = delete;
+
+	binary_writer(FileFlags _flags = FileFlags(FF_FRAME_BASED | FF_SEPARATE_FRAME_FILE)) : binary_file()
+	{
+		format.flags = _flags;
+	}
+
+	~binary_writer()
+	{
+		close();
+	}
+
+	bool is_open() const
+	{
+		return file.is_open();
+	}
+
+	/// create the frame file of _base_name, an existing one is truncated; buffer_size is rounded up to a multiple of
+	/// the alignment
+	bool open(const std::string& _base_name, size_t _buffer_size = size_t(16) << 20)
+	{
+		close();
+
+		if ((format.flags & (FF_FRAME_BASED | FF_SEPARATE_FRAME_FILE)) != (FF_FRAME_BASED | FF_SEPARATE_FRAME_FILE)) {
+			std::cerr << "the cae writer needs a frame based file with a separate frame file" << std::endl;
+			return false;
+		}
+
+		base_name = _base_name;
+		if (!file.open(base_name + ".caf", positional_file::OM_CREATE))
+			return false;
+
+		// start a new file with the current format and attributes
+		nr_points = 0;
+		nr_groups = 0;
+		nr_time_steps = 0;
+		times.clear();
+		time_step_start.clear();
+		frame_offsets.clear();
+		attribute_ranges.clear();
+		if (coordinate_intervals)
+			type_inits[format.point_coord_type](coordinate_intervals, 6);
+		{
+			std::lock_guard<std::mutex> lock(decoded_frame_mutex);
+			decoded_frame.clear();
+			decoded_frame_index = UINT32_MAX;
+		}
+
+		buffer_size = std::max(buffer_alignment, (_buffer_size + buffer_alignment - 1) / buffer_alignment * buffer_alignment);
+		buffer_storage.resize(buffer_size + buffer_alignment);
+		uintptr_t address = reinterpret_cast<uintptr_t>(buffer_storage.data());
+		buffer = buffer_storage.data() + (buffer_alignment - address % buffer_alignment) % buffer_alignment;
+		buffer_fill = 0;
+		buffer_offset = 0;
+		frame_offset = 0;
+
+		stop = false;
+		failed = false;
+		if (write_in_background)
+			worker = std::thread(&binary_writer::work, this);
+		return true;
+	}
+
+	/// append a time step, the frame is copied and written in the background; return false if writing a previous
+	/// frame failed
+	template <typename P, typename I, typename A>
+	bool append_time_step(float time,
+		const std::vector<cgv::math::fvec<P, 3> >& points,
+		const std::vector<I>& group_indices,
+		const std::vector<A>& attr_values, bool update_statistics = true)
+	{
+		assert(points.size() == group_indices.size());
+		assert(nr_attributes*points.size() == attr_values.size());
+
+		if (!is_open())
+			return false;
+
+		// without a worker the frame is written right away from the data of the caller
+		if (!worker.joinable()) {
+			if (failed)
+				return false;
+
+			add_time_step(time, points.size());
+			if (update_statistics)
+				update_statistics_of_time_step(points.data(), group_indices.data(), attr_values.data(), points.size());
+			failed = !write_frame_void([this](const void* data, size_t size) { return write_buffered(data, size); }, frame_offset,
+				points.size(), points.data(), coordinate_traits<P>::type, group_indices.data(), coordinate_traits<I>::type,
+				attr_values.data(), coordinate_traits<A>::type);
+			return !failed;
+		}
+
+		std::unique_ptr<job> j;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (failed)
+				return false;
+
+			// wait while the worker is behind
+			cv.wait(lock, [&] { return pending.size() < max_nr_pending_jobs || failed; });
+			if (failed)
+				return false;
+
+			if (spare.empty())
+				j.reset(new job());
+			else {
+				j = std::move(spare.back());
+				spare.pop_back();
+			}
+		}
+
+		j->cnt = points.size();
+		j->points.assign(reinterpret_cast<const uint8_t*>(points.data()), reinterpret_cast<const uint8_t*>(points.data() + points.size()));
+		j->group_indices.assign(reinterpret_cast<const uint8_t*>(group_indices.data()), reinterpret_cast<const uint8_t*>(group_indices.data() + group_indices.size()));
+		j->attr_values.assign(reinterpret_cast<const uint8_t*>(attr_values.data()), reinterpret_cast<const uint8_t*>(attr_values.data() + attr_values.size()));
+		j->pnt_type = coordinate_traits<P>::type;
+		j->grp_type = coordinate_traits<I>::type;
+		j->att_type = coordinate_traits<A>::type;
+		j->update_statistics = update_statistics ? &binary_writer::update_statistics_of_job<P, I, A> : NULL;
+
+		add_time_step(time, points.size());
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.push_back(std::move(j));
+		}
+		cv.notify_all();
+		return true;
+	}
+
+	/// wait until all appended frames are written to the buffer
+	bool wait()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&] { return (pending.empty() && !busy) || !worker.joinable(); });
+		return !failed;
+	}
+
+	/// write all appended frames and the header and close the frame file; return whether everything was written
+	bool close()
+	{
+		if (!is_open())
+			return false;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		cv.notify_all();
+		if (worker.joinable())
+			worker.join();
+
+		bool success = !failed && flush(true);
+		file.close();
+		spare.clear();
+		buffer_storage.clear();
+		buffer_storage.shrink_to_fit();
+		buffer = NULL;
+
+		return write_header(base_name + ".cae") && success;
+	}
+};
+
+}
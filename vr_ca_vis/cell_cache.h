@@ -0,0 +1,386 @@
+// Binary cache of all time steps loaded from a directory of Morpheus snapshots
+//
+// The cache of <base> consists of three files:
+//  <base>.cae/.caf        lattice nodes per time step, group index is the index of the cell inside its time step
+//  <base>.cells.cae/.caf  cell centers per time step, group index is the cell id, attributes are the cell type, the
+//                         number of nodes and the properties of the cell padded to the largest property count
+//  <base>.cai             text index with lattice extent, cell types and size and modification time of every
+//                         snapshot the cache was built from
+// The index is written last and removed first, so an interrupted write never leaves a valid looking cache behind.
+//
+// Usage:
+// if (!cell_cache::is_valid(base, file_names) || !cell_cache::read(base, cells, time_step_start, times, extent)) {
+//    // parse snapshots
+//    cell_cache::write(base, file_names, cells, time_step_start, times, extent);
+// }
+
+#pragma once
+
+#include <cgv/render/render_types.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cae_file_format.h"
+#include "cae_mapped_file.h"
+#include "cae_writer.h"
+#include "cell_data.h"
+#include "file_stamp.h"
+
+class cell_cache : public cgv::render::render_types
+{
+private:
+	static const int version = 1;
+
+	/// content of the text index
+	struct index
+	{
+		ivec3 extent = ivec3(100);
+		std::vector<cell_type> types;
+		std::vector<file_stamp> snapshots;
+	};
+
+	static std::string get_index_file_name(const std::string& base_name)
+	{
+		return base_name + ".cai";
+	}
+
+	static bool read_index(const std::string& base_name, index& idx)
+	{
+		std::ifstream is(get_index_file_name(base_name));
+		if (!is.is_open())
+			return false;
+
+		std::string line;
+		std::string magic;
+		int file_version;
+		if (!std::getline(is, line) || !(std::istringstream(line) >> magic >> file_version) || magic != "cae_cache" || file_version != version)
+			return false;
+
+		std::string keyword;
+		if (!std::getline(is, line) || !(std::istringstream(line) >> keyword >> idx.extent[0] >> idx.extent[1] >> idx.extent[2]) || keyword != "extent")
+			return false;
+
+		// cell types are stored one per line as tab separated name, class and properties
+		size_t nr_types;
+		if (!std::getline(is, line) || !(std::istringstream(line) >> keyword >> nr_types) || keyword != "types")
+			return false;
+
+		for (size_t i = 0; i < nr_types; ++i) {
+			if (!std::getline(is, line))
+				return false;
+
+			std::vector<std::string> fields;
+			std::istringstream ls(line);
+			std::string field;
+			while (std::getline(ls, field, '\t'))
+				fields.push_back(field);
+
+			if (fields.size() < 2)
+				return false;
+
+			cell_type type(fields[0], fields[1]);
+			for (size_t j = 2; j < fields.size(); ++j)
+				type.add_property(fields[j]);
+
+			idx.types.push_back(type);
+		}
+
+		// snapshots are stored as size, modification time and file name
+		size_t nr_snapshots;
+		if (!std::getline(is, line) || !(std::istringstream(line) >> keyword >> nr_snapshots) || keyword != "snapshots")
+			return false;
+
+		for (size_t i = 0; i < nr_snapshots; ++i) {
+			if (!std::getline(is, line))
+				return false;
+
+			size_t first_tab = line.find('\t');
+			size_t second_tab = line.find('\t', first_tab + 1);
+			if (first_tab == std::string::npos || second_tab == std::string::npos)
+				return false;
+
+			file_stamp stamp;
+			if (!(std::istringstream(line.substr(0, second_tab)) >> stamp.size >> stamp.modification_time))
+				return false;
+
+			stamp.file_name = line.substr(second_tab + 1);
+			idx.snapshots.push_back(stamp);
+		}
+
+		return true;
+	}
+
+	static bool write_index(const std::string& base_name, const index& idx)
+	{
+		std::ofstream os(get_index_file_name(base_name));
+		if (!os.is_open())
+			return false;
+
+		os << "cae_cache " << version << "\n";
+		os << "extent " << idx.extent[0] << " " << idx.extent[1] << " " << idx.extent[2] << "\n";
+
+		os << "types " << idx.types.size() << "\n";
+		for (const auto& type : idx.types) {
+			os << type.name << "\t" << type.cell_class;
+			for (const auto& property : type.properties)
+				os << "\t" << property;
+			os << "\n";
+		}
+
+		os << "snapshots " << idx.snapshots.size() << "\n";
+		for (const auto& stamp : idx.snapshots)
+			os << stamp.size << "\t" << stamp.modification_time << "\t" << stamp.file_name << "\n";
+
+		return os.good();
+	}
+
+	/// create a binary file for frame based storage in a separate frame file, previous frames are removed
+	static void init_file(cae::binary_file& file, const std::string& base_name, cae::CoordinateType point_coord_type)
+	{
+		file.format.flags = cae::FF_FRAME_BASED | cae::FF_SEPARATE_FRAME_FILE;
+		file.format.point_coord_type = point_coord_type;
+		file.format.group_index_type = cae::CT_UINT32;
+		file.format.attribute_type = cae::CT_FLT32;
+
+		std::remove((base_name + ".cae").c_str());
+		std::remove((base_name + ".caf").c_str());
+	}
+
+public:
+	/// base name of the file of cell centers
+	static std::string get_cells_base_name(const std::string& base_name)
+	{
+		return base_name + ".cells";
+	}
+
+	/// remove all files of the cache
+	static void remove(const std::string& base_name)
+	{
+		std::remove(get_index_file_name(base_name).c_str());
+		std::remove((base_name + ".cae").c_str());
+		std::remove((base_name + ".caf").c_str());
+		std::remove((get_cells_base_name(base_name) + ".cae").c_str());
+		std::remove((get_cells_base_name(base_name) + ".caf").c_str());
+	}
+
+	/// check whether the cache of base_name was built from file_names and none of the files changed since
+	static bool is_valid(const std::string& base_name, const std::vector<std::string>& file_names)
+	{
+		index idx;
+		if (!read_index(base_name, idx))
+			return false;
+
+		if (idx.snapshots.size() != file_names.size())
+			return false;
+
+		for (size_t i = 0; i < file_names.size(); ++i) {
+			file_stamp stamp;
+			if (!stamp.get(file_names[i]) || !(stamp == idx.snapshots[i]))
+				return false;
+		}
+
+		return true;
+	}
+
+	/// write cells and the static node, center and property arrays of cell to the cache of base_name
+	static bool write(const std::string& base_name, const std::vector<std::string>& file_names,
+		const std::vector<cell>& cells, const std::vector<uint64_t>& time_step_start, const std::vector<float>& times, const ivec3& extent)
+	{
+		remove(base_name);
+
+		index idx;
+		idx.extent = extent;
+
+		for (const auto& file_name : file_names) {
+			file_stamp stamp;
+			if (!stamp.get(file_name))
+				return false;
+			idx.snapshots.push_back(stamp);
+		}
+
+		// cell type indices are positions in the iteration order of cell::types
+		size_t max_nr_properties = 0;
+		for (const auto& type : cell::types) {
+			idx.types.push_back(type.second);
+			max_nr_properties = std::max(max_nr_properties, type.second.properties.size());
+		}
+
+		// lattice nodes are integers, packed nodes are written as they are stored, otherwise 16 bit coordinates are
+		// used if they fit
+		cae::CoordinateType node_coord_type = cae::coordinate_traits<lattice_coordinate>::type;
+		if (!std::numeric_limits<lattice_coordinate>::is_integer) {
+			bool fits_uint16 = true;
+			for (const auto& node : cell::nodes)
+				for (int c = 0; c < 3; ++c)
+					if (node[c] < 0.f || node[c] > 65535.f)
+						fits_uint16 = false;
+			node_coord_type = fits_uint16 ? cae::CT_UINT16 : cae::CT_INT32;
+		}
+
+		// frames are converted and written in large blocks by the writers while the next frame is collected
+		cae::binary_writer nodes_file;
+		init_file(nodes_file, base_name, node_coord_type);
+
+		std::string cells_base_name = get_cells_base_name(base_name);
+		cae::binary_writer cells_file;
+		init_file(cells_file, cells_base_name, cae::CT_FLT32);
+
+		cells_file.attr_names.push_back("type");
+		cells_file.attr_names.push_back("nr_nodes");
+		for (size_t i = 0; i < max_nr_properties; ++i)
+			cells_file.attr_names.push_back("property_" + std::to_string(i));
+		cells_file.nr_attributes = uint32_t(cells_file.attr_names.size());
+
+		// the writers are closed before the files are removed, as closing writes their headers
+		auto fail = [&]() {
+			nodes_file.close();
+			cells_file.close();
+			remove(base_name);
+			return false;
+		};
+
+		if (!nodes_file.open(base_name) || !cells_file.open(cells_base_name))
+			return fail();
+
+		std::vector<lattice_node> points;
+		std::vector<uint32_t> group_indices;
+		std::vector<float> no_attr_values;
+
+		std::vector<vec3> centers;
+		std::vector<uint32_t> ids;
+		std::vector<float> attr_values;
+
+		for (size_t ti = 0; ti < times.size(); ++ti) {
+			size_t begin = size_t(time_step_start[ti]);
+			size_t end = ti + 1 < time_step_start.size() ? size_t(time_step_start[ti + 1]) : cells.size();
+
+			points.clear();
+			group_indices.clear();
+			centers.clear();
+			ids.clear();
+			attr_values.clear();
+
+			for (size_t ci = begin; ci < end; ++ci) {
+				const cell& c = cells[ci];
+
+				points.insert(points.end(), cell::nodes.begin() + c.nodes_start_index, cell::nodes.begin() + c.nodes_end_index);
+				group_indices.resize(points.size(), uint32_t(ci - begin));
+
+				centers.push_back(cell::centers[c.center_index]);
+				ids.push_back(c.id);
+
+				attr_values.push_back(float(c.type));
+				attr_values.push_back(float(c.nodes_end_index - c.nodes_start_index));
+				for (size_t pi = 0; pi < max_nr_properties; ++pi)
+					attr_values.push_back(c.properties_start_index + pi < c.properties_end_index ? cell::properties[c.properties_start_index + pi] : 0.f);
+			}
+
+			if (!nodes_file.append_time_step(times[ti], points, group_indices, no_attr_values) ||
+				!cells_file.append_time_step(times[ti], centers, ids, attr_values))
+				return fail();
+		}
+
+		bool nodes_written = nodes_file.close();
+		bool cells_written = cells_file.close();
+		if (!nodes_written || !cells_written || !write_index(base_name, idx)) {
+			remove(base_name);
+			return false;
+		}
+
+		return true;
+	}
+
+	/// read lattice extent and cell types from the index of the cache of base_name
+	static bool read_info(const std::string& base_name, ivec3& extent, std::vector<cell_type>& types)
+	{
+		index idx;
+		if (!read_index(base_name, idx))
+			return false;
+
+		extent = idx.extent;
+		types = idx.types;
+		return true;
+	}
+
+	/// decode the cells of a time step from the frames of the node and cell files into snapshot, whose extent and
+	/// types have to be set; the vectors of snapshot are reused
+	template <typename N, typename C, typename I, typename A>
+	static bool decode_time_step(const N& nodes, const C& centers, const I& ids, const A& attr_values, uint32_t nr_attributes, cell_snapshot& snapshot)
+	{
+		snapshot.cells.clear();
+		snapshot.properties.clear();
+
+		snapshot.nodes.assign(nodes.begin(), nodes.end());
+		snapshot.centers.assign(centers.begin(), centers.end());
+
+		size_t nodes_start_index = 0;
+		for (size_t ci = 0; ci < ids.size(); ++ci) {
+			const float* attrs = &attr_values[ci * nr_attributes];
+
+			size_t type_index = size_t(attrs[0]);
+			size_t nr_nodes = size_t(attrs[1]);
+			if (type_index >= snapshot.types.size() || nodes_start_index + nr_nodes > snapshot.nodes.size())
+				return false;
+
+			cell c(ids[ci], unsigned(type_index));
+			c.set_center(ci);
+			c.set_nodes(nodes_start_index, nodes_start_index + nr_nodes);
+			nodes_start_index += nr_nodes;
+
+			size_t properties_start_index = snapshot.properties.size();
+			size_t nr_properties = std::min(snapshot.types[type_index].properties.size(), size_t(nr_attributes - 2));
+			snapshot.properties.insert(snapshot.properties.end(), attrs + 2, attrs + 2 + nr_properties);
+			c.set_properties(properties_start_index, snapshot.properties.size());
+
+			snapshot.cells.push_back(c);
+		}
+
+		return true;
+	}
+
+	/// read the cache of base_name, cells are appended with cell::append
+	static bool read(const std::string& base_name, std::vector<cell>& cells, std::vector<uint64_t>& time_step_start, std::vector<float>& times, ivec3& extent)
+	{
+		index idx;
+		if (!read_index(base_name, idx))
+			return false;
+
+		std::string cells_base_name = get_cells_base_name(base_name);
+
+		// the frame files are mapped once instead of being opened for every time step
+		cae::mapped_binary_file nodes_file;
+		cae::mapped_binary_file cells_file;
+		if (!nodes_file.open(base_name) || !cells_file.open(cells_base_name))
+			return false;
+
+		if (nodes_file.nr_time_steps != cells_file.nr_time_steps || cells_file.nr_attributes < 2)
+			return false;
+
+		cell_snapshot snapshot;
+		snapshot.extent = idx.extent;
+		snapshot.types = idx.types;
+
+		cae::mapped_binary_file::frame<lattice_coordinate, uint32_t, float> nodes_frame;
+		cae::mapped_binary_file::frame<float, uint32_t, float> cells_frame;
+
+		for (uint32_t ti = 0; ti < nodes_file.nr_time_steps; ++ti) {
+			if (!nodes_file.get_time_step(ti, nodes_frame) || !cells_file.get_time_step(ti, cells_frame) ||
+				!decode_time_step(nodes_frame.points, cells_frame.points, cells_frame.group_indices, cells_frame.attributes, cells_file.nr_attributes, snapshot))
+				return false;
+
+			time_step_start.push_back(cells.size());
+			times.push_back(cells_file.times[ti]);
+
+			cell::append(snapshot, cells);
+		}
+
+		extent = idx.extent;
+		return true;
+	}
+};
@@ -1,7 +1,20 @@
 #pragma once
 
+#include <limits>
+
 #include "cell_data.h"
 
+bool lattice_fits(const cgv::math::fvec<int, 3>& extent)
+{
+	if (!std::numeric_limits<lattice_coordinate>::is_integer)
+		return true;
+
+	for (int c = 0; c < 3; ++c)
+		if (extent[c] < 0 || int64_t(extent[c]) > int64_t(std::numeric_limits<lattice_coordinate>::max()) + 1)
+			return false;
+
+	return true;
+}
 cell_type::cell_type(const std::string& _name, const std::string& _cell_class) : name(_name), cell_class(_cell_class)
 {
 
@@ -34,9 +47,89 @@ void cell::set_properties(size_t start_index, size_t end_index)
 	properties_start_index = start_index;
 	properties_end_index = end_index;
 }
+void cell::append(const cell_snapshot& snapshot, std::vector<cell>& cells)
+{
+	for (const auto& type : snapshot.types)
+		types.emplace(type.name, type);
+
+	// map cell type indices of the snapshot to indices into the global cell types
+	std::vector<unsigned int> type_indices;
+	for (const auto& type : snapshot.types)
+		type_indices.push_back(unsigned(std::distance(types.begin(), types.find(type.name))));
+
+	size_t center_offset = centers.size();
+	size_t node_offset = nodes.size();
+	size_t property_offset = properties.size();
+
+	for (cell c : snapshot.cells) {
+		c.type = type_indices[c.type];
+		c.set_center(c.center_index + center_offset);
+		c.set_nodes(c.nodes_start_index + node_offset, c.nodes_end_index + node_offset);
+		c.set_properties(c.properties_start_index + property_offset, c.properties_end_index + property_offset);
+
+		cells.push_back(c);
+	}
+
+	centers.insert(centers.end(), snapshot.centers.begin(), snapshot.centers.end());
+	nodes.insert(nodes.end(), snapshot.nodes.begin(), snapshot.nodes.end());
+	properties.insert(properties.end(), snapshot.properties.begin(), snapshot.properties.end());
+}
+
+void cell::assign(cell_snapshot& snapshot, std::vector<cell>& cells)
+{
+	for (const auto& type : snapshot.types)
+		types.emplace(type.name, type);
+
+	std::vector<unsigned int> type_indices;
+	for (const auto& type : snapshot.types)
+		type_indices.push_back(unsigned(std::distance(types.begin(), types.find(type.name))));
+
+	for (auto& c : snapshot.cells)
+		c.type = type_indices[c.type];
+
+	cells.swap(snapshot.cells);
+	centers.swap(snapshot.centers);
+	nodes.swap(snapshot.nodes);
+	properties.swap(snapshot.properties);
+}
+void cell_snapshot::append(const cell_snapshot& snapshot)
+{
+	std::vector<unsigned int> type_indices;
+	for (const auto& type : snapshot.types) {
+		size_t ti = 0;
+		while (ti < types.size() && types[ti].name != type.name)
+			++ti;
+		if (ti == types.size())
+			types.push_back(type);
+		type_indices.push_back(unsigned(ti));
+	}
+
+	size_t center_offset = centers.size();
+	size_t node_offset = nodes.size();
+	size_t property_offset = properties.size();
+
+	for (cell c : snapshot.cells) {
+		c.type = type_indices[c.type];
+		c.set_center(c.center_index + center_offset);
+		c.set_nodes(c.nodes_start_index + node_offset, c.nodes_end_index + node_offset);
+		c.set_properties(c.properties_start_index + property_offset, c.properties_end_index + property_offset);
+
+		cells.push_back(c);
+	}
+
+	centers.insert(centers.end(), snapshot.centers.begin(), snapshot.centers.end());
+	nodes.insert(nodes.end(), snapshot.nodes.begin(), snapshot.nodes.end());
+	properties.insert(properties.end(), snapshot.properties.begin(), snapshot.properties.end());
+
+	extent = snapshot.extent;
+}
+size_t cell_snapshot::get_memory() const
+{
+	return cells.size() * sizeof(cell) + centers.size() * sizeof(vec3) + nodes.size() * sizeof(lattice_node) + properties.size() * sizeof(float);
+}
 
 std::unordered_map<std::string, cell_type> cell::types;
 
 std::vector<cgv::render::render_types::vec3> cell::centers;
-std::vector<cgv::render::render_types::vec3> cell::nodes;
+std::vector<lattice_node> cell::nodes;
 std::vector<float> cell::properties;
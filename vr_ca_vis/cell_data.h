@@ -2,8 +2,25 @@
 
 #include <cgv/render/render_types.h>
 
+#include <cstdint>
 #include <unordered_map>
 
+// Lattice nodes are integer coordinates and are stored as vec3 by default. Defining CELL_NODE_BITS as 16 or 8 stores
+// them as packed triples of uint16_t or uint8_t instead, in memory, in the cell cache and in the vertex buffer of the
+// nodes. The vertex shader of the nodes reads them as uvec3 and converts them to float. The lattice then has to fit
+// into 65536 or 256 nodes per dimension.
+#if defined(CELL_NODE_BITS) && CELL_NODE_BITS == 16
+typedef uint16_t lattice_coordinate;
+#elif defined(CELL_NODE_BITS) && CELL_NODE_BITS == 8
+typedef uint8_t lattice_coordinate;
+#else
+typedef float lattice_coordinate;
+#endif
+typedef cgv::math::fvec<lattice_coordinate, 3> lattice_node;
+
+/// whether all nodes of a lattice of the given extent can be stored as lattice_node
+bool lattice_fits(const cgv::math::fvec<int, 3>& extent);
+
 struct cell_type
 {
 	std::string name;		// CellTypes > CellType name
@@ -15,12 +32,14 @@ struct cell_type
 	void add_property(const std::string& property);
 };
 
+struct cell_snapshot;
+
 struct cell : public cgv::render::render_types
 {
 	static std::unordered_map<std::string, cell_type> types;
 
 	static std::vector<vec3> centers;
-	static std::vector<vec3> nodes;
+	static std::vector<lattice_node> nodes;
 	static std::vector<float> properties;
 
 	unsigned int id;					// CellPopulations > Population > Cell id
@@ -38,4 +57,31 @@ struct cell : public cgv::render::render_types
 	void set_center(size_t index);
 	void set_nodes(size_t start_index, size_t end_index);
 	void set_properties(size_t start_index, size_t end_index);
+
+	/// append the cells of a snapshot to cells and its nodes, centers and properties to the static arrays
+	static void append(const cell_snapshot& snapshot, std::vector<cell>& cells);
+	/// replace cells and the static arrays by the content of a snapshot, the vectors are swapped so that the previous
+	/// content is left in the snapshot
+	static void assign(cell_snapshot& snapshot, std::vector<cell>& cells);
+};
+
+// Cells of a single snapshot file together with their own nodes, centers and properties. The cell type indices and
+// the index ranges of the cells refer to the vectors of the snapshot, so that snapshots can be parsed independently.
+struct cell_snapshot : public cgv::render::render_types
+{
+	ivec3 extent;
+
+	std::vector<cell_type> types;
+
+	std::vector<cell> cells;
+
+	std::vector<vec3> centers;
+	std::vector<lattice_node> nodes;
+	std::vector<float> properties;
+
+	/// append the cells of another snapshot, cell types are merged by name
+	void append(const cell_snapshot& snapshot);
+
+	/// number of bytes of the cells, centers, nodes and properties
+	size_t get_memory() const;
 };
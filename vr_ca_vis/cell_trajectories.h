@@ -0,0 +1,119 @@
+// Index of the cells of all time steps by cell id
+//
+// Cells of different time steps are only linked by their id. The index maps every id to the cells with this id in
+// time step order, so that the trajectory of a cell and the time series of its properties are gathered from the
+// cells of the time steps it is part of without scanning the cells of the other ones. The cells of a time step are
+// added with add_cells, which also extends the last time step when it grows.
+//
+// Entries refer to cells by their index, the center index, node range and property range of the cell give its data.
+// The index therefore stays valid as long as cells are only appended.
+//
+// Usage:
+// cell_trajectories trajectories;
+// trajectories.build(cells, time_step_start);
+// std::vector<vec3> centers;
+// trajectories.get_centers(id, cells, centers);
+
+#pragma once
+
+#include <cgv/render/render_types.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "cell_data.h"
+
+class cell_trajectories : public cgv::render::render_types
+{
+public:
+	/// cell with a given id in one time step
+	struct entry
+	{
+		uint32_t time_step;
+		size_t cell_index;
+	};
+
+private:
+	std::unordered_map<unsigned int, std::vector<entry>> entries;
+	size_t nr_entries = 0;
+
+public:
+	void clear()
+	{
+		entries.clear();
+		nr_entries = 0;
+	}
+
+	/// add the cells [begin, end) of time step ti, time steps have to be added in increasing order
+	void add_cells(uint32_t ti, const std::vector<cell>& cells, size_t begin, size_t end)
+	{
+		for (size_t ci = begin; ci < end; ++ci)
+			entries[cells[ci].id].push_back({ ti, ci });
+		nr_entries += end - begin;
+	}
+
+	/// index all time steps, time step ti consists of the cells [time_step_start[ti], time_step_start[ti + 1])
+	void build(const std::vector<cell>& cells, const std::vector<uint64_t>& time_step_start)
+	{
+		clear();
+		// the number of ids is about the number of cells of a time step
+		entries.reserve(time_step_start.size() > 1 ? size_t(time_step_start[1]) : cells.size());
+		for (size_t ti = 0; ti < time_step_start.size(); ++ti) {
+			size_t end = ti + 1 < time_step_start.size() ? size_t(time_step_start[ti + 1]) : cells.size();
+			add_cells(uint32_t(ti), cells, size_t(time_step_start[ti]), end);
+		}
+	}
+
+	size_t get_nr_ids() const
+	{
+		return entries.size();
+	}
+
+	size_t get_nr_entries() const
+	{
+		return nr_entries;
+	}
+
+	/// cells with the given id in time step order, empty if the id is unknown
+	const std::vector<entry>& get_entries(unsigned int id) const
+	{
+		static const std::vector<entry> no_entries;
+		auto it = entries.find(id);
+		return it == entries.end() ? no_entries : it->second;
+	}
+
+	/// position of time step ti in the entries of id or SIZE_MAX if the cell is not part of it
+	size_t find(unsigned int id, uint32_t ti) const
+	{
+		const std::vector<entry>& es = get_entries(id);
+		auto it = std::lower_bound(es.begin(), es.end(), ti, [](const entry& e, uint32_t t) { return e.time_step < t; });
+		return it == es.end() || it->time_step != ti ? SIZE_MAX : size_t(it - es.begin());
+	}
+
+	/// centers of the cell with the given id in time step order
+	void get_centers(unsigned int id, const std::vector<cell>& cells, std::vector<vec3>& centers) const
+	{
+		const std::vector<entry>& es = get_entries(id);
+		centers.resize(es.size());
+		for (size_t i = 0; i < es.size(); ++i)
+			centers[i] = cell::centers[cells[es[i].cell_index].center_index];
+	}
+
+	/// values of the property with the given index into the properties of the cell in time step order, time steps in
+	/// which the cell has less properties are skipped
+	void get_property_series(unsigned int id, size_t property, const std::vector<cell>& cells,
+		std::vector<uint32_t>& time_steps, std::vector<float>& values) const
+	{
+		time_steps.clear();
+		values.clear();
+		for (const entry& e : get_entries(id)) {
+			const cell& c = cells[e.cell_index];
+			if (c.properties_start_index + property < c.properties_end_index) {
+				time_steps.push_back(e.time_step);
+				values.push_back(cell::properties[c.properties_start_index + property]);
+			}
+		}
+	}
+};
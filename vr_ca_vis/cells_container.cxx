@@ -4,6 +4,7 @@
 #include <cgv/math/proximity.h>
 #include <cgv/math/intersection.h>
 #include <cgv/math/ftransform.h>
+#include <type_traits>
 
 #include "grid_traverser.h"
 
@@ -479,7 +480,7 @@ bool cells_container::compute_intersection(const vec3& ray_start, const vec3& ra
 		if (visibilities[c.id] < 1) continue;
 
 		// ignore if cell is clipped by any clipping planes
-		vec3 node = cell::nodes[c.nodes_start_index + node_index];
+		vec3 node(cell::nodes[c.nodes_start_index + node_index]);
 		vec4 node4 = node.lift();
 
 		bool clipped = false;
@@ -506,7 +507,7 @@ bool cells_container::compute_intersection(const vec3& ray_start, const vec3& ra
 			}
 		}
 
-		vec4 position_downscaled4(scale_matrix * cell::nodes[c.nodes_start_index + node_index].lift());
+		vec4 position_downscaled4(scale_matrix * node.lift());
 		vec3 position_downscaled(position_downscaled4 / position_downscaled4.w());
 
 		vec4 extent_downscaled4(scale_matrix * extent.lift());
@@ -760,6 +761,24 @@ void cells_container::set_cell_types(const std::unordered_map<std::string, cell_
 		++type_index;
 	}
 }
+void prepared_cells::prepare(const std::vector<cell>& cells, const std::vector<lattice_node>& nodes, size_t _cells_start, size_t _cells_end, const cgv::render::render_types::ivec3& _extents)
+{
+	cells_start = _cells_start;
+	cells_end = _cells_end;
+	extents = _extents;
+
+	grid.build_from_vertices_sync(cells, nodes, cells_start, cells_end, extents);
+
+	center_ids.clear();
+	node_ids.clear();
+
+	for (size_t i = cells_start; i < cells_end; ++i) {
+		const auto& c = cells[i];
+
+		center_ids.push_back(c.id);
+		node_ids.insert(node_ids.end(), c.nodes_end_index - c.nodes_start_index, c.id);
+	}
+}
 void cells_container::set_cells(const std::vector<cell>* _cells, size_t _cells_start, size_t _cells_end, const ivec3& extents)
 {
 	grid.cancel_build_from_vertices();
@@ -770,6 +789,7 @@ void cells_container::set_cells(const std::vector<cell>* _cells, size_t _cells_s
 	cells_end = _cells_end;
 
 	cells_out_of_date = true;
+	has_prepared_ids = false;
 
 	grid.build_from_vertices(cells, cells_start, cells_end, extents);
 
@@ -779,6 +799,27 @@ void cells_container::set_cells(const std::vector<cell>* _cells, size_t _cells_s
 
 	interpolate_colors();
 }
+void cells_container::set_cells(const std::vector<cell>* _cells, prepared_cells& prepared)
+{
+	grid.swap(prepared.grid, _cells);
+
+	cells = _cells;
+
+	cells_start = prepared.cells_start;
+	cells_end = prepared.cells_end;
+
+	cells_out_of_date = true;
+
+	prepared_center_ids.swap(prepared.center_ids);
+	prepared_node_ids.swap(prepared.node_ids);
+	has_prepared_ids = true;
+
+	visibilities.resize(cells_end - cells_start, 1);
+
+	show_checks.resize(cells_end - cells_start, 1);
+
+	interpolate_colors();
+}
 void cells_container::unset_cells()
 {
 	grid.cancel_build_from_vertices();
@@ -918,7 +959,7 @@ void cells_container::peel(size_t cell_index, size_t node_index)
 void cells_container::transmit_cells(cgv::render::context& ctx)
 {
 	std::vector<unsigned int> center_ids, node_ids;
-	std::vector<vec3> node_positions;
+	std::vector<lattice_node> node_positions;
 
 	center_ids.resize(cells_end - cells_start);
 
@@ -930,7 +971,12 @@ void cells_container::transmit_cells(cgv::render::context& ctx)
 		nodes_end_index = (*cells)[cells_end - 1].nodes_end_index;
 	}
 
-	if (peeled_cell_indices.empty()) {
+	if (peeled_cell_indices.empty() && has_prepared_ids) {
+		center_ids.swap(prepared_center_ids);
+		node_ids.swap(prepared_node_ids);
+		has_prepared_ids = false;
+	}
+	else if (peeled_cell_indices.empty()) {
 		for (size_t i = cells_start; i < cells_end; ++i) {
 			const auto& c = (*cells)[i];
 
@@ -984,7 +1030,7 @@ void cells_container::transmit_cells(cgv::render::context& ctx)
 			if (!vb_nodes.is_created())
 				vb_nodes.create(ctx, node_positions);
 			else
-				vb_nodes.replace(ctx, 0, &node_positions, nodes_count);
+				vb_nodes.replace(ctx, 0, &node_positions[0], nodes_count);
 		}
 
 		if (!vb_colors.is_created())
@@ -1026,7 +1072,9 @@ void cells_container::set_nodes_geometry(cgv::render::context& ctx, clipped_box_
 	if (nodes_count > 0) {
 		br.set_visibilities_index_array<unsigned int>(ctx, vb_node_indices, 0, nodes_count);
 		br.set_group_index_array<unsigned int>(ctx, vb_node_indices, 0, nodes_count);
-		br.set_position_array<vec3>(ctx, vb_nodes, 0, nodes_count);
+		// packed lattice nodes are converted to float by the vertex shader
+		br.set_packed_positions(!std::is_floating_point<lattice_coordinate>::value);
+		br.set_position_array<lattice_node>(ctx, vb_nodes, 0, nodes_count);
 		br.set_color_array<rgba>(ctx, vb_colors, 0, nodes_count);
 	}
 }
@@ -28,6 +28,22 @@ public:
 	virtual void on_cell_pointed_at(size_t cell_index, size_t node_index, const cgv::render::render_types::rgb& color = cgv::render::render_types::rgb()) = 0;
 };
 
+/// grid and vertex ids of a range of cells, prepared away from the render thread so that showing them only swaps
+/// pointers and uploads the buffers
+struct prepared_cells
+{
+	size_t cells_start = 0, cells_end = 0;
+	cgv::render::render_types::ivec3 extents;
+
+	regular_grid<cell> grid;
+
+	std::vector<unsigned int> center_ids;
+	std::vector<unsigned int> node_ids;
+
+	/// build the grid and the id arrays of cells [cells_start, cells_end) whose nodes are in nodes
+	void prepare(const std::vector<cell>& cells, const std::vector<lattice_node>& nodes, size_t _cells_start, size_t _cells_end, const cgv::render::render_types::ivec3& _extents);
+};
+
 class cells_container :
 	public cgv::base::node,
 	public cgv::render::drawable,
@@ -107,6 +123,11 @@ protected:
 
 	bool cells_out_of_date = true;
 
+	// id arrays of prepared cells that replace the computation in transmit_cells
+	bool has_prepared_ids = false;
+	std::vector<unsigned int> prepared_center_ids;
+	std::vector<unsigned int> prepared_node_ids;
+
 	// vertex buffer
 	size_t cells_count = 0;
 	size_t nodes_count = 0;
@@ -184,6 +205,8 @@ public:
 	void set_scale_matrix(const mat4& _scale_matrix);
 	void set_cell_types(const std::unordered_map<std::string, cell_type>& _cell_types);
 	void set_cells(const std::vector<cell>* _cells, size_t _cells_start, size_t _cells_end, const ivec3& extents);
+	/// show prepared cells, the grid and the id arrays are taken over from prepared
+	void set_cells(const std::vector<cell>* _cells, prepared_cells& prepared);
 	void unset_cells();
 
 	/// clipping planes
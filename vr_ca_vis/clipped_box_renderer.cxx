@@ -23,6 +23,8 @@ clipped_box_renderer::clipped_box_renderer()
 	burn = false;
 	burn_outside = false;
 	burn_distance = 0;
+
+	packed_positions = false;
 }
 bool clipped_box_renderer::validate_attributes(const cgv::render::context& ctx) const
 {
@@ -37,6 +39,12 @@ bool clipped_box_renderer::validate_attributes(const cgv::render::context& ctx)
 	}
 	return res;
 }
+void clipped_box_renderer::update_defines(cgv::render::shader_define_map& defines)
+{
+	box_renderer::update_defines(defines);
+	// integer attributes are bound with glVertexAttribIPointer and need an integer input
+	defines["PACKED_POSITIONS"] = packed_positions ? "1" : "0";
+}
 bool clipped_box_renderer::build_shader_program(cgv::render::context& ctx, cgv::render::shader_program& prog, const cgv::render::shader_define_map& defines)
 {
 	return prog.build_program(ctx, "clipped_box.glpr", true, defines);
@@ -76,6 +84,10 @@ void clipped_box_renderer::set_visibilities_index_array(const cgv::render::conte
 	has_visibility_indices = true;
 	set_attribute_array(ctx, "visibility_index", element_type, vbo, offset_in_bytes, nr_elements, stride_in_bytes);
 }
+void clipped_box_renderer::set_packed_positions(bool _packed_positions)
+{
+	packed_positions = _packed_positions;
+}
 void clipped_box_renderer::set_clipping_planes(const std::vector<vec4>& _clipping_planes)
 {
 	num_clipping_planes = std::min(_clipping_planes.size(), MAX_CLIPPING_PLANES);
@@ -36,6 +36,10 @@ protected:
 	vec3 burn_center;
 	float burn_distance;
 
+	bool packed_positions;
+
+	/// select the position input of the vertex shader
+	void update_defines(cgv::render::shader_define_map& defines);
 	/// build clipped_box program
 	bool build_shader_program(cgv::render::context& ctx, cgv::render::shader_program& prog, const cgv::render::shader_define_map& defines);
 public:
@@ -60,6 +64,9 @@ public:
 	template <typename T>
 	void set_visibilities(const cgv::render::context& ctx, const T* visibilities, size_t nr_elements) { has_visibilities = true; ref_prog().set_uniform_array(ctx, "visibilities", visibilities, nr_elements); }
 
+	/// positions are given as unsigned integer triples, which the vertex shader converts to float
+	void set_packed_positions(bool _packed_positions);
+
 	void set_clipping_planes(const std::vector<vec4>& _clipping_planes);
 
 	void set_torch(bool _burn, bool _burn_outside, const vec3& _burn_center, float _burn_distance);
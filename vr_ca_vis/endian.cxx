@@ -1,3 +1,17 @@
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define ENDIAN_AVX2
+#include <immintrin.h>
+#elif defined(__SSSE3__) || defined(__AVX__)
+#define ENDIAN_SSSE3
+#include <tmmintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENDIAN_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "endian.h"
 
 /// return endianess of current machine
@@ -7,68 +21,144 @@ Endian get_endian()
 	return Endian(reinterpret_cast<uint8_t&>(i));
 }
 
-/// runtime mapping of source and target arguments for endianess conversion
-void map_convert_endian(void* values, size_t cnt, Endian src, Endian tar, uint32_t type_size)
+namespace {
+
+#if defined(ENDIAN_AVX2) || defined(ENDIAN_SSSE3)
+/// byte shuffle of 16 bytes that reverses values of type_size bytes
+__m128i get_reverse_mask(uint32_t type_size)
 {
-	if (src == tar)
-		return;
-	if (type_size == 1)
-		return;
-	switch (src) {
-	case E_LITTLE:
-		switch (tar) {
-		case E_BIG_32: 
-			switch (type_size) {
-			case 2: convert_endian<E_LITTLE, E_BIG_32, 2>(values, cnt); break;
-			case 4: convert_endian<E_LITTLE, E_BIG_32, 4>(values, cnt); break;
-			case 8: convert_endian<E_LITTLE, E_BIG_32, 8>(values, cnt); break;
-			}
-			break;
-		case E_BIG_64: 
-			switch (type_size) {
-			case 2: convert_endian<E_LITTLE, E_BIG_64, 2>(values, cnt); break;
-			case 4: convert_endian<E_LITTLE, E_BIG_64, 4>(values, cnt); break;
-			case 8: convert_endian<E_LITTLE, E_BIG_64, 8>(values, cnt); break;
-			}
-			break;
-		}
-		break;
-	case E_BIG_32:
-		switch (tar) {
-		case E_LITTLE: 
-			switch (type_size) {
-			case 2: convert_endian<E_BIG_32, E_LITTLE, 2>(values, cnt); break;
-			case 4: convert_endian<E_BIG_32, E_LITTLE, 4>(values, cnt); break;
-			case 8: convert_endian<E_BIG_32, E_LITTLE, 8>(values, cnt); break;
-			}
-			break;
-		case E_BIG_64: 
-			switch (type_size) {
-			case 2: convert_endian<E_BIG_32, E_BIG_64, 2>(values, cnt); break;
-			case 4: convert_endian<E_BIG_32, E_BIG_64, 4>(values, cnt); break;
-			case 8: convert_endian<E_BIG_32, E_BIG_64, 8>(values, cnt); break;
-			}
-			break;
-		}
-		break;
-	case E_BIG_64:
-		switch (tar) {
-		case E_LITTLE: 
-			switch (type_size) {
-			case 2: convert_endian<E_BIG_64, E_LITTLE, 2>(values, cnt); break;
-			case 4: convert_endian<E_BIG_64, E_LITTLE, 4>(values, cnt); break;
-			case 8: convert_endian<E_BIG_64, E_LITTLE, 8>(values, cnt); break;
-			}
-			break;
-		case E_BIG_32: 
-			switch (type_size) {
-			case 2: convert_endian<E_BIG_64, E_BIG_32, 2>(values, cnt); break;
-			case 4: convert_endian<E_BIG_64, E_BIG_32, 4>(values, cnt); break;
-			case 8: convert_endian<E_BIG_64, E_BIG_32, 8>(values, cnt); break;
-			}
-			break;
+	int8_t mask[16];
+	for (int i = 0; i < 16; ++i)
+		mask[i] = int8_t(i - i % int(type_size) + int(type_size) - 1 - i % int(type_size));
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+}
+#elif defined(ENDIAN_SSE2)
+/// reverse the bytes of the 16 bit values in x
+__m128i reverse_16(__m128i x)
+{
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+/// reverse the bytes of the 32 bit values in x
+__m128i reverse_32(__m128i x)
+{
+	x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+	return reverse_16(x);
+}
+#endif
+
+template <typename T>
+T reverse_value(T value)
+{
+	uint8_t* bytes = reinterpret_cast<uint8_t*>(&value);
+	for (size_t i = 0; 2 * i < sizeof(T); ++i)
+		std::swap(bytes[i], bytes[sizeof(T) - i - 1]);
+	return value;
+}
+
+/// scalar conversion of the values that do not fill a vector, memcpy avoids unaligned accesses
+template <typename T>
+void reverse_values(const uint8_t* src, uint8_t* dst, size_t cnt)
+{
+	for (size_t i = 0; i < cnt; ++i) {
+		T value;
+		memcpy(&value, src + i * sizeof(T), sizeof(T));
+		value = reverse_value(value);
+		memcpy(dst + i * sizeof(T), &value, sizeof(T));
+	}
+}
+
+}
+
+void reverse_bytes(const void* src, void* dst, size_t cnt, uint32_t type_size)
+{
+	const uint8_t* src_bytes = static_cast<const uint8_t*>(src);
+	uint8_t* dst_bytes = static_cast<uint8_t*>(dst);
+	size_t nr_bytes = cnt * type_size;
+	size_t i = 0;
+
+	// every vector is loaded before it is stored, so the conversion works in place
+#if defined(ENDIAN_AVX2)
+	__m128i mask_128 = get_reverse_mask(type_size);
+	__m256i mask = _mm256_broadcastsi128_si256(mask_128);
+	for (; i + 32 <= nr_bytes; i += 32) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src_bytes + i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_bytes + i), _mm256_shuffle_epi8(x, mask));
+	}
+	for (; i + 16 <= nr_bytes; i += 16) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_bytes + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst_bytes + i), _mm_shuffle_epi8(x, mask_128));
+	}
+#elif defined(ENDIAN_SSSE3)
+	__m128i mask = get_reverse_mask(type_size);
+	for (; i + 16 <= nr_bytes; i += 16) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_bytes + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst_bytes + i), _mm_shuffle_epi8(x, mask));
+	}
+#elif defined(ENDIAN_SSE2)
+	for (; i + 16 <= nr_bytes; i += 16) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_bytes + i));
+		switch (type_size) {
+		case 2: x = reverse_16(x); break;
+		case 4: x = reverse_32(x); break;
+		case 8: x = reverse_32(_mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1))); break;
 		}
-		break;
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst_bytes + i), x);
+	}
+#endif
+
+	size_t rest = (nr_bytes - i) / type_size;
+	switch (type_size) {
+	case 2: reverse_values<uint16_t>(src_bytes + i, dst_bytes + i, rest); break;
+	case 4: reverse_values<uint32_t>(src_bytes + i, dst_bytes + i, rest); break;
+	case 8: reverse_values<uint64_t>(src_bytes + i, dst_bytes + i, rest); break;
+	}
+}
+
+void swap_words(const void* src, void* dst, size_t cnt)
+{
+	const uint8_t* src_bytes = static_cast<const uint8_t*>(src);
+	uint8_t* dst_bytes = static_cast<uint8_t*>(dst);
+	size_t i = 0;
+
+#if defined(ENDIAN_AVX2)
+	for (; i + 4 <= cnt; i += 4) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src_bytes + 8 * i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_bytes + 8 * i), _mm256_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
 	}
+#elif defined(ENDIAN_SSSE3) || defined(ENDIAN_SSE2)
+	for (; i + 2 <= cnt; i += 2) {
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_bytes + 8 * i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst_bytes + 8 * i), _mm_shuffle_epi32(x, _MM_SHUFFLE(2, 3, 0, 1)));
+	}
+#endif
+
+	for (; i < cnt; ++i) {
+		uint32_t words[2];
+		memcpy(words, src_bytes + 8 * i, 8);
+		std::swap(words[0], words[1]);
+		memcpy(dst_bytes + 8 * i, words, 8);
+	}
+}
+
+void map_convert_endian(const void* src_values, void* dst_values, size_t cnt, Endian src, Endian tar, uint32_t type_size)
+{
+	if (src == tar || type_size == 1 || (src > E_LITTLE && tar > E_LITTLE && type_size != 8)) {
+		// the big endian variants only differ in the order of the halves of 64 bit values
+		if (src_values != dst_values)
+			memmove(dst_values, src_values, cnt * type_size);
+		return;
+	}
+	if (src > E_LITTLE && tar > E_LITTLE)
+		swap_words(src_values, dst_values, cnt);
+	else if ((src == E_BIG_32 || tar == E_BIG_32) && type_size == 8)
+		// E_BIG_32 stores 64 bit values as two big endian 32 bit values in little endian order
+		reverse_bytes(src_values, dst_values, 2 * cnt, 4);
+	else
+		reverse_bytes(src_values, dst_values, cnt, type_size);
 }
 
+/// runtime mapping of source and target arguments for endianess conversion
+void map_convert_endian(void* values, size_t cnt, Endian src, Endian tar, uint32_t type_size)
+{
+	map_convert_endian(values, values, cnt, src, tar, type_size);
+}
@@ -41,40 +41,21 @@ void convert_endian(T& value)
 	}
 }
 
+/// reverse the bytes of each of cnt values with type_size 2, 4 or 8 bytes from src to dst, which may be the same array
+extern void reverse_bytes(const void* src, void* dst, size_t cnt, uint32_t type_size);
+
+/// swap the 32 bit halves of cnt 64 bit values from src to dst, which may be the same array
+extern void swap_words(const void* src, void* dst, size_t cnt);
+
+/// runtime mapping of source and target arguments for endianess conversion of cnt values from src_values to
+/// dst_values, which may be the same array; the values are copied if no conversion is needed
+extern void map_convert_endian(const void* src_values, void* dst_values, size_t cnt, Endian src, Endian tar, uint32_t type_size);
+
 /// endianess conversion function for arrays templated over type size, source and target endianess
 template <Endian src, Endian tar, uint32_t type_size>
 void convert_endian(void* values, size_t cnt)
 {
-	if (src == tar)
-		return;
-	if (type_size == 1)
-		return;
-	if (src > E_LITTLE && tar > E_LITTLE) {
-		if (type_size == 8) {
-			uint64_t* ui64_ptr = reinterpret_cast<uint64_t*>(&values);
-			for (size_t i = 0; i < cnt; ++i) {
-				uint32_t* ui32_ptr = reinterpret_cast<uint32_t*>(&ui64_ptr[i]);
-				std::swap(ui32_ptr[0], ui32_ptr[1]);
-			}
-		}
-	}
-	else {
-		if ((src == E_BIG_32 || tar == E_BIG_32) && (type_size == 8)) {
-			uint64_t* ui64_ptr = reinterpret_cast<uint64_t*>(&values);
-			for (size_t i = 0; i < cnt; ++i) {
-				uint32_t* ui32_ptr = reinterpret_cast<uint32_t*>(&ui64_ptr[i]);
-				convert_endian<src, tar>(ui32_ptr[0]);
-				convert_endian<src, tar>(ui32_ptr[1]);
-			}
-		}
-		else {
-			for (size_t i = 0; i < cnt; ++i) {
-				uint8_t* byte_ptr = reinterpret_cast<uint8_t*>(values) + i * type_size;
-				for (size_t j = 0; 2 * j < type_size; ++j)
-					std::swap(byte_ptr[j], byte_ptr[type_size - j - 1]);
-			}
-		}
-	}
+	map_convert_endian(values, values, cnt, src, tar, type_size);
 }
 
 /// specialization for fvec types
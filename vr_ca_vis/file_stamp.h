@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <sys/stat.h>
+
+/// size and modification time of a file, used to detect whether derived files like caches are outdated
+struct file_stamp
+{
+	std::string file_name;
+	uint64_t size = 0;
+	int64_t modification_time = 0;
+
+	/// read the stamp of file_name, return false if the file does not exist
+	bool get(const std::string& _file_name)
+	{
+#ifdef _WIN32
+		struct _stat64 info;
+		if (_stat64(_file_name.c_str(), &info) != 0)
+			return false;
+#else
+		struct stat info;
+		if (stat(_file_name.c_str(), &info) != 0)
+			return false;
+#endif
+		file_name = _file_name;
+		size = uint64_t(info.st_size);
+		modification_time = int64_t(info.st_mtime);
+		return true;
+	}
+
+	bool operator==(const file_stamp& other) const
+	{
+		return file_name == other.file_name && size == other.size && modification_time == other.modification_time;
+	}
+};
@@ -0,0 +1,247 @@
+// Lazily loaded time steps of a directory of Morpheus snapshots
+//
+// The directory is indexed up front by file name and time only, snapshots of the same time form one time step. A
+// time step is parsed when it is requested for the first time and kept in a least recently used cache of decoded
+// frames, so the memory held is bounded by the capacity times the size of a frame instead of the whole simulation.
+// Frames are shared and immutable, a frame that is evicted stays valid as long as it is referenced.
+//
+// All functions may be called from multiple threads. Parsing is done outside of the lock, so different time steps
+// can be loaded concurrently.
+//
+// Usage:
+// frame_cache frames;
+// frames.index(file_names);
+// std::shared_ptr<const frame_cache::frame> f = frames.get(ti);
+// for (const auto& snapshot : f->snapshots)
+//    cell::append(*snapshot, cells);
+
+#pragma once
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cell_data.h"
+#include "snapshot_loader.h"
+
+class frame_cache
+{
+public:
+	/// decoded snapshots of one time step
+	struct frame
+	{
+		std::vector<std::unique_ptr<cell_snapshot>> snapshots;
+		size_t memory = 0;
+	};
+
+	/// snapshot files of one time step
+	struct time_step
+	{
+		float time = 0.f;
+		std::vector<std::string> file_names;
+	};
+
+private:
+	struct entry
+	{
+		std::shared_ptr<const frame> data;
+		// position in the list of recently used time steps
+		std::list<size_t>::iterator position;
+	};
+
+	mutable std::mutex mutex;
+
+	std::vector<time_step> steps;
+
+	size_t capacity;
+	size_t memory = 0;
+
+	// most recently used time step first
+	std::list<size_t> recently_used;
+	std::unordered_map<size_t, entry> frames;
+
+	/// remove least recently used frames beyond capacity, the frame of ti is kept
+	void evict(size_t ti)
+	{
+		while (frames.size() > capacity && !recently_used.empty() && recently_used.back() != ti) {
+			auto it = frames.find(recently_used.back());
+			memory -= it->second.data->memory;
+			frames.erase(it);
+			recently_used.pop_back();
+		}
+	}
+
+	/// insert or replace the frame of ti and mark it as most recently used
+	void insert(size_t ti, const std::shared_ptr<const frame>& data)
+	{
+		auto it = frames.find(ti);
+		if (it != frames.end()) {
+			memory -= it->second.data->memory;
+			recently_used.erase(it->second.position);
+			frames.erase(it);
+		}
+
+		recently_used.push_front(ti);
+		frames[ti] = { data, recently_used.begin() };
+		memory += data->memory;
+
+		evict(ti);
+	}
+
+public:
+	frame_cache(size_t _capacity = 8) : capacity(_capacity)
+	{
+	}
+
+	/// remove the index and all frames
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		steps.clear();
+		frames.clear();
+		recently_used.clear();
+		memory = 0;
+	}
+
+	/// add a snapshot file to the index, a file with the time of the last time step is added to it; return the index
+	/// of the time step
+	size_t add_file(const std::string& file_name, float time)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (steps.empty() || steps.back().time != time) {
+			steps.emplace_back();
+			steps.back().time = time;
+		}
+		steps.back().file_names.push_back(file_name);
+		return steps.size() - 1;
+	}
+
+	/// add an already parsed snapshot file, the cached frame of its time step is extended if present
+	size_t add_snapshot(const std::string& file_name, float time, std::unique_ptr<cell_snapshot> snapshot)
+	{
+		size_t ti = add_file(file_name, time);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = frames.find(ti);
+		if (it == frames.end() && steps[ti].file_names.size() > 1)
+			return ti;
+
+		// frames are immutable, a grown frame replaces the cached one
+		std::shared_ptr<frame> data(new frame());
+		if (it != frames.end()) {
+			for (const auto& s : it->second.data->snapshots)
+				data->snapshots.emplace_back(new cell_snapshot(*s));
+			data->memory = it->second.data->memory;
+		}
+		data->memory += snapshot->get_memory();
+		data->snapshots.push_back(std::move(snapshot));
+
+		insert(ti, data);
+		return ti;
+	}
+
+	/// index the given snapshot files in order, files without a time in their name are skipped; return whether
+	/// there is at least one time step
+	bool index(const std::vector<std::string>& file_names)
+	{
+		clear();
+
+		for (const auto& file_name : file_names) {
+			float time;
+			if (snapshot_loader::get_time(file_name, time))
+				add_file(file_name, time);
+		}
+
+		return get_nr_time_steps() > 0;
+	}
+
+	size_t get_nr_time_steps() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return steps.size();
+	}
+
+	float get_time(size_t ti) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return steps[ti].time;
+	}
+
+	/// maximum number of cached frames
+	size_t get_capacity() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return capacity;
+	}
+
+	void set_capacity(size_t _capacity)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		capacity = std::max(size_t(1), _capacity);
+		evict(recently_used.empty() ? size_t(-1) : recently_used.front());
+	}
+
+	/// number of bytes of all cached frames
+	size_t get_memory() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return memory;
+	}
+
+	size_t get_nr_frames() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return frames.size();
+	}
+
+	bool is_cached(size_t ti) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return frames.find(ti) != frames.end();
+	}
+
+	/// return the frame of time step ti, parse its snapshots if it is not cached; return nullptr if ti is invalid or
+	/// a snapshot cannot be read, in which case nothing is cached and the next call tries again
+	std::shared_ptr<const frame> get(size_t ti, unsigned nr_inflate_threads = 1)
+	{
+		std::vector<std::string> file_names;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (ti >= steps.size())
+				return nullptr;
+
+			auto it = frames.find(ti);
+			if (it != frames.end()) {
+				recently_used.splice(recently_used.begin(), recently_used, it->second.position);
+				return it->second.data;
+			}
+
+			file_names = steps[ti].file_names;
+		}
+
+		std::shared_ptr<frame> data(new frame());
+		for (const auto& file_name : file_names) {
+			std::unique_ptr<cell_snapshot> snapshot(new cell_snapshot());
+			if (!snapshot_loader::read(file_name, *snapshot, nr_inflate_threads).valid)
+				return nullptr;
+			data->memory += snapshot->get_memory();
+			data->snapshots.push_back(std::move(snapshot));
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		// another thread may have loaded the same time step in the meantime
+		auto it = frames.find(ti);
+		if (it != frames.end()) {
+			recently_used.splice(recently_used.begin(), recently_used, it->second.position);
+			return it->second.data;
+		}
+
+		insert(ti, data);
+		return data;
+	}
+};
@@ -0,0 +1,166 @@
+// Index of access points into the deflate stream of a gzip file
+//
+// Following the approach of zran.c from the zlib examples, an access point is recorded at a deflate block boundary
+// every span bytes of uncompressed output. It stores the uncompressed and compressed offsets, the number of bits of
+// the block that start in the preceding byte and the last 32 KB of uncompressed data, which is all that is needed to
+// resume inflation at that point. The index is stored next to the gzip file and is only valid for single member gzip
+// files.
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "endian.h"
+#include "file_stamp.h"
+
+/// size of the deflate history window
+#define GZIP_WINDOW_SIZE 32768
+
+struct gzip_access_point
+{
+	// offset into the uncompressed data
+	uint64_t out;
+	// offset of the byte containing the first bit of the block in the compressed file
+	uint64_t in;
+	// number of bits of the block in the byte before in, 0 if the block starts at a byte boundary
+	int bits;
+	// up to GZIP_WINDOW_SIZE bytes of uncompressed data preceding out
+	std::vector<unsigned char> window;
+};
+
+class gzip_index
+{
+private:
+	static const uint32_t version = 1;
+
+	/// write or read a single value
+	template <typename T>
+	static bool write_value(FILE* fp, const T& value)
+	{
+		return fwrite(&value, sizeof(T), 1, fp) == 1;
+	}
+	template <typename T>
+	static bool read_value(FILE* fp, T& value)
+	{
+		return fread(&value, sizeof(T), 1, fp) == 1;
+	}
+
+public:
+	/// gzip file the index was built for
+	file_stamp stamp;
+	/// minimum distance of access points in uncompressed bytes
+	uint64_t span = 0;
+	/// total number of uncompressed bytes
+	uint64_t length = 0;
+	/// access points in increasing order
+	std::vector<gzip_access_point> points;
+
+	static std::string get_index_file_name(const std::string& file_name)
+	{
+		return file_name + ".gzi";
+	}
+
+	/// number of uncompressed bytes from access point i to the next one or to the end of the data
+	uint64_t get_segment_size(size_t i) const
+	{
+		return (i + 1 < points.size() ? points[i + 1].out : length) - points[i].out;
+	}
+
+	void add_point(uint64_t out, uint64_t in, int bits, const unsigned char* window, size_t window_size)
+	{
+		gzip_access_point point;
+		point.out = out;
+		point.in = in;
+		point.bits = bits;
+		point.window.assign(window, window + window_size);
+		points.push_back(point);
+	}
+
+	void clear()
+	{
+		stamp = file_stamp();
+		length = 0;
+		points.clear();
+	}
+
+	/// read the index stored next to file_name, fails if it is missing or the gzip file changed since
+	bool read(const std::string& file_name)
+	{
+		clear();
+
+		file_stamp current;
+		if (!current.get(file_name))
+			return false;
+
+		FILE* fp = fopen(get_index_file_name(file_name).c_str(), "rb");
+		if (!fp)
+			return false;
+
+		char magic[4];
+		uint8_t endian;
+		uint32_t file_version;
+		uint64_t nr_points;
+
+		bool success = fread(magic, 1, 4, fp) == 4 && memcmp(magic, "gzi ", 4) == 0 &&
+			read_value(fp, endian) && endian == uint8_t(get_endian()) &&
+			read_value(fp, file_version) && file_version == version &&
+			read_value(fp, stamp.size) && read_value(fp, stamp.modification_time) &&
+			read_value(fp, span) && read_value(fp, length) && read_value(fp, nr_points);
+
+		stamp.file_name = file_name;
+		success = success && stamp == current;
+
+		for (uint64_t i = 0; success && i < nr_points; ++i) {
+			gzip_access_point point;
+			uint8_t bits;
+			uint32_t window_size;
+			success = read_value(fp, point.out) && read_value(fp, point.in) && read_value(fp, bits) &&
+				read_value(fp, window_size) && window_size <= GZIP_WINDOW_SIZE;
+
+			if (success) {
+				point.bits = bits;
+				point.window.resize(window_size);
+				success = window_size == 0 || fread(&point.window[0], 1, window_size, fp) == window_size;
+				points.push_back(point);
+			}
+		}
+
+		fclose(fp);
+
+		if (!success)
+			clear();
+
+		return success;
+	}
+
+	/// store the index next to file_name
+	bool write(const std::string& file_name) const
+	{
+		FILE* fp = fopen(get_index_file_name(file_name).c_str(), "wb");
+		if (!fp)
+			return false;
+
+		bool success = fwrite("gzi ", 1, 4, fp) == 4 &&
+			write_value(fp, uint8_t(get_endian())) && write_value(fp, uint32_t(version)) &&
+			write_value(fp, stamp.size) && write_value(fp, stamp.modification_time) &&
+			write_value(fp, span) && write_value(fp, length) && write_value(fp, uint64_t(points.size()));
+
+		for (size_t i = 0; success && i < points.size(); ++i) {
+			const gzip_access_point& point = points[i];
+			success = write_value(fp, point.out) && write_value(fp, point.in) && write_value(fp, uint8_t(point.bits)) &&
+				write_value(fp, uint32_t(point.window.size())) &&
+				(point.window.empty() || fwrite(&point.window[0], 1, point.window.size(), fp) == point.window.size());
+		}
+
+		success = fclose(fp) == 0 && success;
+
+		if (!success)
+			std::remove(get_index_file_name(file_name).c_str());
+
+		return success;
+	}
+};
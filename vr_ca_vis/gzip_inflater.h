@@ -3,149 +3,244 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
+#include <string>
+#include <vector>
 #include "zlib.h"
 
-#if defined(MSDOS) || defined(OS2) || defined(WIN32) || defined(__CYGWIN__)
-#  include <fcntl.h>
-#  include <io.h>
-#  define SET_BINARY_MODE(file) _setmode(_fileno(file), O_BINARY)
-#else
-#  define SET_BINARY_MODE(file)
-#endif
+#include "gzip_index.h"
+#include "xml_scanner.h"
 
 #define CHUNK 16384
 
-class gzip_inflater
+// Inflate a gzip file chunk by chunk in memory. The inflated chunks are handed out as xml_source, so that snapshots
+// can be parsed without writing the uncompressed file to disk. Memory is bounded by the size of the input and output
+// buffers independent of the size of the file. Optionally an index of access points is built on the way, which
+// allows to inflate the file in parallel later on.
+class gzip_inflater : public xml_source
 {
-public:
-	//gzip_inflater() = delete;
-	//gzip_inflater(const gzip_inflater&) = delete;
-
-    gzip_inflater(const std::string& in_file_name, const std::string& out_file_name)
-    {
-        FILE *input = fopen(in_file_name.c_str(), "rb");
-        FILE* output = fopen(out_file_name.c_str(), "w+");
-
-        /* avoid end-of-line conversions */
-		(void)SET_BINARY_MODE(input);
-		(void)SET_BINARY_MODE(output);
+private:
+	std::string file_name;
+	FILE* input;
+	z_stream strm;
+
+	std::vector<unsigned char> in;
+	std::vector<char> out;
+
+	bool initialized = false;
+	bool finished = false;
+
+	int ret = Z_OK;
+
+	// index construction
+	gzip_index* index = NULL;
+	uint64_t total_in = 0;
+	uint64_t total_out = 0;
+	uint64_t last_point_out = 0;
+
+	// ring buffer with the last GZIP_WINDOW_SIZE bytes of uncompressed data
+	std::vector<unsigned char> window;
+	size_t window_pos = 0;
+	size_t window_fill = 0;
+
+	void update_window(const unsigned char* data, size_t size)
+	{
+		if (size == 0)
+			return;
+
+		if (size >= window.size()) {
+			memcpy(&window[0], data + size - window.size(), window.size());
+			window_pos = 0;
+			window_fill = window.size();
+			return;
+		}
+
+		size_t first = std::min(size, window.size() - window_pos);
+		memcpy(&window[window_pos], data, first);
+		memcpy(&window[0], data + first, size - first);
+
+		window_pos = (window_pos + size) % window.size();
+		window_fill = std::min(window_fill + size, window.size());
+	}
+
+	void add_access_point(int bits)
+	{
+		// bring the ring buffer into order
+		std::vector<unsigned char> history(window_fill);
+		if (window_fill < window.size())
+			memcpy(history.data(), &window[0], window_fill);
+		else if (window_fill > 0) {
+			memcpy(history.data(), &window[window_pos], window.size() - window_pos);
+			memcpy(history.data() + window.size() - window_pos, &window[0], window_pos);
+		}
+
+		index->add_point(total_out, total_in, bits, history.data(), history.size());
+		last_point_out = total_out;
+	}
+
+	/* inflate one step and record an access point if a deflate block ended far enough behind the last one */
+	int inflate_step()
+	{
+		if (!index)
+			return inflate(&strm, Z_NO_FLUSH);
+
+		uInt avail_in_before = strm.avail_in;
+		uInt avail_out_before = strm.avail_out;
+		const unsigned char* out_before = strm.next_out;
+
+		/* Z_BLOCK stops at the end of each deflate block */
+		int result = inflate(&strm, Z_BLOCK);
+
+		total_in += avail_in_before - strm.avail_in;
+		size_t produced = avail_out_before - strm.avail_out;
+		update_window(out_before, produced);
+		total_out += produced;
+
+		/* bit 7 of data_type marks the end of a block header, bit 6 the last block */
+		if ((strm.data_type & 128) && !(strm.data_type & 64) && (index->points.empty() || total_out - last_point_out > index->span))
+			add_access_point(strm.data_type & 7);
+
+		return result;
+	}
 
-        int ret = inf(input, output);
-		if (ret != Z_OK)
+public:
+	gzip_inflater() = delete;
+	gzip_inflater(const gzip_inflater&) = delete;
+
+	gzip_inflater(const std::string& _file_name, size_t chunk_size = 64 * CHUNK) : file_name(_file_name), in(4 * CHUNK), out(chunk_size)
+	{
+		input = fopen(file_name.c_str(), "rb");
+		if (!input)
+			return;
+
+		/* allocate inflate state, 16 + MAX_WBITS only accepts gzip streams */
+		strm.zalloc = Z_NULL;
+		strm.zfree = Z_NULL;
+		strm.opaque = Z_NULL;
+		strm.avail_in = 0;
+		strm.next_in = Z_NULL;
+		ret = inflateInit2(&strm, 16 + MAX_WBITS);
+		if (ret != Z_OK) {
 			zerr(ret);
-
-        fclose(input);
-        fclose(output);
-    }
-
-    /* Decompress from file source to file dest until stream ends or EOF.
-       inf() returns Z_OK on success, Z_MEM_ERROR if memory could not be
-       allocated for processing, Z_DATA_ERROR if the deflate data is
-       invalid or incomplete, Z_VERSION_ERROR if the version of zlib.h and
-       the version of the library linked do not match, or Z_ERRNO if there
-       is an error reading or writing the files. */
-    int inf(FILE* source, FILE* dest)
-    {
-        int ret;
-        unsigned have;
-        z_stream *strm = new z_stream;
-        unsigned char *in = new unsigned char[CHUNK];
-        unsigned char *out = new unsigned char[CHUNK];
-
-        /* allocate inflate state */
-        strm->zalloc = Z_NULL;
-        strm->zfree = Z_NULL;
-        strm->opaque = Z_NULL;
-        strm->avail_in = 0;
-        strm->next_in = Z_NULL;
-        ret = inflateInit2(strm, 16 + MAX_WBITS);
-        if (ret != Z_OK)
-        {
-            delete strm;
-            delete[] in;
-            delete[] out;
-
-            return ret;
-        }
-
-        /* decompress until deflate stream ends or end of file */
-        do {
-            strm->avail_in = fread(in, 1, CHUNK, source);
-            if (ferror(source)) {
-                (void)inflateEnd(strm);
-                delete strm;
-                delete[] in;
-                delete[] out;
-
-                return Z_ERRNO;
-            }
-            if (strm->avail_in == 0)
-                break;
-            strm->next_in = in;
-
-            /* run inflate() on input until output buffer not full */
-            do {
-                strm->avail_out = CHUNK;
-                strm->next_out = out;
-                ret = inflate(strm, Z_NO_FLUSH);
-                assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-                switch (ret) {
-                case Z_NEED_DICT:
-                    ret = Z_DATA_ERROR;     /* and fall through */
-                case Z_DATA_ERROR:
-                case Z_MEM_ERROR:
-                    (void)inflateEnd(strm);
-                    delete strm;
-                    delete[] in;
-                    delete[] out;
-
-                    return ret;
-                }
-                have = CHUNK - strm->avail_out;
-                if (fwrite(out, 1, have, dest) != have || ferror(dest)) {
-                    (void)inflateEnd(strm);
-                    delete strm;
-                    delete[] in;
-                    delete[] out;
-
-                    return Z_ERRNO;
-                }
-            } while (strm->avail_out == 0);
-
-            /* done when inflate() says it's done */
-        } while (ret != Z_STREAM_END);
-
-        /* clean up and return */
-        (void)inflateEnd(strm);
-        delete strm;
-        delete[] in;
-        delete[] out;
-
-        return ret == Z_STREAM_END ? Z_OK : Z_DATA_ERROR;
-    }
-
-    /* report a zlib or i/o error */
-    void zerr(int ret)
-    {
-        fputs("zpipe: ", stderr);
-        switch (ret) {
-        case Z_ERRNO:
-            if (ferror(stdin))
-                fputs("error reading stdin\n", stderr);
-            if (ferror(stdout))
-                fputs("error writing stdout\n", stderr);
-            break;
-        case Z_STREAM_ERROR:
-            fputs("invalid compression level\n", stderr);
-            break;
-        case Z_DATA_ERROR:
-            fputs("invalid or incomplete deflate data\n", stderr);
-            break;
-        case Z_MEM_ERROR:
-            fputs("out of memory\n", stderr);
-            break;
-        case Z_VERSION_ERROR:
-            fputs("zlib version mismatch!\n", stderr);
-        }
-    }
+			return;
+		}
+
+		initialized = true;
+	}
+
+	~gzip_inflater()
+	{
+		if (initialized)
+			(void)inflateEnd(&strm);
+		if (input)
+			fclose(input);
+	}
+
+	/* record access points into _index while inflating, has to be called before the first chunk is requested */
+	void build_index(gzip_index& _index, uint64_t span = uint64_t(16) << 20)
+	{
+		index = &_index;
+		index->clear();
+		index->span = span;
+		window.resize(GZIP_WINDOW_SIZE);
+	}
+
+	/* true if the index was built from the whole file */
+	bool is_index_complete() const
+	{
+		return index != NULL && finished && get_status() == Z_OK && !index->points.empty();
+	}
+
+	bool is_open() const
+	{
+		return input != NULL && initialized;
+	}
+
+	/* Z_OK after the stream ended properly, otherwise the zlib or i/o error that stopped inflation */
+	int get_status() const
+	{
+		return ret == Z_STREAM_END ? Z_OK : ret;
+	}
+
+	/* Decompress until the output chunk is full or the stream ends. Concatenated gzip members are inflated one after
+	   the other. Returns false at the end of the stream or if an error occurred. */
+	bool next_chunk(const char*& data, size_t& size)
+	{
+		if (!is_open() || finished)
+			return false;
+
+		strm.next_out = reinterpret_cast<Bytef*>(&out[0]);
+		strm.avail_out = uInt(out.size());
+
+		while (strm.avail_out > 0) {
+			if (strm.avail_in == 0) {
+				strm.avail_in = uInt(fread(&in[0], 1, in.size(), input));
+				if (ferror(input)) {
+					ret = Z_ERRNO;
+					break;
+				}
+				if (strm.avail_in == 0) {
+					/* end of file is only fine directly after the end of a gzip member */
+					if (ret != Z_STREAM_END)
+						ret = Z_DATA_ERROR;
+					break;
+				}
+				strm.next_in = &in[0];
+			}
+			else if (ret == Z_STREAM_END) {
+				/* another gzip member follows, which the index does not support */
+				if (index) {
+					index->clear();
+					index = NULL;
+				}
+				ret = inflateReset(&strm);
+				if (ret != Z_OK)
+					break;
+			}
+
+			ret = inflate_step();
+			assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+			if (ret == Z_NEED_DICT)
+				ret = Z_DATA_ERROR;
+			if (ret == Z_DATA_ERROR || ret == Z_MEM_ERROR)
+				break;
+		}
+
+		if (strm.avail_out > 0) {
+			finished = true;
+			if (get_status() != Z_OK)
+				zerr(get_status());
+			else if (index) {
+				index->length = total_out;
+				index->stamp.get(file_name);
+			}
+		}
+
+		data = &out[0];
+		size = out.size() - strm.avail_out;
+
+		return size > 0;
+	}
+
+	/* report a zlib or i/o error */
+	static void zerr(int ret)
+	{
+		fputs("gzip_inflater: ", stderr);
+		switch (ret) {
+		case Z_ERRNO:
+			fputs("error reading file\n", stderr);
+			break;
+		case Z_STREAM_ERROR:
+			fputs("invalid compression level\n", stderr);
+			break;
+		case Z_DATA_ERROR:
+			fputs("invalid or incomplete deflate data\n", stderr);
+			break;
+		case Z_MEM_ERROR:
+			fputs("out of memory\n", stderr);
+			break;
+		case Z_VERSION_ERROR:
+			fputs("zlib version mismatch!\n", stderr);
+		}
+	}
 };
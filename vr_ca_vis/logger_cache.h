@@ -0,0 +1,354 @@
+// Columnar binary cache of a Morpheus logger.csv
+//
+// The cache stores every column of the logger contiguously with its own type, columns that only contain integers in
+// the range of int32 are stored as CT_INT32, all others as CT_FLT64. A small header lists name, type and offset of
+// every column and the size and modification time of the csv file it was converted from. Columns start at multiples
+// of 64 bytes.
+//
+// The reader maps the whole cache and hands out columns as spans into the mapping, so columns are not copied and only
+// the pages of columns that are accessed are read from disk.
+//
+// Usage:
+// std::string cache_file_name = logger_cache::get_cache_file_name(<csv_file_name>);
+// if (!logger_cache::is_valid(cache_file_name, <csv_file_name>))
+//    logger_cache::convert(<csv_file_name>, cache_file_name);
+//
+// logger_cache cache;
+// if (cache.open(cache_file_name)) {
+//    logger_cache::column_span<double> time = cache.get_column<double>("time");
+//    for (double t : time) ...
+// }
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "cae_file_format.h"
+#include "endian.h"
+#include "file_stamp.h"
+#include "logger_parser.h"
+#include "mapped_file.h"
+
+class logger_cache
+{
+public:
+	/// typed view of a column inside the mapping
+	template <typename T>
+	struct column_span
+	{
+		const T* data = NULL;
+		size_t size = 0;
+
+		const T* begin() const
+		{
+			return data;
+		}
+		const T* end() const
+		{
+			return data + size;
+		}
+		const T& operator[](size_t i) const
+		{
+			return data[i];
+		}
+		bool empty() const
+		{
+			return size == 0;
+		}
+	};
+
+	struct column
+	{
+		std::string name;
+		cae::CoordinateType type = cae::CT_FLT64;
+		uint64_t offset = 0;
+	};
+
+private:
+	static const uint32_t version = 1;
+	// alignment of column offsets
+	static const uint64_t alignment = 64;
+	// number of rows buffered per column while converting
+	static const size_t block_size = size_t(1) << 16;
+
+	mapped_file file;
+	const char* data = NULL;
+
+	file_stamp stamp;
+	uint64_t nr_rows = 0;
+	std::vector<column> columns;
+
+	template <typename T>
+	static bool write_value(FILE* fp, const T& value)
+	{
+		return fwrite(&value, sizeof(T), 1, fp) == 1;
+	}
+
+	template <typename T>
+	static bool read_value(const char*& p, const char* e, T& value)
+	{
+		if (size_t(e - p) < sizeof(T))
+			return false;
+		memcpy(&value, p, sizeof(T));
+		p += sizeof(T);
+		return true;
+	}
+
+	static bool seek(FILE* fp, uint64_t offset)
+	{
+#ifdef _WIN32
+		return _fseeki64(fp, int64_t(offset), SEEK_SET) == 0;
+#else
+		return fseeko(fp, off_t(offset), SEEK_SET) == 0;
+#endif
+	}
+
+	static uint64_t align(uint64_t offset)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	static bool write_header(FILE* fp, const file_stamp& stamp, uint64_t nr_rows, const std::vector<column>& columns)
+	{
+		bool success = fwrite("lgc ", 1, 4, fp) == 4 &&
+			write_value(fp, uint8_t(get_endian())) && write_value(fp, uint32_t(version)) &&
+			write_value(fp, stamp.size) && write_value(fp, stamp.modification_time) &&
+			write_value(fp, nr_rows) && write_value(fp, uint32_t(columns.size()));
+
+		for (size_t i = 0; success && i < columns.size(); ++i) {
+			const column& c = columns[i];
+			success = write_value(fp, uint32_t(c.name.size())) && fwrite(c.name.data(), 1, c.name.size(), fp) == c.name.size() &&
+				write_value(fp, uint8_t(c.type)) && write_value(fp, c.offset);
+		}
+
+		return success;
+	}
+
+	static uint64_t get_header_size(const std::vector<column>& columns)
+	{
+		uint64_t size = 4 + sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(int64_t) + sizeof(uint64_t) + sizeof(uint32_t);
+		for (const auto& c : columns)
+			size += sizeof(uint32_t) + c.name.size() + sizeof(uint8_t) + sizeof(uint64_t);
+		return size;
+	}
+
+	/// write the buffered values of a column as type T at row index first_row
+	template <typename T>
+	static bool write_block(FILE* fp, const column& c, uint64_t first_row, const std::vector<double>& values)
+	{
+		std::vector<T> converted(values.begin(), values.end());
+		return seek(fp, c.offset + first_row * sizeof(T)) &&
+			(converted.empty() || fwrite(converted.data(), sizeof(T), converted.size(), fp) == converted.size());
+	}
+
+public:
+	logger_cache(const logger_cache&) = delete;
+	logger_cache& operator=(const logger_cache&) = delete;
+
+	logger_cache()
+	{
+	}
+
+	static std::string get_cache_file_name(const std::string& csv_file_name)
+	{
+		return csv_file_name + ".lgc";
+	}
+
+	/// check whether the cache was converted from csv_file_name and the csv file did not change since
+	static bool is_valid(const std::string& cache_file_name, const std::string& csv_file_name)
+	{
+		file_stamp current;
+		if (!current.get(csv_file_name))
+			return false;
+
+		logger_cache cache;
+		return cache.open(cache_file_name) && cache.stamp.size == current.size && cache.stamp.modification_time == current.modification_time;
+	}
+
+	/// convert all columns of csv_file_name to the cache cache_file_name
+	///
+	/// The csv file is parsed twice, first to count the rows and to find the integer columns, then to write the
+	/// columns block by block, so the memory used does not depend on the number of rows.
+	static bool convert(const std::string& csv_file_name, const std::string& cache_file_name)
+	{
+		file_stamp csv_stamp;
+		if (!csv_stamp.get(csv_file_name))
+			return false;
+
+		std::vector<column> columns;
+		uint64_t nr_rows = 0;
+		{
+			logger_parser lp(csv_file_name);
+			std::vector<std::string> names = lp.get_header_names();
+			if (names.empty())
+				return false;
+			lp.read_header(names);
+
+			std::vector<bool> is_integer(names.size(), true);
+			std::vector<double> values;
+			while (lp.read_values(values)) {
+				for (size_t i = 0; i < values.size(); ++i)
+					if (is_integer[i] && (values[i] != std::floor(values[i]) ||
+						values[i] < double(std::numeric_limits<int32_t>::min()) || values[i] > double(std::numeric_limits<int32_t>::max())))
+						is_integer[i] = false;
+				++nr_rows;
+			}
+
+			for (size_t i = 0; i < names.size(); ++i) {
+				column c;
+				c.name = names[i];
+				c.type = is_integer[i] ? cae::CT_INT32 : cae::CT_FLT64;
+				columns.push_back(c);
+			}
+		}
+
+		uint64_t offset = align(get_header_size(columns));
+		for (auto& c : columns) {
+			c.offset = offset;
+			offset = align(offset + nr_rows * cae::type_sizes[c.type]);
+		}
+
+		FILE* fp = fopen(cache_file_name.c_str(), "wb");
+		if (!fp)
+			return false;
+
+		bool success = write_header(fp, csv_stamp, nr_rows, columns);
+
+		logger_parser lp(csv_file_name);
+		lp.read_header(lp.get_header_names());
+
+		std::vector<std::vector<double>> blocks(columns.size());
+		std::vector<double> values;
+		uint64_t first_row = 0;
+		bool more = true;
+
+		while (success && more) {
+			for (auto& block : blocks)
+				block.clear();
+
+			while (blocks[0].size() < block_size && (more = lp.read_values(values)))
+				for (size_t i = 0; i < columns.size(); ++i)
+					blocks[i].push_back(values[i]);
+
+			// the file may have grown since the rows were counted
+			size_t count = size_t(std::min(uint64_t(blocks[0].size()), nr_rows - first_row));
+			for (size_t i = 0; success && i < columns.size(); ++i) {
+				blocks[i].resize(count);
+				success = columns[i].type == cae::CT_INT32 ?
+					write_block<int32_t>(fp, columns[i], first_row, blocks[i]) :
+					write_block<double>(fp, columns[i], first_row, blocks[i]);
+			}
+			first_row += count;
+		}
+
+		success = fclose(fp) == 0 && success && first_row == nr_rows;
+
+		if (!success)
+			std::remove(cache_file_name.c_str());
+
+		return success;
+	}
+
+	/// map the cache and read its header
+	bool open(const std::string& cache_file_name)
+	{
+		close();
+
+		if (!file.open(cache_file_name) || file.get_size() == 0)
+			return false;
+
+		data = file.map(0, size_t(file.get_size()));
+		if (data == NULL) {
+			close();
+			return false;
+		}
+
+		const char* p = data;
+		const char* e = data + file.get_size();
+
+		uint8_t endian;
+		uint32_t file_version;
+		uint32_t nr_columns;
+
+		bool success = size_t(e - p) >= 4 && memcmp(p, "lgc ", 4) == 0;
+		p += 4;
+
+		success = success && read_value(p, e, endian) && endian == uint8_t(get_endian()) &&
+			read_value(p, e, file_version) && file_version == version &&
+			read_value(p, e, stamp.size) && read_value(p, e, stamp.modification_time) &&
+			read_value(p, e, nr_rows) && read_value(p, e, nr_columns);
+
+		for (uint32_t i = 0; success && i < nr_columns; ++i) {
+			column c;
+			uint32_t name_length;
+			uint8_t type = 0;
+			success = read_value(p, e, name_length) && size_t(e - p) >= name_length;
+			if (!success)
+				break;
+
+			c.name.assign(p, name_length);
+			p += name_length;
+
+			success = read_value(p, e, type) && type <= cae::CT_FLT64 && read_value(p, e, c.offset) &&
+				c.offset % alignment == 0 && (nr_rows == 0 || c.offset + nr_rows * cae::type_sizes[type] <= file.get_size());
+			c.type = cae::CoordinateType(type);
+			columns.push_back(c);
+		}
+
+		if (!success)
+			close();
+
+		return success;
+	}
+
+	void close()
+	{
+		file.close();
+		data = NULL;
+		stamp = file_stamp();
+		nr_rows = 0;
+		columns.clear();
+	}
+
+	uint64_t get_nr_rows() const
+	{
+		return nr_rows;
+	}
+
+	const std::vector<column>& get_columns() const
+	{
+		return columns;
+	}
+
+	/// index of the column with the given name or -1
+	int find_column(const std::string& name) const
+	{
+		for (size_t i = 0; i < columns.size(); ++i)
+			if (columns[i].name == name)
+				return int(i);
+		return -1;
+	}
+
+	/// span of the column with the given name, empty if there is no such column or it is not of type T
+	template <typename T>
+	column_span<T> get_column(const std::string& name) const
+	{
+		column_span<T> span;
+
+		int i = find_column(name);
+		if (i < 0 || columns[i].type != cae::coordinate_traits<T>::type)
+			return span;
+
+		span.data = reinterpret_cast<const T*>(data + columns[i].offset);
+		span.size = size_t(nr_rows);
+		return span;
+	}
+};
@@ -1,8 +1,13 @@
-// Parse logger.csv generated by Morpheus CellSorting_3D simulation, not yet optimized / checked for bugs
+// Parse logger.csv generated by Morpheus CellSorting_3D simulation
+//
+// The file is memory mapped in windows of a fixed size, so the resident memory does not depend on the size of the
+// file. Rows are split into fields in place, the fields of a row are kept in vectors that are reused for every row,
+// so reading a row does not allocate. Only a row that crosses the end of a window is copied.
 //
 // Usage:
 // logger_parser lp(<file_name>);
 // std::vector<std::string> headers = { "time", "id", "l.x", ... }; // column names does not have to be in the same order as in the csv
+// lp.read_header(headers);
 //
 // double time, x, ...;
 // int id;
@@ -11,82 +16,315 @@
 // {
 //    // process time, id, x, ...
 // }
+//
+// All remaining rows can also be parsed into columns by multiple threads at once:
+// std::vector<double> times, xs;
+// std::vector<int> ids;
+// lp.read_columns(0, times, ids, xs, ...);
 
 #pragma once
 
 #include <cgv/utils/file.h>
+#include <cgv/utils/scan.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mapped_file.h"
 
 class logger_parser
 {
 private:
-	std::string content;
+	/// size of the mapped windows
+	static const size_t window_size = size_t(64) << 20;
 
-	std::vector<cgv::utils::line> lines;
+	mapped_file file;
+
+	// file offset of the current window and the part of it that is not parsed yet
+	uint64_t window_offset = 0;
+	const char* window_begin = NULL;
+	const char* pos = NULL;
+	const char* end = NULL;
+
+	// copy of a row that crosses the end of a window
+	std::string carry;
+
+	std::string header;
 
-	int line_index;
-	
 	std::vector<std::string> column_names;
 	std::vector<int> column_orders;
+	// number of fields a row needs to contain all columns
+	size_t min_nr_fields = 0;
+
+	// fields of the current row
+	std::vector<const char*> field_begins;
+	std::vector<const char*> field_ends;
 
-	void parse(const cgv::utils::token& token, double& value)
+	size_t nr_bytes = 0;
+
+	static bool is_separator(char c)
 	{
-		cgv::utils::is_double(token.begin, token.end, value);
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
 	}
 
-	void parse(const cgv::utils::token& token, int& value)
+	/// split [b, e) at runs of separators and return the number of fields
+	static size_t split(const char* b, const char* e, std::vector<const char*>& begins, std::vector<const char*>& ends)
 	{
-		cgv::utils::is_integer(token.begin, token.end, value);
+		begins.clear();
+		ends.clear();
+
+		while (b < e) {
+			while (b < e && is_separator(*b))
+				++b;
+			if (b == e)
+				break;
+
+			begins.push_back(b);
+			while (b < e && !is_separator(*b))
+				++b;
+			ends.push_back(b);
+		}
+
+		return begins.size();
 	}
 
-	void parse_row(int column_index, const std::vector<cgv::utils::token>& tokens) {}
+	static void parse(const char* b, const char* e, double& value)
+	{
+		// strtod needs a terminated string, fields are copied to the stack instead of allocating one
+		char buffer[64];
+		size_t length = size_t(e - b);
+		if (length >= sizeof(buffer))
+			return;
+
+		memcpy(buffer, b, length);
+		buffer[length] = 0;
+
+		char* parsed_end;
+		double v = strtod(buffer, &parsed_end);
+		if (parsed_end != buffer)
+			value = v;
+	}
+
+	static void parse(const char* b, const char* e, int& value)
+	{
+		bool negative = false;
+		if (b < e && (*b == '-' || *b == '+'))
+			negative = *b++ == '-';
+
+		if (b == e || *b < '0' || *b > '9')
+			return;
+
+		// unsigned arithmetic wraps around on overflow instead of being undefined
+		unsigned v = 0;
+		while (b < e && *b >= '0' && *b <= '9')
+			v = 10 * v + unsigned(*b++ - '0');
+
+		value = int(negative ? 0u - v : v);
+	}
+
+	void parse_row(int column_index, const std::vector<const char*>& begins, const std::vector<const char*>& ends) const {}
 
 	template<class T, class ...Ts>
-	void parse_row(int column_index, const std::vector<cgv::utils::token>& tokens, T& column_type, Ts&...column_types)
+	void parse_row(int column_index, const std::vector<const char*>& begins, const std::vector<const char*>& ends, T& column_type, Ts&...column_types) const
+	{
+		int field_index = column_orders[column_index];
+		parse(begins[field_index], ends[field_index], column_type);
+
+		parse_row(column_index + 1, begins, ends, column_types...);
+	}
+
+	/// map the window starting at offset, return false at the end of the file
+	bool map_window(uint64_t offset)
+	{
+		if (offset >= file.get_size()) {
+			window_begin = pos = end = NULL;
+			return false;
+		}
+
+		window_offset = offset;
+		size_t count = size_t(std::min(uint64_t(window_size), file.get_size() - offset));
+
+		window_begin = pos = file.map(offset, count);
+		if (pos == NULL) {
+			std::cerr << "couldn't map logger file at offset " << offset << std::endl;
+			end = NULL;
+			return false;
+		}
+
+		end = pos + count;
+		nr_bytes += count;
+		return true;
+	}
+
+	/// file offset of the first character that is not parsed yet
+	uint64_t get_offset() const
 	{
-		parse(tokens[column_orders[column_index]], column_type);
+		return pos ? window_offset + uint64_t(pos - window_begin) : file.get_size();
+	}
+
+	/// return the next line without its line break in [b, e), return false at the end of the file
+	bool next_line(const char*& b, const char*& e)
+	{
+		if (pos == NULL)
+			return false;
+
+		if (pos == end && !map_window(window_offset + uint64_t(end - window_begin)))
+			return false;
+
+		const char* line_end = static_cast<const char*>(memchr(pos, '\n', end - pos));
+		if (line_end) {
+			b = pos;
+			e = line_end;
+			pos = line_end + 1;
+			return true;
+		}
+
+		// the line continues in the next window
+		carry.assign(pos, end);
+		for (;;) {
+			if (!map_window(window_offset + uint64_t(end - window_begin))) {
+				// last line without line break
+				b = carry.data();
+				e = b + carry.size();
+				return !carry.empty();
+			}
 
-		parse_row(column_index + 1, tokens, column_types...);
+			line_end = static_cast<const char*>(memchr(pos, '\n', end - pos));
+			if (line_end) {
+				carry.append(pos, line_end);
+				pos = line_end + 1;
+				b = carry.data();
+				e = b + carry.size();
+				return true;
+			}
+
+			carry.append(pos, end);
+			pos = end;
+		}
+	}
+
+	/// number of lines that parse_block visits in [b, e), which bounds the number of rows it parses
+	static size_t count_lines(const char* b, const char* e)
+	{
+		return size_t(std::count(b, e, '\n')) + (e > b && e[-1] != '\n' ? 1 : 0);
+	}
+
+	/// parse the rows in [b, e) into consecutive elements of the columns starting at values, return the number of rows
+	template<class ...Ts>
+	size_t parse_block(const char* b, const char* e, Ts*...values) const
+	{
+		std::vector<const char*> begins, ends;
+		size_t nr_rows = 0;
+
+		while (b < e) {
+			const char* line_end = static_cast<const char*>(memchr(b, '\n', e - b));
+			if (line_end == NULL)
+				line_end = e;
+
+			if (split(b, line_end, begins, ends) >= min_nr_fields) {
+				parse_row(0, begins, ends, values[nr_rows]...);
+				++nr_rows;
+			}
+
+			b = line_end < e ? line_end + 1 : e;
+		}
+
+		return nr_rows;
+	}
+
+	/// move the rows of the blocks, which start at base + block_starts[i], to consecutive elements behind base and
+	/// drop the elements of skipped lines
+	template<class T>
+	static void compact_column(std::vector<T>& column, size_t base, const std::vector<size_t>& block_starts, const std::vector<size_t>& block_nr_rows)
+	{
+		size_t nr_rows = 0;
+		for (size_t i = 0; i < block_nr_rows.size(); ++i) {
+			// the destination never lies behind the source, so moving front to back does not overwrite rows
+			T* rows = column.data() + base + block_starts[i];
+			std::move(rows, rows + block_nr_rows[i], column.data() + base + nr_rows);
+			nr_rows += block_nr_rows[i];
+		}
+		column.resize(base + nr_rows);
 	}
 
 public:
 	logger_parser() = delete;
 	logger_parser(const logger_parser&) = delete;
 
-	logger_parser(const std::string& file_name) : line_index(1)
+	logger_parser(const std::string& file_name)
 	{
-		if (!cgv::utils::file::read(file_name, content, true))
+		if (!file.open(file_name) || (file.get_size() > 0 && !map_window(0))) {
 			std::cerr << "couldn't read logger file " << file_name.c_str() << std::endl;
+			return;
+		}
 
-		cgv::utils::split_to_lines(content, lines);
+		const char* b;
+		const char* e;
+		if (next_line(b, e))
+			header.assign(b, e);
+	}
+
+	/// names of all columns in the header without quotes
+	std::vector<std::string> get_header_names() const
+	{
+		std::vector<const char*> begins, ends;
+		split(header.data(), header.data() + header.size(), begins, ends);
+
+		std::vector<std::string> names;
+		for (size_t i = 0; i < begins.size(); ++i) {
+			const char* b = begins[i];
+			const char* e = ends[i];
+
+			if (*b == '"')
+				++b;
+
+			if (e > b && e[-1] == '"')
+				--e;
+
+			names.push_back(std::string(b, e));
+		}
+
+		return names;
 	}
 
 	void read_header(const std::vector<std::string>& column_names)
 	{
 		this->column_names = column_names;
-		
+
 		column_orders.clear();
+		min_nr_fields = 0;
 
-		std::vector<cgv::utils::token> tokens;
-		cgv::utils::split_to_tokens(lines.begin()->begin, lines.begin()->end, tokens, "");
+		std::vector<const char*> begins, ends;
+		size_t nr_fields = split(header.data(), header.data() + header.size(), begins, ends);
 
 		for (unsigned int i = 0, column_count = column_names.size(); i < column_count; ++i)
 		{
-			int token_index = 0;
-			for (auto token : tokens)
+			for (size_t field_index = 0; field_index < nr_fields; ++field_index)
 			{
-				if (*token.begin == '"')
-					++token.begin;
+				const char* b = begins[field_index];
+				const char* e = ends[field_index];
+
+				if (*b == '"')
+					++b;
 
-				if (token.end > token.begin && token.end[-1] == '"')
-					--token.end;
+				if (e > b && e[-1] == '"')
+					--e;
 
-				if (to_string(token) == column_names[i])
+				if (std::string(b, e) == column_names[i])
 				{
-					column_orders.push_back(token_index);
+					column_orders.push_back(int(field_index));
+					min_nr_fields = std::max(min_nr_fields, field_index + 1);
 					break;
 				}
-
-				++token_index;
 			}
 
 			assert(column_orders.size() > i);
@@ -103,20 +341,131 @@ public:
 	{
 		assert(sizeof...(Ts) == column_orders.size());
 
-		while (line_index < lines.size())
+		const char* b;
+		const char* e;
+		while (next_line(b, e))
 		{
-			std::vector<cgv::utils::token> tokens;
-			cgv::utils::split_to_tokens(lines[line_index].begin, lines[line_index].end, tokens, "");
+			if (split(b, e, field_begins, field_ends) >= min_nr_fields && sizeof...(Ts) <= field_begins.size())
+			{
+				parse_row(0, field_begins, field_ends, column_types...);
+				return true;
+			}
+		}
 
-			++line_index;
+		return false;
+	}
 
-			if (sizeof...(Ts) <= tokens.size())
+	/// read the next row as one value per column of the header, for readers that select columns at runtime
+	bool read_values(std::vector<double>& values)
+	{
+		const char* b;
+		const char* e;
+		while (next_line(b, e))
+		{
+			if (split(b, e, field_begins, field_ends) >= min_nr_fields && column_orders.size() <= field_begins.size())
 			{
-				parse_row(0, tokens, column_types...);
+				values.resize(column_orders.size());
+				for (size_t i = 0; i < column_orders.size(); ++i) {
+					values[i] = 0.0;
+					parse(field_begins[column_orders[i]], field_ends[column_orders[i]], values[i]);
+				}
 				return true;
 			}
 		}
 
 		return false;
 	}
+
+	/// parse all remaining rows into one vector per column with nr_threads threads (0 for one per core), the rows are
+	/// split into blocks at line breaks and every block is parsed directly into its rows of the columns; return the
+	/// number of rows
+	template<class ...Ts>
+	size_t read_columns(unsigned nr_threads, std::vector<Ts>&...columns)
+	{
+		assert(sizeof...(Ts) == column_orders.size());
+
+		uint64_t offset = get_offset();
+		if (pos == NULL || offset >= file.get_size())
+			return 0;
+
+		// map the remaining rows at once, blocks are only split at line breaks
+		size_t count = size_t(file.get_size() - offset);
+		const char* data = file.map(offset, count);
+		if (data == NULL) {
+			// fall back to reading line by line in windows if the address space is too small
+			map_window(offset);
+
+			size_t nr_rows = 0;
+			const char* b;
+			const char* e;
+			while (next_line(b, e))
+			{
+				if (split(b, e, field_begins, field_ends) >= min_nr_fields)
+				{
+					(void)std::initializer_list<int>{ (columns.emplace_back(), 0)... };
+					parse_row(0, field_begins, field_ends, columns.back()...);
+					++nr_rows;
+				}
+			}
+			return nr_rows;
+		}
+		nr_bytes += count;
+
+		if (nr_threads == 0)
+			nr_threads = std::max(1u, std::thread::hardware_concurrency());
+
+		// several blocks per thread balance blocks with different row lengths
+		size_t nr_blocks = std::max(size_t(1), std::min(size_t(4) * nr_threads, count / (size_t(1) << 16)));
+
+		std::vector<const char*> block_begins(1, data);
+		for (size_t i = 1; i < nr_blocks; ++i) {
+			const char* b = std::max(block_begins.back(), data + count * i / nr_blocks);
+			const char* line_end = static_cast<const char*>(memchr(b, '\n', data + count - b));
+			if (line_end == NULL)
+				break;
+			block_begins.push_back(line_end + 1);
+		}
+		block_begins.push_back(data + count);
+		nr_blocks = block_begins.size() - 1;
+
+		// every block parses its rows directly into the columns starting behind the lines of the blocks before it,
+		// the elements of lines that are skipped are removed afterwards
+		std::vector<size_t> block_starts(nr_blocks + 1, 0);
+		for (size_t i = 0; i < nr_blocks; ++i)
+			block_starts[i + 1] = block_starts[i] + count_lines(block_begins[i], block_begins[i + 1]);
+
+		// the rows of the first block start at the former size of every column, which is its size minus the lines
+		size_t nr_lines = block_starts.back();
+		(void)std::initializer_list<int>{ (columns.resize(columns.size() + nr_lines), 0)... };
+
+		std::vector<size_t> block_nr_rows(nr_blocks, 0);
+
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < std::min(size_t(nr_threads), nr_blocks); ++t)
+			threads.emplace_back([&, t]() {
+				for (size_t i = t; i < nr_blocks; i += nr_threads)
+					block_nr_rows[i] = parse_block(block_begins[i], block_begins[i + 1],
+						(columns.data() + columns.size() - nr_lines + block_starts[i])...);
+			});
+		for (auto& thread : threads)
+			thread.join();
+
+		(void)std::initializer_list<int>{ (compact_column(columns, columns.size() - nr_lines, block_starts, block_nr_rows), 0)... };
+
+		size_t nr_rows = 0;
+		for (size_t n : block_nr_rows)
+			nr_rows += n;
+
+		// all rows are consumed
+		file.unmap();
+		pos = end = window_begin = NULL;
+
+		return nr_rows;
+	}
+
+	/// number of bytes mapped so far
+	size_t get_nr_bytes() const
+	{
+		return nr_bytes;
+	}
 };
@@ -0,0 +1,204 @@
+// Read only memory mapping of a file
+//
+// A mapped_file holds at most one view at a time. A view can cover the whole file or a window of it, mapping
+// windows one after the other keeps the resident memory bounded by the window size for files of any size.
+//
+// Usage:
+// mapped_file file;
+// if (file.open(<file_name>)) {
+//    const char* data = file.map(0, size_t(file.get_size()));
+//    // data is valid until the next call to map, unmap or close
+// }
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class mapped_file
+{
+private:
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+#else
+	int fd = -1;
+#endif
+	uint64_t size = 0;
+
+	// the view starts at a multiple of the granularity, data points to the requested offset inside of it
+	void* view = NULL;
+	size_t view_size = 0;
+	const char* data = NULL;
+	size_t data_size = 0;
+
+public:
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	mapped_file()
+	{
+	}
+	~mapped_file()
+	{
+		close();
+	}
+
+	/// alignment of view offsets required by the operating system
+	static uint64_t get_granularity()
+	{
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		GetSystemInfo(&info);
+		return info.dwAllocationGranularity;
+#else
+		return uint64_t(sysconf(_SC_PAGESIZE));
+#endif
+	}
+
+	/// open file for reading, return false if it does not exist or cannot be mapped
+	bool open(const std::string& file_name)
+	{
+		close();
+
+#ifdef _WIN32
+		file = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size)) {
+			close();
+			return false;
+		}
+		size = uint64_t(file_size.QuadPart);
+
+		// empty files cannot be mapped but are valid
+		if (size > 0) {
+			mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping == NULL) {
+				close();
+				return false;
+			}
+		}
+#else
+		fd = ::open(file_name.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0) {
+			close();
+			return false;
+		}
+		size = uint64_t(info.st_size);
+#endif
+		return true;
+	}
+
+	void close()
+	{
+		unmap();
+#ifdef _WIN32
+		if (mapping != NULL)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (fd >= 0)
+			::close(fd);
+		fd = -1;
+#endif
+		size = 0;
+	}
+
+	bool is_open() const
+	{
+#ifdef _WIN32
+		return file != INVALID_HANDLE_VALUE;
+#else
+		return fd >= 0;
+#endif
+	}
+
+	/// size of the file in bytes
+	uint64_t get_size() const
+	{
+		return size;
+	}
+
+	/// map count bytes starting at offset, the previous view is unmapped; return NULL on failure
+	const char* map(uint64_t offset, size_t count)
+	{
+		unmap();
+
+		if (!is_open() || count == 0 || offset + count > size)
+			return NULL;
+
+		uint64_t view_offset = offset - offset % get_granularity();
+		size_t skip = size_t(offset - view_offset);
+
+#ifdef _WIN32
+		view = MapViewOfFile(mapping, FILE_MAP_READ, DWORD(view_offset >> 32), DWORD(view_offset & 0xffffffff), skip + count);
+		if (view == NULL)
+			return NULL;
+#else
+		view = mmap(NULL, skip + count, PROT_READ, MAP_PRIVATE, fd, off_t(view_offset));
+		if (view == MAP_FAILED) {
+			view = NULL;
+			return NULL;
+		}
+		// views are usually read front to back once, let the kernel read ahead aggressively
+		madvise(view, skip + count, MADV_SEQUENTIAL);
+#endif
+		view_size = skip + count;
+		data = static_cast<const char*>(view) + skip;
+		data_size = count;
+
+		return data;
+	}
+
+	void unmap()
+	{
+		if (view != NULL) {
+#ifdef _WIN32
+			UnmapViewOfFile(view);
+#else
+			munmap(view, view_size);
+#endif
+		}
+		view = NULL;
+		view_size = 0;
+		data = NULL;
+		data_size = 0;
+	}
+
+	/// begin of the current view or NULL
+	const char* get_data() const
+	{
+		return data;
+	}
+
+	/// number of bytes in the current view
+	size_t get_data_size() const
+	{
+		return data_size;
+	}
+};
@@ -1,217 +1,367 @@
 #pragma once
 
 #include <cgv/render/render_types.h>
+#include <cgv/utils/scan.h>
 
-#include <fstream>
-#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
 
-#include "../3rd/rapidxml-1.13/rapidxml.hpp"
 #include "cell_data.h"
+#include "node_scanner.h"
+#include "xml_scanner.h"
 
-class model_parser : public cgv::render::render_types
+/// property symbols of a cell type interned into their slot index, looked up from tokens without building strings
+class property_symbols
 {
+	std::vector<std::string> symbols;
+	// open addressing hash table of indices into symbols, -1 marks empty buckets
+	std::vector<int> buckets;
+	size_t mask = 0;
+
+	static size_t hash(const char* b, const char* e)
+	{
+		// FNV-1a
+		uint32_t h = 2166136261u;
+		for (; b < e; ++b)
+			h = (h ^ uint8_t(*b)) * 16777619u;
+		return h;
+	}
+
 public:
-	model_parser() = delete;
-	model_parser(const model_parser&) = delete;
+	/// intern the symbols, the first of equal symbols gets the slot
+	void build(const std::vector<std::string>& _symbols)
+	{
+		symbols = _symbols;
 
-	model_parser(const std::string& file_name, ivec3& extent, std::vector<cell>& cells)
+		size_t nr_buckets = 4;
+		while (nr_buckets < 2 * symbols.size())
+			nr_buckets *= 2;
+
+		buckets.assign(nr_buckets, -1);
+		mask = nr_buckets - 1;
+
+		for (size_t i = 0; i < symbols.size(); ++i) {
+			const char* b = symbols[i].data();
+			size_t h = hash(b, b + symbols[i].size()) & mask;
+			while (buckets[h] >= 0 && symbols[buckets[h]] != symbols[i])
+				h = (h + 1) & mask;
+
+			if (buckets[h] < 0)
+				buckets[h] = int(i);
+		}
+	}
+
+	/// return the slot of the symbol in [b, e) or -1
+	int find(const char* b, const char* e) const
 	{
-		// Set lattice extent to default
-		extent.set(100, 100, 100);
-
-		// Read the xml file into a vector
-		std::ifstream file(file_name.c_str());
-		std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std:: istreambuf_iterator<char>());
-		buffer.emplace_back('\0');
-
-		// Parse the buffer using the xml file parsing library into doc 
-		rapidxml::xml_document<>* doc = new rapidxml::xml_document<>();
-		doc->parse<0>(&buffer[0]);
-		
-		// Find our root node
-		rapidxml::xml_node<>* root_node = doc->first_node("MorpheusModel");		
-		if (root_node != NULL)
-		{
-			// Check space symbol
-			rapidxml::xml_node<>* node = root_node->first_node("Space");
-			if (node != NULL &&
-			   (node = node->first_node("Lattice")) != NULL &&
-			   (node = node->first_node("Size")) != NULL)
-			{
-				std::vector<std::string> values_vector;
-
-				char* token = strtok(node->first_attribute("value")->value(), " ");
-
-				// Keep printing tokens while one of the
-				// delimiters present in str[].
-				while (token != NULL)
-				{
-					values_vector.push_back(token);
-					token = strtok(NULL, " ");
-				}
+		if (symbols.empty())
+			return -1;
+
+		size_t length = e - b;
+		for (size_t h = hash(b, e) & mask; buckets[h] >= 0; h = (h + 1) & mask) {
+			const std::string& symbol = symbols[buckets[h]];
+			if (symbol.size() == length && memcmp(symbol.data(), b, length) == 0)
+				return buckets[h];
+		}
 
-				if (values_vector.size() == 3)
-				{
-					int x, y, z;
-					if (cgv::utils::is_integer(values_vector[0], x) && cgv::utils::is_integer(values_vector[1], y) && !cgv::utils::is_integer(values_vector[2], z))
-					{
-						extent.set(x, y, z);
-					}
-				}
-			}
+		return -1;
+	}
+};
+
+class model_parser : public cgv::render::render_types
+{
+private:
+	typedef xml_scanner::tag tag;
+
+	size_t nr_bytes = 0;
+	double seconds = 0.0;
+
+	/// parse a complete floating point value, strtod needs a terminated string, so the value is copied to the stack
+	/// instead of allocating one
+	static bool parse_value(const char* b, const char* e, double& value)
+	{
+		char buffer[64];
+		size_t length = size_t(e - b);
+		if (length == 0 || length >= sizeof(buffer))
+			return false;
+
+		memcpy(buffer, b, length);
+		buffer[length] = 0;
+
+		char* parsed_end;
+		value = strtod(buffer, &parsed_end);
+		return parsed_end == buffer + length;
+	}
+
+	/// parse "x,y,z" floating point coordinates
+	static bool parse_center(const char* p, const char* e, vec3& center)
+	{
+		double values[3];
+		for (int i = 0; i < 3; ++i) {
+			const char* comma = static_cast<const char*>(memchr(p, ',', e - p));
+			const char* value_end = (i < 2) ? comma : e;
+			if (value_end == NULL)
+				return false;
+
+			const char* b = p;
+			const char* f = value_end;
+			while (b < f && node_scanner::is_separator(*b))
+				++b;
+			while (f > b && node_scanner::is_separator(f[-1]))
+				--f;
+
+			if (!cgv::utils::is_double(b, f, values[i]))
+				return false;
+
+			p = value_end + 1;
+		}
 
-			// Iterate over cell types
-			node = root_node->first_node("CellTypes");
-			if (node != NULL)
-			{
-				for (rapidxml::xml_node<>* type_node = node->first_node("CellType"); type_node != NULL; type_node = type_node->next_sibling("CellType"))
-				{
-					std::string name(type_node->first_attribute("name")->value());
-					std::string cell_class(type_node->first_attribute("class")->value());
+		center.set(float(values[0]), float(values[1]), float(values[2]));
+		return true;
+	}
+
+	void parse_cell(xml_scanner& scanner, const tag& cell_tag, const cell_type& type, const property_symbols& symbols, size_t type_index, cell_snapshot& snapshot)
+	{
+		int id;
+		cgv::utils::token id_value = cell_tag.get_attribute("id");
+		if (!cgv::utils::is_integer(id_value.begin, id_value.end, id)) {
+			scanner.skip_element(cell_tag);
+			return;
+		}
 
-					cell_type type(name, cell_class);
+		cell c(id, type_index);
 
-					for (rapidxml::xml_node<>* property_node = type_node->first_node("Property"); property_node != NULL; property_node = property_node->next_sibling("Property"))
-					{
-						type.add_property(property_node->first_attribute("symbol")->value());
-					}
+		// one property slot per property of the cell type in the order of the cell type
+		size_t properties_start_index = snapshot.properties.size();
+		snapshot.properties.resize(properties_start_index + type.properties.size(), 0.f);
 
-					cell::types.emplace(name, type);
+		vec3 center(0.f);
+
+		size_t nodes_start_index = snapshot.nodes.size();
+
+		scanner.for_each_child(cell_tag, [&](const tag& t) {
+			if (t.name == "PropertyData") {
+				cgv::utils::token symbol_ref = t.get_attribute("symbol-ref");
+
+				int i = symbols.find(symbol_ref.begin, symbol_ref.end);
+				if (i >= 0) {
+					cgv::utils::token value = t.get_attribute("value");
+
+					double property;
+					if (parse_value(value.begin, value.end, property))
+						snapshot.properties[properties_start_index + i] = float(property);
 				}
+				return false;
 			}
 
-			// Iterate over cell populations 
-			node = root_node->first_node("CellPopulations");
-			if (node != NULL)
-			{
-				for (rapidxml::xml_node<>* population_node = node->first_node("Population"); population_node != NULL; population_node = population_node->next_sibling("Population"))
-				{
-					std::string type(population_node->first_attribute("type")->value());
-
-					std::unordered_map<std::string, cell_type>::const_iterator t = cell::types.find(type);
-					if (t == cell::types.end())
-						continue;
-
-					std::ptrdiff_t type_index = std::distance<std::unordered_map<std::string, cell_type>::const_iterator>(cell::types.begin(), t);
-
-					for (rapidxml::xml_node<>* cell_node = population_node->first_node("Cell"); cell_node; cell_node = cell_node->next_sibling())
-					{
-						int id;
-						if (!cgv::utils::is_integer(std::string(cell_node->first_attribute("id")->value()), id))
-							continue;
-
-						cell cell(id, type_index);
-
-						// set cell properties
-						size_t start_index = cell::properties.size();
-
-						for (const auto& property_symbol : t->second.properties)
-						{
-							rapidxml::xml_node<>* property_node = cell_node->first_node("PropertyData");
-							while (property_node != NULL)
-							{
-								std::string symbol_ref(property_node->first_attribute("symbol-ref")->value());
-								if (symbol_ref == property_symbol)
-								{
-									std::string value_str(property_node->first_attribute("value")->value());
-									
-									double property;
-									cgv::utils::is_double(value_str, property);
-
-									cell::properties.push_back(float(property));
-
-									break;
-								}
-
-								property_node = property_node->next_sibling("PropertyData");
-							}
-						}
-
-						cell.set_properties(start_index, cell::properties.size());
-
-						vec3 center(0.f);
-
-						rapidxml::xml_node<>* center_node = cell_node->first_node("Center");
-						if (center_node != NULL)
-						{
-							std::vector<std::string> center_str_vector;
-
-							char* token = strtok(center_node->value(), ",");
-
-							// Keep printing tokens while one of the
-							// delimiters present in str[].
-							while (token != NULL)
-							{
-								center_str_vector.push_back(token);
-								token = strtok(NULL, ",");
-							}
-
-							if (center_str_vector.size() == 3)
-							{
-								double x, y, z;
-								if (cgv::utils::is_double(center_str_vector[0], x) && cgv::utils::is_double(center_str_vector[1], y) && cgv::utils::is_double(center_str_vector[2], z))
-								{
-									center.set(float(x), float(y), float(z));
-								}
-							}
-						}
-
-						// set cell center
-						cell.set_center(cell::centers.size());
-
-						cell::centers.push_back(center);
-
-						// set cell nodes
-						start_index = cell::nodes.size();
-
-						rapidxml::xml_node<>* nodes_node = cell_node->first_node("Nodes");
-						if (nodes_node != NULL)
-						{
-							std::vector<std::string> nodes_str_vector;
-
-							char* token = strtok(nodes_node->value(), ";");
-
-							// Keep printing tokens while one of the
-							// delimiters present in str[].
-							while (token != NULL)
-							{
-								nodes_str_vector.push_back(token);
-								token = strtok(NULL, ";");
-							}
-
-							for (auto node_str : nodes_str_vector)
-							{
-								std::vector<std::string> node_str_vector;
-
-								token = strtok(&node_str[0], ", ");
-
-								// Keep printing tokens while one of the
-								// delimiters present in str[].
-								while (token != NULL)
-								{
-									node_str_vector.push_back(token);
-									token = strtok(NULL, ", ");
-								}
-
-								if (node_str_vector.size() != 3)
-									continue;
-
-								int x, y, z;
-								if (!cgv::utils::is_integer(node_str_vector[0], x) || !cgv::utils::is_integer(node_str_vector[1], y) || !cgv::utils::is_integer(node_str_vector[2], z))
-									continue;
-
-								cell::nodes.emplace_back(x, y, z);
-							}
-						}
-
-						cell.set_nodes(start_index, cell::nodes.size());
-
-						cells.push_back(cell);
-					}
-				}
+			if (t.kind != xml_scanner::TK_START)
+				return false;
+
+			if (t.name == "Center") {
+				cgv::utils::token text;
+				if (scanner.read_text(text))
+					parse_center(text.begin, text.end, center);
+
+				return false;
 			}
+
+			if (t.name == "Nodes") {
+				scanner.scan_text([&](const char* b, const char* e, bool last) {
+					return node_scanner::parse(b, e, last, snapshot.nodes);
+				});
+
+				return false;
+			}
+
+			return false;
+		});
+
+		c.set_properties(properties_start_index, snapshot.properties.size());
+
+		// set cell center
+		c.set_center(snapshot.centers.size());
+
+		snapshot.centers.push_back(center);
+
+		// set cell nodes
+		c.set_nodes(nodes_start_index, snapshot.nodes.size());
+
+		snapshot.cells.push_back(c);
+	}
+
+	void parse_cell_populations(xml_scanner& scanner, const tag& cell_populations_tag, cell_snapshot& snapshot)
+	{
+		// property symbols are interned once per file, PropertyData elements are then matched by a single lookup
+		std::vector<property_symbols> type_symbols(snapshot.types.size());
+		for (size_t i = 0; i < snapshot.types.size(); ++i)
+			type_symbols[i].build(snapshot.types[i].properties);
+
+		scanner.for_each_child(cell_populations_tag, [&](const tag& t) {
+			if (!(t.name == "Population"))
+				return false;
+
+			cgv::utils::token type_name = t.get_attribute("type");
+
+			// look up cell type without constructing a string
+			size_t type_index = 0;
+			for (; type_index < snapshot.types.size(); ++type_index)
+				if (type_name == snapshot.types[type_index].name)
+					break;
+
+			if (type_index == snapshot.types.size())
+				return false;
+
+			const cell_type& type = snapshot.types[type_index];
+
+			scanner.for_each_child(t, [&](const tag& cell_tag) {
+				if (!(cell_tag.name == "Cell"))
+					return false;
+
+				parse_cell(scanner, cell_tag, type, type_symbols[type_index], type_index, snapshot);
+				return true;
+			});
+
+			return true;
+		});
+	}
+
+	void parse(xml_source& source, cell_snapshot& snapshot)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		xml_scanner scanner(source);
+		tag t;
+
+		// find our root node
+		while (scanner.next_tag(t)) {
+			if (t.name == "MorpheusModel")
+				break;
+		}
+
+		if (t.kind == xml_scanner::TK_START && t.name == "MorpheusModel") {
+			scanner.for_each_child(t, [&](const tag& child) {
+				if (child.name == "Space")
+					parse_space(scanner, child, snapshot.extent);
+				else if (child.name == "CellTypes")
+					parse_cell_types(scanner, child, snapshot.types);
+				else if (child.name == "CellPopulations")
+					parse_cell_populations(scanner, child, snapshot);
+				else
+					return false;
+
+				return true;
+			});
+		}
+
+		// nodes outside of the range of lattice_node were clamped
+		if (!lattice_fits(snapshot.extent))
+			std::cerr << "lattice extent " << snapshot.extent << " exceeds the range of " << 8 * sizeof(lattice_coordinate)
+				<< " bit lattice nodes" << std::endl;
+
+		auto stop = std::chrono::high_resolution_clock::now();
+
+		nr_bytes = scanner.get_nr_bytes();
+		seconds = std::chrono::duration<double>(stop - start).count();
+	}
+
+public:
+	// the parsers of the small elements are shared with the metadata scan of snapshot_metadata
+
+	/// read the extent from the Size element of a Lattice
+	static void parse_lattice(xml_scanner& scanner, const tag& lattice_tag, ivec3& extent)
+	{
+		scanner.for_each_child(lattice_tag, [&](const tag& t) {
+			if (!(t.name == "Size"))
+				return false;
+
+			cgv::utils::token value = t.get_attribute("value");
+
+			int v[3];
+			if (node_scanner::parse_integers(value.begin, value.end, v, 3) == 3)
+				extent.set(v[0], v[1], v[2]);
+
+			return false;
+		});
+	}
+
+	/// read the lattice extent of a Space element
+	static void parse_space(xml_scanner& scanner, const tag& space_tag, ivec3& extent)
+	{
+		scanner.for_each_child(space_tag, [&](const tag& t) {
+			if (!(t.name == "Lattice"))
+				return false;
+
+			parse_lattice(scanner, t, extent);
+			return true;
+		});
+	}
+
+	/// append the cell types of a CellTypes element with their property symbols
+	static void parse_cell_types(xml_scanner& scanner, const tag& cell_types_tag, std::vector<cell_type>& types)
+	{
+		scanner.for_each_child(cell_types_tag, [&](const tag& t) {
+			if (!(t.name == "CellType"))
+				return false;
+
+			cell_type type(to_string(t.get_attribute("name")), to_string(t.get_attribute("class")));
+
+			scanner.for_each_child(t, [&](const tag& property_tag) {
+				if (property_tag.name == "Property")
+					type.add_property(to_string(property_tag.get_attribute("symbol")));
+
+				return false;
+			});
+
+			types.push_back(type);
+			return true;
+		});
+	}
+
+	model_parser() = delete;
+	model_parser(const model_parser&) = delete;
+
+	model_parser(const std::string& file_name, cell_snapshot& snapshot)
+	{
+		// Set lattice extent to default
+		snapshot.extent.set(100, 100, 100);
+
+		xml_file_source source(file_name);
+		if (!source.is_open()) {
+			std::cerr << "couldn't read snapshot file " << file_name << std::endl;
+			return;
 		}
 
-		delete doc;
+		parse(source, snapshot);
+	}
+
+	model_parser(xml_source& source, cell_snapshot& snapshot)
+	{
+		// Set lattice extent to default
+		snapshot.extent.set(100, 100, 100);
+
+		parse(source, snapshot);
+	}
+
+	/// number of bytes read from the snapshot
+	size_t get_nr_bytes() const
+	{
+		return nr_bytes;
+	}
+
+	/// time spent on reading and parsing the snapshot in seconds
+	double get_seconds() const
+	{
+		return seconds;
+	}
+
+	/// throughput in MB/s
+	double get_throughput() const
+	{
+		return seconds > 0.0 ? nr_bytes / (1024.0 * 1024.0) / seconds : 0.0;
 	}
 };
@@ -0,0 +1,291 @@
+// Scanner for the lattice node lists of Morpheus snapshots
+//
+// Nodes are written as "x,y,z;x,y,z;...". The vectorized scanner classifies a whole block of characters at once
+// into digits, commas and semicolons and extracts all triples of the common form "digits,digits,digits;" that lie
+// inside the block from the resulting bit masks. Everything else (signs, whitespace inside a triple, malformed
+// triples) is handed to the scalar scanner one triple at a time, so both scanners produce identical results.
+//
+// The instruction set is chosen at compile time: AVX2 if the compiler targets it (/arch:AVX2, -mavx2), otherwise
+// SSE2 which is part of every x86-64 target, otherwise the scalar scanner.
+//
+// Nodes are appended to vectors of float or integer triples. Integer coordinates outside of the range of the
+// coordinate type are clamped to it.
+//
+// Usage:
+// std::vector<vec3> nodes;
+// node_scanner::parse(text.begin, text.end, true, nodes);
+
+#pragma once
+
+#include <cgv/render/render_types.h>
+#include <cgv/utils/scan.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NODE_SCANNER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NODE_SCANNER_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+class node_scanner : public cgv::render::render_types
+{
+private:
+#if defined(NODE_SCANNER_AVX2)
+	static const unsigned block_size = 32;
+#elif defined(NODE_SCANNER_SSE2)
+	static const unsigned block_size = 16;
+#endif
+
+	static unsigned count_trailing_zeros(uint64_t mask)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, mask);
+		return unsigned(index);
+#else
+		return unsigned(__builtin_ctzll(mask));
+#endif
+	}
+
+	/// convert a run of count decimal digits, count is at most 9 so that the value fits into an int
+	static int digits_to_int(const char* p, unsigned count)
+	{
+		int value = 0;
+		for (unsigned i = 0; i < count; ++i)
+			value = 10 * value + (p[i] - '0');
+
+		return value;
+	}
+
+	/// convert a parsed coordinate to T, integer types saturate
+	template <typename T>
+	static T to_coordinate(int value, std::true_type)
+	{
+		typedef typename std::common_type<T, int>::type C;
+		return T(std::min(std::max(C(value), C(std::numeric_limits<T>::min())), C(std::numeric_limits<T>::max())));
+	}
+	template <typename T>
+	static T to_coordinate(int value, std::false_type)
+	{
+		return T(value);
+	}
+
+	template <typename T>
+	static void add_node(std::vector<cgv::math::fvec<T, 3>>& nodes, int x, int y, int z)
+	{
+		typename std::is_integral<T>::type is_integral;
+		nodes.emplace_back(to_coordinate<T>(x, is_integral), to_coordinate<T>(y, is_integral), to_coordinate<T>(z, is_integral));
+	}
+
+#if defined(NODE_SCANNER_AVX2) || defined(NODE_SCANNER_SSE2)
+	/// set bit i of the masks if character i of the block at p is a digit, a comma or a semicolon
+	static void classify_block(const char* p, uint64_t& digits, uint64_t& commas, uint64_t& semicolons)
+	{
+#if defined(NODE_SCANNER_AVX2)
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+		__m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+		digits = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(9)), t)));
+		commas = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+		semicolons = uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(';'))));
+#else
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		__m128i t = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+		digits = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(9)), t)));
+		commas = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+		semicolons = uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(';'))));
+#endif
+	}
+
+	/// extract all triples of the form "digits,digits,digits;" at the start of the block at p, return the number of
+	/// consumed characters
+	template <typename T>
+	static unsigned parse_block(const char* p, std::vector<cgv::math::fvec<T, 3>>& nodes)
+	{
+		uint64_t digits, commas, semicolons;
+		classify_block(p, digits, commas, semicolons);
+
+		unsigned offset = 0;
+		while (offset < block_size) {
+			uint64_t d = digits >> offset;
+			uint64_t s = semicolons >> offset;
+
+			if ((d & 1) == 0 || s == 0)
+				break;
+
+			unsigned semicolon = count_trailing_zeros(s);
+			uint64_t triple_mask = (uint64_t(1) << semicolon) - 1;
+			uint64_t c = (commas >> offset) & triple_mask;
+
+			// only digits and commas before the semicolon
+			if (((d | c) & triple_mask) != triple_mask)
+				break;
+
+			// exactly two commas
+			if (c == 0)
+				break;
+			unsigned comma0 = count_trailing_zeros(c);
+			c &= c - 1;
+			if (c == 0)
+				break;
+			unsigned comma1 = count_trailing_zeros(c);
+			if ((c & (c - 1)) != 0)
+				break;
+
+			unsigned length0 = comma0;
+			unsigned length1 = comma1 - comma0 - 1;
+			unsigned length2 = semicolon - comma1 - 1;
+			if (length1 == 0 || length2 == 0 || length0 > 9 || length1 > 9 || length2 > 9)
+				break;
+
+			const char* q = p + offset;
+			add_node(nodes, digits_to_int(q, length0), digits_to_int(q + comma0 + 1, length1), digits_to_int(q + comma1 + 1, length2));
+
+			offset += semicolon + 1;
+		}
+
+		return offset;
+	}
+#endif
+
+	/// parse the triple starting at p and return the position behind its ';'
+	template <typename T>
+	static const char* parse_triple(const char* p, const char* e, std::vector<cgv::math::fvec<T, 3>>& nodes)
+	{
+		const char* triple_end = static_cast<const char*>(memchr(p, ';', e - p));
+		if (triple_end == NULL)
+			triple_end = e;
+
+		// triples that do not consist of three integers are skipped
+		int v[3];
+		if (parse_integers(p, triple_end, v, 3) == 3)
+			add_node(nodes, v[0], v[1], v[2]);
+
+		return triple_end < e ? triple_end + 1 : e;
+	}
+
+	/// if last is false, restrict [p, e) to complete triples terminated by ';'
+	static const char* complete_triples_end(const char* p, const char* e, bool last)
+	{
+		if (!last) {
+			while (e > p && e[-1] != ';')
+				--e;
+		}
+
+		return e;
+	}
+
+public:
+	static bool is_separator(char c)
+	{
+		return c == ',' || c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	/// parse an integer at p, p is moved behind the parsed characters
+	static bool parse_integer(const char*& p, const char* e, int& value)
+	{
+		bool negative = false;
+		if (p < e && (*p == '-' || *p == '+'))
+			negative = *p++ == '-';
+
+		if (p == e || *p < '0' || *p > '9')
+			return false;
+
+		// unsigned arithmetic wraps around on overflow instead of being undefined
+		unsigned v = 0;
+		do {
+			v = 10 * v + unsigned(*p++ - '0');
+		} while (p < e && *p >= '0' && *p <= '9');
+
+		value = int(negative ? 0u - v : v);
+		return true;
+	}
+
+	/// parse up to count comma or space separated integers, return the number of values found
+	static size_t parse_integers(const char* p, const char* e, int* values, size_t count)
+	{
+		size_t n = 0;
+		while (p < e) {
+			if (is_separator(*p)) {
+				++p;
+				continue;
+			}
+
+			int value;
+			if (!parse_integer(p, e, value))
+				return 0;
+
+			if (n < count)
+				values[n] = value;
+			++n;
+		}
+
+		return n;
+	}
+
+	/// name of the instruction set used by parse
+	static const char* get_instruction_set()
+	{
+#if defined(NODE_SCANNER_AVX2)
+		return "AVX2";
+#elif defined(NODE_SCANNER_SSE2)
+		return "SSE2";
+#else
+		return "scalar";
+#endif
+	}
+
+	/// parse "x,y,z;x,y,z;..." lattice node lists one character at a time, if last is false only complete triples
+	/// terminated by ';' are consumed; return the position behind the consumed characters
+	template <typename T>
+	static const char* parse_scalar(const char* p, const char* e, bool last, std::vector<cgv::math::fvec<T, 3>>& nodes)
+	{
+		e = complete_triples_end(p, e, last);
+
+		while (p < e)
+			p = parse_triple(p, e, nodes);
+
+		return e;
+	}
+
+	/// same as parse_scalar but whole blocks of characters are classified with SIMD instructions
+	template <typename T>
+	static const char* parse(const char* p, const char* e, bool last, std::vector<cgv::math::fvec<T, 3>>& nodes)
+	{
+#if defined(NODE_SCANNER_AVX2) || defined(NODE_SCANNER_SSE2)
+		e = complete_triples_end(p, e, last);
+
+		while (p < e) {
+			// whitespace between triples is skipped by the scalar scanner as well
+			while (p < e && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+				++p;
+
+			if (size_t(e - p) >= block_size) {
+				unsigned offset = parse_block(p, nodes);
+				if (offset > 0) {
+					p += offset;
+					continue;
+				}
+			}
+
+			if (p < e)
+				p = parse_triple(p, e, nodes);
+		}
+
+		return e;
+#else
+		return parse_scalar(p, e, last, nodes);
+#endif
+	}
+};
@@ -0,0 +1,365 @@
+// Out-of-core playback of a cell cache
+//
+// Opening a cell cache only reads its index and the headers of the node and cell files. A background I/O thread
+// reads the frames of the time steps following the playback position with read_time_step into buffers that are
+// reused for every frame and decodes them into cell snapshots. Time steps are read ahead in the direction of playback
+// as long as their snapshots fit into the memory budget, snapshots of time steps that fall out of this window are
+// dropped. The memory held is therefore bounded by the budget instead of the length of the simulation.
+//
+// Snapshots are handed out by take. Giving them back with recycle once their content is not needed anymore lets the
+// I/O thread reuse their vectors for later time steps.
+//
+// Usage:
+// ooc_stream stream;
+// stream.open(base_name, size_t(1) << 30);
+// stream.set_position(ti, 1);
+// std::unique_ptr<cell_snapshot> snapshot = stream.take(ti);
+// cell::assign(*snapshot, cells);
+// stream.recycle(std::move(snapshot));
+
+#pragma once
+
+#include <cgv/render/render_types.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cae_file_format.h"
+#include "cell_cache.h"
+#include "cell_data.h"
+
+class ooc_stream : public cgv::render::render_types
+{
+	// number of snapshots kept for reuse
+	static const size_t nr_spare_snapshots = 2;
+
+	std::string base_name;
+	std::string cells_base_name;
+
+	cae::binary_file nodes_file;
+	cae::binary_file cells_file;
+
+	ivec3 extent = ivec3(100);
+	std::vector<cell_type> types;
+
+	mutable std::mutex mutex;
+	std::condition_variable cv;
+
+	size_t budget = 0;
+	uint32_t position = 0;
+	int direction = 1;
+
+	// decoded snapshots of time steps in the window and their number of bytes
+	std::map<uint32_t, std::unique_ptr<cell_snapshot>> loaded;
+	size_t memory = 0;
+	// number of bytes of the last decoded snapshot, estimates how many time steps fit into the budget
+	size_t frame_memory = 0;
+	// time steps in the window that are not read again because they were taken or could not be read
+	std::set<uint32_t> taken;
+	std::set<uint32_t> failed;
+	uint32_t loading = UINT32_MAX;
+
+	std::vector<std::unique_ptr<cell_snapshot>> spare;
+
+	bool stop = false;
+	std::thread thread;
+
+	// buffers of read_time_step, only used by the I/O thread
+	std::vector<lattice_node> nodes;
+	std::vector<uint32_t> node_groups;
+	std::vector<float> no_attr_values;
+	std::vector<vec3> centers;
+	std::vector<uint32_t> ids;
+	std::vector<float> attr_values;
+
+	uint32_t get_nr_time_steps_locked() const
+	{
+		return uint32_t(cells_file.times.size());
+	}
+
+	/// time steps following the position in the direction of playback that fit into the budget, at least the
+	/// position and the next time step
+	std::vector<uint32_t> get_window() const
+	{
+		uint32_t nr_time_steps = get_nr_time_steps_locked();
+		size_t count = frame_memory == 0 ? 2 : std::max(size_t(2), budget / frame_memory);
+		count = std::min(count, size_t(nr_time_steps));
+
+		std::vector<uint32_t> window;
+		int64_t ti = position;
+		for (size_t k = 0; k < count; ++k) {
+			window.push_back(uint32_t(ti));
+			ti = (ti + nr_time_steps + direction) % nr_time_steps;
+		}
+		return window;
+	}
+
+	bool is_in_window(uint32_t ti) const
+	{
+		std::vector<uint32_t> window = get_window();
+		return std::find(window.begin(), window.end(), ti) != window.end();
+	}
+
+	void add_spare(std::unique_ptr<cell_snapshot> snapshot)
+	{
+		if (spare.size() < nr_spare_snapshots)
+			spare.push_back(std::move(snapshot));
+	}
+
+	/// drop snapshots and marks of time steps outside of the window
+	void evict()
+	{
+		std::vector<uint32_t> window = get_window();
+		std::set<uint32_t> in_window(window.begin(), window.end());
+
+		for (auto it = loaded.begin(); it != loaded.end(); ) {
+			if (in_window.find(it->first) == in_window.end()) {
+				memory -= it->second->get_memory();
+				add_spare(std::move(it->second));
+				it = loaded.erase(it);
+			}
+			else
+				++it;
+		}
+		for (auto* marks : { &taken, &failed })
+			for (auto it = marks->begin(); it != marks->end(); )
+				if (in_window.find(*it) == in_window.end())
+					it = marks->erase(it);
+				else
+					++it;
+	}
+
+	/// find the first time step of the window that still has to be read
+	bool find_next(uint32_t& ti) const
+	{
+		for (uint32_t wi : get_window())
+			if (loaded.find(wi) == loaded.end() && taken.find(wi) == taken.end() && failed.find(wi) == failed.end()) {
+				ti = wi;
+				return true;
+			}
+		return false;
+	}
+
+	/// read and decode time step ti, called on the I/O thread without holding the lock
+	bool read(uint32_t ti, cell_snapshot& snapshot)
+	{
+		if (!nodes_file.read_time_step(base_name, ti, nodes, node_groups, no_attr_values) ||
+			!cells_file.read_time_step(cells_base_name, ti, centers, ids, attr_values))
+			return false;
+
+		snapshot.extent = extent;
+		snapshot.types = types;
+		return cell_cache::decode_time_step(nodes, centers, ids, attr_values, cells_file.nr_attributes, snapshot);
+	}
+
+	void work()
+	{
+		for (;;) {
+			uint32_t ti;
+			std::unique_ptr<cell_snapshot> snapshot;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&] { return stop || find_next(ti); });
+
+				if (stop)
+					return;
+
+				loading = ti;
+				if (spare.empty())
+					snapshot.reset(new cell_snapshot());
+				else {
+					snapshot = std::move(spare.back());
+					spare.pop_back();
+				}
+			}
+
+			bool success = read(ti, *snapshot);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				loading = UINT32_MAX;
+
+				if (!success) {
+					std::cerr << "couldn't read time step " << ti << " of " << base_name << std::endl;
+					failed.insert(ti);
+					add_spare(std::move(snapshot));
+				}
+				else if (!is_in_window(ti) || taken.find(ti) != taken.end())
+					add_spare(std::move(snapshot));
+				else {
+					frame_memory = snapshot->get_memory();
+					memory += frame_memory;
+					loaded[ti] = std::move(snapshot);
+					// the window shrinks if frames grow
+					evict();
+				}
+			}
+			cv.notify_all();
+		}
+	}
+
+public:
+	ooc_stream(const ooc_stream&) = delete;
+	ooc_stream& operator=(const ooc_stream&) = delete;
+
+	ooc_stream()
+	{
+	}
+
+	~ooc_stream()
+	{
+		close();
+	}
+
+	/// open the cell cache of _base_name and start reading time steps from the first one, budget is given in bytes
+	bool open(const std::string& _base_name, size_t _budget)
+	{
+		close();
+
+		base_name = _base_name;
+		cells_base_name = cell_cache::get_cells_base_name(base_name);
+
+		if (!cell_cache::read_info(base_name, extent, types) ||
+			!nodes_file.read_header(base_name + ".cae") ||
+			!cells_file.read_header(cells_base_name + ".cae"))
+			return false;
+
+		if (nodes_file.nr_time_steps != cells_file.nr_time_steps || cells_file.nr_attributes < 2 || cells_file.times.empty())
+			return false;
+
+		budget = _budget;
+		position = 0;
+		direction = 1;
+		stop = false;
+		thread = std::thread(&ooc_stream::work, this);
+		return true;
+	}
+
+	/// stop the I/O thread and drop all snapshots
+	void close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		cv.notify_all();
+
+		if (thread.joinable())
+			thread.join();
+
+		loaded.clear();
+		taken.clear();
+		failed.clear();
+		spare.clear();
+		memory = 0;
+		frame_memory = 0;
+	}
+
+	uint32_t get_nr_time_steps() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return get_nr_time_steps_locked();
+	}
+
+	const std::vector<float>& get_times() const
+	{
+		return cells_file.times;
+	}
+
+	const ivec3& get_extent() const
+	{
+		return extent;
+	}
+
+	/// number of bytes of the snapshots that are read ahead
+	size_t get_memory() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return memory;
+	}
+
+	void set_budget(size_t _budget)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			budget = _budget;
+			evict();
+		}
+		cv.notify_all();
+	}
+
+	/// move the playback position to time step ti, time steps are read ahead in the given direction
+	void set_position(uint32_t ti, int _direction)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (ti >= get_nr_time_steps_locked())
+				return;
+
+			position = ti;
+			direction = _direction < 0 ? -1 : 1;
+			evict();
+		}
+		cv.notify_all();
+	}
+
+	/// whether the snapshot of time step ti is read and can be taken without waiting
+	bool is_loaded(uint32_t ti) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return loaded.find(ti) != loaded.end();
+	}
+
+	/// return the snapshot of time step ti and wait until it is read, the position moves to ti if ti is not in the
+	/// window; return nullptr if ti could not be read or left the window while waiting
+	std::unique_ptr<cell_snapshot> take(uint32_t ti)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (stop || ti >= get_nr_time_steps_locked())
+			return nullptr;
+
+		// a time step that was taken before or failed is read again
+		taken.erase(ti);
+		failed.erase(ti);
+		if (!is_in_window(ti)) {
+			position = ti;
+			evict();
+		}
+		cv.notify_all();
+
+		cv.wait(lock, [&] {
+			return stop || loaded.find(ti) != loaded.end() || failed.find(ti) != failed.end() ||
+				(loading != ti && !is_in_window(ti));
+		});
+
+		auto it = loaded.find(ti);
+		if (it == loaded.end())
+			return nullptr;
+
+		std::unique_ptr<cell_snapshot> snapshot = std::move(it->second);
+		memory -= snapshot->get_memory();
+		loaded.erase(it);
+		taken.insert(ti);
+		cv.notify_all();
+		return snapshot;
+	}
+
+	/// give back a snapshot whose content is not needed anymore so that its vectors are reused
+	void recycle(std::unique_ptr<cell_snapshot> snapshot)
+	{
+		if (!snapshot)
+			return;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		add_spare(std::move(snapshot));
+	}
+};
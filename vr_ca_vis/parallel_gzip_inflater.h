@@ -0,0 +1,228 @@
+// Inflate a gzip file in parallel with the help of a gzip_index
+//
+// Every segment between two access points is inflated independently by one of the worker threads into its own
+// buffer. The segments are handed out as xml_source chunks in file order, so the parser sees the same byte stream as
+// with the sequential gzip_inflater. Workers stay at most two segments per thread ahead of the parser.
+//
+// Usage:
+// gzip_index index;
+// if (index.read(<file_name>)) {
+//    parallel_gzip_inflater source(<file_name>, index, 8);
+//    xml_scanner scanner(source);
+// }
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "zlib.h"
+
+#include "gzip_index.h"
+#include "xml_scanner.h"
+
+class parallel_gzip_inflater : public xml_source
+{
+private:
+	enum segment_status
+	{
+		SS_PENDING,
+		SS_DONE,
+		SS_FAILED
+	};
+
+	std::string file_name;
+	const gzip_index& index;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+
+	std::vector<std::unique_ptr<std::vector<char>>> segments;
+	std::vector<segment_status> status;
+
+	// next segment to be inflated by a worker and next segment to be handed out as chunk
+	size_t next_segment = 0;
+	size_t next_chunk_segment = 0;
+	size_t max_pending;
+	bool stop = false;
+
+	std::vector<std::thread> threads;
+
+	// segment handed out by the last call to next_chunk
+	std::unique_ptr<std::vector<char>> current;
+
+	static bool seek(FILE* fp, uint64_t offset)
+	{
+#ifdef _WIN32
+		return _fseeki64(fp, int64_t(offset), SEEK_SET) == 0;
+#else
+		return fseeko(fp, off_t(offset), SEEK_SET) == 0;
+#endif
+	}
+
+	/// inflate the segment starting at access point i into data
+	bool inflate_segment(size_t i, std::vector<char>& data) const
+	{
+		const gzip_access_point& point = index.points[i];
+
+		data.resize(size_t(index.get_segment_size(i)));
+		if (data.empty())
+			return true;
+
+		FILE* fp = fopen(file_name.c_str(), "rb");
+		if (!fp)
+			return false;
+
+		if (!seek(fp, point.in - (point.bits ? 1 : 0))) {
+			fclose(fp);
+			return false;
+		}
+
+		z_stream strm;
+		strm.zalloc = Z_NULL;
+		strm.zfree = Z_NULL;
+		strm.opaque = Z_NULL;
+		strm.avail_in = 0;
+		strm.next_in = Z_NULL;
+
+		/* access points are inside the raw deflate stream */
+		int ret = inflateInit2(&strm, -MAX_WBITS);
+		if (ret != Z_OK) {
+			fclose(fp);
+			return false;
+		}
+
+		/* feed the bits of the block that start in the preceding byte */
+		if (point.bits) {
+			int c = getc(fp);
+			if (c == EOF)
+				ret = Z_DATA_ERROR;
+			else
+				ret = inflatePrime(&strm, point.bits, c >> (8 - point.bits));
+		}
+
+		if (ret == Z_OK && !point.window.empty())
+			ret = inflateSetDictionary(&strm, &point.window[0], uInt(point.window.size()));
+
+		std::vector<unsigned char> in(1 << 16);
+
+		strm.next_out = reinterpret_cast<Bytef*>(&data[0]);
+		strm.avail_out = uInt(data.size());
+
+		while (ret == Z_OK && strm.avail_out > 0) {
+			if (strm.avail_in == 0) {
+				strm.avail_in = uInt(fread(&in[0], 1, in.size(), fp));
+				if (strm.avail_in == 0) {
+					ret = Z_DATA_ERROR;
+					break;
+				}
+				strm.next_in = &in[0];
+			}
+
+			ret = inflate(&strm, Z_NO_FLUSH);
+			if (ret == Z_NEED_DICT)
+				ret = Z_DATA_ERROR;
+		}
+
+		bool success = strm.avail_out == 0 && (ret == Z_OK || ret == Z_STREAM_END);
+
+		(void)inflateEnd(&strm);
+		fclose(fp);
+
+		return success;
+	}
+
+	void work()
+	{
+		for (;;) {
+			size_t i;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&] { return stop || next_segment >= segments.size() || next_segment < next_chunk_segment + max_pending; });
+
+				if (stop || next_segment >= segments.size())
+					return;
+
+				i = next_segment++;
+			}
+
+			std::unique_ptr<std::vector<char>> data(new std::vector<char>());
+			bool success = inflate_segment(i, *data);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				segments[i] = std::move(data);
+				status[i] = success ? SS_DONE : SS_FAILED;
+			}
+			cv.notify_all();
+		}
+	}
+
+public:
+	parallel_gzip_inflater() = delete;
+	parallel_gzip_inflater(const parallel_gzip_inflater&) = delete;
+
+	/// the index has to stay valid during the lifetime of the inflater
+	parallel_gzip_inflater(const std::string& _file_name, const gzip_index& _index, unsigned nr_threads)
+		: file_name(_file_name), index(_index), segments(_index.points.size()), status(_index.points.size(), SS_PENDING)
+	{
+		if (nr_threads < 1)
+			nr_threads = 1;
+
+		max_pending = 2 * size_t(nr_threads);
+
+		for (unsigned t = 0; t < nr_threads; ++t)
+			threads.emplace_back(&parallel_gzip_inflater::work, this);
+	}
+
+	~parallel_gzip_inflater()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		cv.notify_all();
+
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	/* hand out the inflated segments in file order, returns false at the end or if a segment could not be inflated */
+	bool next_chunk(const char*& data, size_t& size)
+	{
+		for (;;) {
+			current.reset();
+
+			std::unique_lock<std::mutex> lock(mutex);
+
+			if (stop || next_chunk_segment >= segments.size())
+				return false;
+
+			size_t i = next_chunk_segment;
+			cv.wait(lock, [&] { return status[i] != SS_PENDING; });
+
+			if (status[i] == SS_FAILED) {
+				fprintf(stderr, "parallel_gzip_inflater: could not inflate segment %u of %s\n", unsigned(i), file_name.c_str());
+				stop = true;
+				lock.unlock();
+				cv.notify_all();
+				return false;
+			}
+
+			current = std::move(segments[i]);
+			++next_chunk_segment;
+
+			lock.unlock();
+			cv.notify_all();
+
+			if (!current->empty()) {
+				data = &(*current)[0];
+				size = current->size();
+				return true;
+			}
+		}
+	}
+};
@@ -0,0 +1,177 @@
+// File accessed with explicit 64 bit offsets instead of a shared file position
+//
+// Reads and writes take the offset as argument (pread and pwrite, ReadFile and WriteFile with an OVERLAPPED offset),
+// so multiple threads can read from one open file concurrently and offsets beyond 4 GB work independently of the
+// size of long. Transfers are split into chunks that fit into the size arguments of the system calls.
+//
+// Usage:
+// positional_file file;
+// if (file.open(<file_name>))
+//    file.read_at(offset, buffer, size);
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// offsets are passed to pread and pwrite as off_t, which has 32 bits on 32 bit targets unless large file support is
+// enabled
+static_assert(sizeof(off_t) >= 8, "positional_file needs a 64 bit off_t, define _FILE_OFFSET_BITS=64");
+#endif
+
+class positional_file
+{
+public:
+	enum open_mode
+	{
+		OM_READ,	// existing file for reading
+		OM_WRITE,	// file for reading and writing, created if it does not exist and kept otherwise
+		OM_CREATE	// empty file for reading and writing, an existing file is truncated
+	};
+
+private:
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+#else
+	int fd = -1;
+#endif
+
+	// largest transfer per system call
+	static const size_t max_chunk_size = size_t(1) << 30;
+
+public:
+	positional_file(const positional_file&) = delete;
+	positional_file& operator=(const positional_file&) = delete;
+
+	positional_file()
+	{
+	}
+	~positional_file()
+	{
+		close();
+	}
+
+	bool open(const std::string& file_name, open_mode mode = OM_READ)
+	{
+		close();
+
+#ifdef _WIN32
+		DWORD access = (mode == OM_READ) ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE);
+		DWORD disposition = (mode == OM_READ) ? OPEN_EXISTING : ((mode == OM_WRITE) ? OPEN_ALWAYS : CREATE_ALWAYS);
+		file = CreateFileA(file_name.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, disposition, FILE_ATTRIBUTE_NORMAL, NULL);
+		return file != INVALID_HANDLE_VALUE;
+#else
+		int flags = (mode == OM_READ) ? O_RDONLY : (O_RDWR | O_CREAT | ((mode == OM_CREATE) ? O_TRUNC : 0));
+		fd = ::open(file_name.c_str(), flags, 0644);
+		return fd >= 0;
+#endif
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (fd >= 0)
+			::close(fd);
+		fd = -1;
+#endif
+	}
+
+	bool is_open() const
+	{
+#ifdef _WIN32
+		return file != INVALID_HANDLE_VALUE;
+#else
+		return fd >= 0;
+#endif
+	}
+
+	/// current size of the file in bytes
+	uint64_t get_size() const
+	{
+#ifdef _WIN32
+		LARGE_INTEGER file_size;
+		if (!is_open() || !GetFileSizeEx(file, &file_size))
+			return 0;
+		return uint64_t(file_size.QuadPart);
+#else
+		struct stat info;
+		if (!is_open() || fstat(fd, &info) != 0)
+			return 0;
+		return uint64_t(info.st_size);
+#endif
+	}
+
+	/// read size bytes starting at offset, return false if the file ends before
+	bool read_at(uint64_t offset, void* data, size_t size) const
+	{
+		char* p = static_cast<char*>(data);
+		while (size > 0) {
+			size_t chunk_size = size < max_chunk_size ? size : max_chunk_size;
+#ifdef _WIN32
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = DWORD(offset & 0xffffffff);
+			overlapped.OffsetHigh = DWORD(offset >> 32);
+
+			DWORD count = 0;
+			if (!ReadFile(file, p, DWORD(chunk_size), &count, &overlapped) || count == 0)
+				return false;
+#else
+			ssize_t count = pread(fd, p, chunk_size, off_t(offset));
+			if (count < 0 && errno == EINTR)
+				continue;
+			if (count <= 0)
+				return false;
+#endif
+			p += count;
+			offset += uint64_t(count);
+			size -= size_t(count);
+		}
+		return true;
+	}
+
+	/// write size bytes starting at offset, the file grows if needed
+	bool write_at(uint64_t offset, const void* data, size_t size)
+	{
+		const char* p = static_cast<const char*>(data);
+		while (size > 0) {
+			size_t chunk_size = size < max_chunk_size ? size : max_chunk_size;
+#ifdef _WIN32
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = DWORD(offset & 0xffffffff);
+			overlapped.OffsetHigh = DWORD(offset >> 32);
+
+			DWORD count = 0;
+			if (!WriteFile(file, p, DWORD(chunk_size), &count, &overlapped) || count == 0)
+				return false;
+#else
+			ssize_t count = pwrite(fd, p, chunk_size, off_t(offset));
+			if (count < 0 && errno == EINTR)
+				continue;
+			if (count <= 0)
+				return false;
+#endif
+			p += count;
+			offset += uint64_t(count);
+			size -= size_t(count);
+		}
+		return true;
+	}
+};
@@ -82,6 +82,8 @@ private:
 	void insert(int cell_index, int node_index, const vec3& p)
 	{
 		int gi = get_position_to_grid_index(p);
+		if (gi < 0)
+			return;
 
 		cell_grid[gi] = cell_index + 1;
 		node_grid[gi] = node_index + 1;
@@ -125,7 +127,7 @@ private:
 				const auto& c = (*cells)[current_cell_index];
 
 				for (size_t i = c.nodes_start_index; i < c.nodes_end_index; ++i)
-					insert(current_cell_index, i - c.nodes_start_index, cell::nodes[i]);
+					insert(current_cell_index, i - c.nodes_start_index, vec3(cell::nodes[i]));
 
 				++current_cell_index;
 			}
@@ -159,7 +161,7 @@ private:
 
 					const cell& c = (*cells)[cell_index];
 
-					std::cout << cell::nodes[c.nodes_start_index + node_index] << std::endl;
+					std::cout << vec3(cell::nodes[c.nodes_start_index + node_index]) << std::endl;
 
 					std::cout << "=============" << std::endl;
 				}
@@ -172,6 +174,16 @@ public:
 	{
 		cell_extents[0] = cell_extents[1] = cell_extents[2] = _cell_extents;
 	}
+	regular_grid(const regular_grid&) = delete;
+	regular_grid& operator=(const regular_grid&) = delete;
+	~regular_grid()
+	{
+		cancel_build_from_vertices();
+
+		if (cell_grid) delete[] cell_grid;
+		if (node_grid) delete[] node_grid;
+		if (visited_statuses) delete[] visited_statuses;
+	}
 
 	int get_cell_index_to_grid_index(const ivec3& ci) const
 	{
@@ -359,6 +371,55 @@ public:
 		thread = std::thread(&regular_grid::build_from_vertices_impl, this, print_grid);
 	}
 
+	//builds the grid on the calling thread from the given cells and nodes, used to prepare a grid away from the grid
+	//that is in use
+	void build_from_vertices_sync(const std::vector<T>& _cells, const std::vector<lattice_node>& nodes, size_t _cells_start, size_t _cells_end, const ivec3& _extents)
+	{
+		cancel_build_from_vertices();
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		reset(_extents);
+
+		cells = &_cells;
+		cells_end = _cells_end;
+
+		if (cell_grid == NULL)
+			return;
+
+		for (size_t ci = _cells_start; ci < _cells_end; ++ci) {
+			const auto& c = _cells[ci];
+
+			for (size_t i = c.nodes_start_index; i < c.nodes_end_index; ++i)
+				insert(int(ci), int(i - c.nodes_start_index), vec3(nodes[i]));
+		}
+
+		current_cell_index = _cells_end;
+	}
+
+	//replaces the content of this grid by a grid that is completely built and sets the cells it refers to, the
+	//previous content is moved to other
+	void swap(regular_grid& other, const std::vector<T>* _cells)
+	{
+		cancel_build_from_vertices();
+		other.cancel_build_from_vertices();
+
+		std::lock(mutex, other.mutex);
+		std::lock_guard<std::mutex> lock(mutex, std::adopt_lock);
+		std::lock_guard<std::mutex> other_lock(other.mutex, std::adopt_lock);
+
+		std::swap(cell_grid, other.cell_grid);
+		std::swap(node_grid, other.node_grid);
+		std::swap(visited_statuses, other.visited_statuses);
+		std::swap(extents, other.extents);
+		std::swap(cell_extents, other.cell_extents);
+		std::swap(current_cell_index, other.current_cell_index);
+		std::swap(cells_end, other.cells_end);
+
+		other.cells = cells;
+		cells = _cells;
+	}
+
 	void cancel_build_from_vertices()
 	{
 		{
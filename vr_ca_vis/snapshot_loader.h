@@ -0,0 +1,253 @@
+// Parse Morpheus snapshot files concurrently on a pool of worker threads
+//
+// Every file is parsed into its own cell_snapshot and the snapshots are handed to the merge callback strictly in
+// the order of the file names, so merging them gives the same result as a sequential load. Workers never run more
+// than two snapshots per thread ahead of the merging, which bounds the memory held by unmerged snapshots.
+//
+// Usage:
+// snapshot_loader::statistics stats = snapshot_loader::load(file_names, 0, [&](size_t index, cell_snapshot& snapshot, const snapshot_loader::file_statistics& file_stats) {
+//    cell::append(snapshot, cells);
+// });
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <cgv/utils/file.h>
+#include <cgv/utils/scan.h>
+
+#include "cell_data.h"
+#include "gzip_inflater.h"
+#include "parallel_gzip_inflater.h"
+#include "model_parser.h"
+
+class snapshot_loader
+{
+public:
+	struct file_statistics
+	{
+		// false if the file could not be opened
+		bool valid = false;
+		size_t nr_bytes = 0;
+		double seconds = 0.0;
+	};
+
+	struct statistics
+	{
+		unsigned nr_threads = 1;
+		size_t nr_bytes = 0;
+		// sum of the parse times of all files, which overlap if files are parsed concurrently
+		double parse_seconds = 0.0;
+		// time from start of loading to the last merge
+		double wall_seconds = 0.0;
+
+		/// throughput in MB/s
+		double get_throughput() const
+		{
+			return wall_seconds > 0.0 ? nr_bytes / (1024.0 * 1024.0) / wall_seconds : 0.0;
+		}
+	};
+
+	typedef std::function<void(size_t index, cell_snapshot& snapshot, const file_statistics& stats)> merge_callback;
+
+	static bool is_compressed(const std::string& file_name)
+	{
+		return file_name.size() > 3 && file_name.compare(file_name.size() - 3, 3, ".gz") == 0;
+	}
+
+	/// extract the simulation time from the last six characters of the file name without extensions, return false
+	/// if they are not an integer
+	static bool get_time(const std::string& file_name, float& time)
+	{
+		std::string time_str = cgv::utils::file::drop_extension(cgv::utils::file::get_file_name(file_name));
+		if (is_compressed(file_name))
+			time_str = cgv::utils::file::drop_extension(time_str);
+		if (time_str.size() < 6)
+			return false;
+		time_str = time_str.substr(time_str.size() - 6);
+
+		int value;
+		if (!cgv::utils::is_integer(time_str, value))
+			return false;
+
+		time = float(value);
+		return true;
+	}
+
+	/// parse a single snapshot file, compressed files are inflated on the fly and uncompressed files are parsed in
+	/// place from a memory mapping; files that cannot be mapped are read chunk by chunk
+	///
+	/// Compressed files are inflated with nr_inflate_threads threads if an index of access points exists next to
+	/// them. For large files without a valid index, the index is built while inflating sequentially and stored. Files that cannot be opened
+	/// are reported and leave the snapshot empty.
+	static file_statistics read(const std::string& file_name, cell_snapshot& snapshot, unsigned nr_inflate_threads = 1)
+	{
+		// compressed files smaller than this are inflated sequentially without an index
+		const uint64_t min_indexed_size = uint64_t(4) << 20;
+
+		gzip_index index;
+		gzip_inflater* indexing_inflater = NULL;
+
+		std::unique_ptr<xml_source> source;
+		bool is_open = true;
+		if (is_compressed(file_name)) {
+			file_stamp stamp;
+			bool large = stamp.get(file_name) && stamp.size >= min_indexed_size;
+
+			bool indexed = large && index.read(file_name);
+
+			if (indexed && nr_inflate_threads > 1 && index.points.size() > 1)
+				source.reset(new parallel_gzip_inflater(file_name, index, nr_inflate_threads));
+			else {
+				gzip_inflater* inflater = new gzip_inflater(file_name);
+				is_open = inflater->is_open();
+				if (is_open && large && !indexed) {
+					inflater->build_index(index);
+					indexing_inflater = inflater;
+				}
+				source.reset(inflater);
+			}
+		}
+		else {
+			std::unique_ptr<xml_mapped_source> mapped_source(new xml_mapped_source(file_name));
+			if (mapped_source->is_open())
+				source = std::move(mapped_source);
+			else {
+				xml_file_source* file_source = new xml_file_source(file_name);
+				is_open = file_source->is_open();
+				source.reset(file_source);
+			}
+		}
+
+		if (!is_open) {
+			std::cerr << "couldn't read snapshot file " << file_name << std::endl;
+			return file_statistics();
+		}
+
+		model_parser parser(*source, snapshot);
+
+		if (indexing_inflater) {
+			// inflate what follows the document so that the index covers the whole file
+			const char* data;
+			size_t size;
+			while (source->next_chunk(data, size))
+				;
+
+			if (indexing_inflater->is_index_complete() && index.points.size() > 1)
+				index.write(file_name);
+		}
+
+		file_statistics stats;
+		stats.valid = true;
+		stats.nr_bytes = parser.get_nr_bytes();
+		stats.seconds = parser.get_seconds();
+		return stats;
+	}
+
+	/// parse files with nr_threads worker threads (0 for one per core) and merge them in the order of file_names;
+	/// compressed files are inflated with nr_inflate_threads threads (0 for the cores not used for parsing files)
+	static statistics load(const std::vector<std::string>& file_names, unsigned nr_threads, const merge_callback& merge,
+		unsigned nr_inflate_threads = 0)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		size_t count = file_names.size();
+
+		if (nr_threads == 0)
+			nr_threads = std::max(1u, std::thread::hardware_concurrency());
+		if (nr_threads > count)
+			nr_threads = unsigned(std::max(size_t(1), count));
+
+		statistics stats;
+		stats.nr_threads = nr_threads;
+
+		// cores not used for parsing files concurrently inflate segments of compressed files
+		if (nr_inflate_threads == 0)
+			nr_inflate_threads = std::max(1u, std::thread::hardware_concurrency() / nr_threads);
+
+		std::vector<file_statistics> file_stats(count);
+
+		if (nr_threads == 1) {
+			for (size_t i = 0; i < count; ++i) {
+				cell_snapshot snapshot;
+				file_stats[i] = read(file_names[i], snapshot, nr_inflate_threads);
+				merge(i, snapshot, file_stats[i]);
+			}
+		}
+		else {
+			std::mutex mutex;
+			std::condition_variable cv;
+
+			std::vector<std::unique_ptr<cell_snapshot>> snapshots(count);
+			size_t next_index = 0;
+			size_t merged_count = 0;
+			const size_t max_pending = 2 * size_t(nr_threads);
+
+			auto work = [&]() {
+				for (;;) {
+					size_t i;
+					{
+						std::unique_lock<std::mutex> lock(mutex);
+						cv.wait(lock, [&] { return next_index >= count || next_index < merged_count + max_pending; });
+
+						if (next_index >= count)
+							return;
+
+						i = next_index++;
+					}
+
+					std::unique_ptr<cell_snapshot> snapshot(new cell_snapshot());
+					file_stats[i] = read(file_names[i], *snapshot, nr_inflate_threads);
+
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						snapshots[i] = std::move(snapshot);
+					}
+					cv.notify_all();
+				}
+			};
+
+			std::vector<std::thread> threads;
+			for (unsigned t = 0; t < nr_threads; ++t)
+				threads.emplace_back(work);
+
+			// merge in file order while the workers continue parsing
+			for (size_t i = 0; i < count; ++i) {
+				std::unique_ptr<cell_snapshot> snapshot;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					cv.wait(lock, [&] { return snapshots[i] != nullptr; });
+					snapshot = std::move(snapshots[i]);
+				}
+
+				merge(i, *snapshot, file_stats[i]);
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					merged_count = i + 1;
+				}
+				cv.notify_all();
+			}
+
+			for (auto& thread : threads)
+				thread.join();
+		}
+
+		for (const auto& fs : file_stats) {
+			stats.nr_bytes += fs.nr_bytes;
+			stats.parse_seconds += fs.seconds;
+		}
+
+		auto stop = std::chrono::high_resolution_clock::now();
+		stats.wall_seconds = std::chrono::duration<double>(stop - start).count();
+
+		return stats;
+	}
+};
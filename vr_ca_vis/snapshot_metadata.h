@@ -0,0 +1,148 @@
+// Metadata of Morpheus snapshot files without parsing their cells
+//
+// The scan reads the time, the lattice extent and the cell types of a snapshot and counts the cells of every
+// Population together with the byte range of the Population element. Cells are skipped as a whole, so the node
+// coordinates are only searched for the next '<' instead of being tokenized and converted. Offsets refer to the
+// uncompressed xml, for compressed files they are positions in the inflated stream.
+//
+// Lazy loading scans the first snapshot of a directory, so the lattice extent is known before any time step is
+// parsed.
+//
+// Usage:
+// snapshot_metadata metadata;
+// if (metadata.scan(file_name)) ... metadata.time, metadata.extent, metadata.nr_cells, metadata.populations ...
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cgv/render/render_types.h>
+#include <cgv/utils/scan.h>
+
+#include "cell_data.h"
+#include "gzip_inflater.h"
+#include "model_parser.h"
+#include "snapshot_loader.h"
+#include "xml_scanner.h"
+
+struct snapshot_metadata : public cgv::render::render_types
+{
+	/// cells of one type in a snapshot
+	struct population
+	{
+		std::string type;
+		size_t nr_cells = 0;
+		// byte range of the Population element in the uncompressed xml
+		uint64_t begin = 0;
+		uint64_t end = 0;
+	};
+
+	std::string file_name;
+	// false if the file could not be read or has no MorpheusModel
+	bool valid = false;
+
+	// StartTime of the snapshot, the time in the file name if it has none
+	float time = 0.f;
+	ivec3 extent = ivec3(100, 100, 100);
+
+	std::vector<cell_type> types;
+	std::vector<population> populations;
+	size_t nr_cells = 0;
+
+	// uncompressed bytes scanned
+	size_t nr_bytes = 0;
+
+	/// scan the metadata of a single snapshot file, return whether it is valid
+	bool scan(const std::string& _file_name)
+	{
+		typedef xml_scanner::tag tag;
+
+		*this = snapshot_metadata();
+		file_name = _file_name;
+
+		bool has_time = false;
+
+		std::unique_ptr<xml_source> source;
+		if (snapshot_loader::is_compressed(file_name))
+			source.reset(new gzip_inflater(file_name));
+		else {
+			std::unique_ptr<xml_mapped_source> mapped_source(new xml_mapped_source(file_name));
+			if (mapped_source->is_open())
+				source = std::move(mapped_source);
+			else
+				source.reset(new xml_file_source(file_name));
+		}
+
+		xml_scanner scanner(*source);
+		tag t;
+
+		while (scanner.next_tag(t)) {
+			if (t.name == "MorpheusModel")
+				break;
+		}
+
+		if (t.kind == xml_scanner::TK_START && t.name == "MorpheusModel") {
+			valid = true;
+
+			scanner.for_each_child(t, [&](const tag& child) {
+				if (child.name == "Time") {
+					scanner.for_each_child(child, [&](const tag& time_tag) {
+						if (!(time_tag.name == "StartTime"))
+							return false;
+
+						cgv::utils::token value = time_tag.get_attribute("value");
+
+						double start_time;
+						if (cgv::utils::is_double(value.begin, value.end, start_time)) {
+							time = float(start_time);
+							has_time = true;
+						}
+
+						return false;
+					});
+				}
+				else if (child.name == "Space")
+					model_parser::parse_space(scanner, child, extent);
+				else if (child.name == "CellTypes")
+					model_parser::parse_cell_types(scanner, child, types);
+				else if (child.name == "CellPopulations") {
+					scanner.for_each_child(child, [&](const tag& population_tag) {
+						if (!(population_tag.name == "Population"))
+							return false;
+
+						population p;
+						p.type = to_string(population_tag.get_attribute("type"));
+						p.begin = population_tag.offset;
+
+						// cells are skipped completely, skip_element only looks for the tags around the nodes
+						scanner.for_each_child(population_tag, [&](const tag& cell_tag) {
+							if (cell_tag.name == "Cell")
+								++p.nr_cells;
+
+							return false;
+						});
+
+						p.end = scanner.get_offset();
+
+						nr_cells += p.nr_cells;
+						populations.push_back(p);
+						return true;
+					});
+				}
+				else
+					return false;
+
+				return true;
+			});
+		}
+
+		if (!has_time)
+			snapshot_loader::get_time(file_name, time);
+
+		nr_bytes = scanner.get_nr_bytes();
+
+		return valid;
+	}
+};
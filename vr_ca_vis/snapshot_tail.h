@@ -0,0 +1,260 @@
+// Follow a directory of Morpheus snapshots while a simulation is writing new ones
+//
+// A background thread waits for changes of the directory and parses every new snapshot matching the pattern as soon
+// as it is complete. On Linux the thread is woken by inotify and files reported as closed after writing or moved into
+// the directory are complete. Elsewhere, and for files without such an event, the directory is scanned once per
+// interval and a file counts as complete once its size and modification time did not change between two scans.
+// Parsed snapshots are queued in the order they were completed and taken over with fetch, which does not block and
+// is cheap enough to be called once per frame.
+//
+// Usage:
+// snapshot_tail tail(dir_name, "*.xml", file_names);
+// std::vector<snapshot_tail::entry> entries;
+// if (tail.fetch(entries))
+//    for (auto& e : entries)
+//       cell::append(*e.snapshot, cells);
+
+#pragma once
+
+#include <cgv/utils/dir.h>
+#include <cgv/utils/file.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "cell_data.h"
+#include "file_stamp.h"
+#include "snapshot_loader.h"
+
+class snapshot_tail
+{
+public:
+	struct entry
+	{
+		std::string file_name;
+		float time = 0.f;
+		std::unique_ptr<cell_snapshot> snapshot;
+		snapshot_loader::file_statistics stats;
+	};
+
+private:
+	std::string dir_name;
+	std::string pattern;
+	std::chrono::milliseconds interval;
+
+	// files that are parsed or were present when the tail was started
+	std::set<std::string> known_file_names;
+	// new files with their stamp at the last scan
+	std::map<std::string, file_stamp> candidates;
+	// names without directory of files for which the end of writing was reported
+	std::set<std::string> closed_names;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stop = false;
+	std::vector<entry> entries;
+
+	std::atomic<size_t> nr_parsed;
+
+#ifdef __linux__
+	int inotify_fd = -1;
+#endif
+
+	std::thread thread;
+
+	/// wait until the directory changed or the interval elapsed, return false if the tail is stopped
+	bool wait()
+	{
+#ifdef __linux__
+		if (inotify_fd >= 0) {
+			// poll in short slices so that stopping does not wait for a whole interval
+			const std::chrono::milliseconds slice(100);
+			auto deadline = std::chrono::steady_clock::now() + interval;
+
+			for (;;) {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (stop)
+						return false;
+				}
+
+				auto now = std::chrono::steady_clock::now();
+				if (now >= deadline)
+					return true;
+
+				pollfd pfd;
+				pfd.fd = inotify_fd;
+				pfd.events = POLLIN;
+				pfd.revents = 0;
+
+				int timeout = int(std::min(slice, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now)).count());
+				if (poll(&pfd, 1, timeout) > 0 && (pfd.revents & POLLIN) != 0 && read_events())
+					return true;
+			}
+		}
+#endif
+		std::unique_lock<std::mutex> lock(mutex);
+		return !cv.wait_for(lock, interval, [&] { return stop; });
+	}
+
+#ifdef __linux__
+	/// read pending inotify events, return true if a file was completed
+	bool read_events()
+	{
+		alignas(inotify_event) char buffer[4096];
+
+		ssize_t length = ::read(inotify_fd, buffer, sizeof(buffer));
+		if (length <= 0)
+			return false;
+
+		bool completed = false;
+		for (char* p = buffer; p < buffer + length; ) {
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+			if (event->len > 0 && (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0) {
+				closed_names.insert(event->name);
+				completed = true;
+			}
+			p += sizeof(inotify_event) + event->len;
+		}
+
+		return completed;
+	}
+#endif
+
+	/// return the new files that are complete in the order of their names
+	std::vector<std::string> scan()
+	{
+		std::vector<std::string> file_names;
+		cgv::utils::dir::glob(dir_name, file_names, pattern);
+		std::sort(file_names.begin(), file_names.end());
+
+		std::vector<std::string> complete_file_names;
+		for (const auto& file_name : file_names) {
+			if (known_file_names.find(file_name) != known_file_names.end())
+				continue;
+
+			file_stamp stamp;
+			if (!stamp.get(file_name))
+				continue;
+
+			auto closed = closed_names.find(cgv::utils::file::get_file_name(file_name));
+			auto candidate = candidates.find(file_name);
+
+			if (closed != closed_names.end() || (candidate != candidates.end() && candidate->second == stamp && stamp.size > 0)) {
+				complete_file_names.push_back(file_name);
+				known_file_names.insert(file_name);
+				candidates.erase(file_name);
+			}
+			else
+				candidates[file_name] = stamp;
+		}
+
+		// events of files that do not match the pattern are not needed anymore
+		closed_names.clear();
+
+		return complete_file_names;
+	}
+
+	void run()
+	{
+		do {
+			for (const auto& file_name : scan()) {
+				entry e;
+				e.file_name = file_name;
+
+				// files without a time in their name are ignored like during loading
+				if (!snapshot_loader::get_time(file_name, e.time))
+					continue;
+
+				e.snapshot.reset(new cell_snapshot());
+				e.stats = snapshot_loader::read(file_name, *e.snapshot);
+				++nr_parsed;
+
+				std::lock_guard<std::mutex> lock(mutex);
+				if (stop)
+					return;
+				entries.push_back(std::move(e));
+			}
+		} while (wait());
+	}
+
+public:
+	snapshot_tail(const snapshot_tail&) = delete;
+	snapshot_tail& operator=(const snapshot_tail&) = delete;
+
+	/// start following dir_name, files in known_file_names are skipped
+	snapshot_tail(const std::string& _dir_name, const std::string& _pattern, const std::vector<std::string>& _known_file_names,
+		std::chrono::milliseconds _interval = std::chrono::milliseconds(1000))
+		: dir_name(_dir_name), pattern(_pattern), interval(_interval),
+		known_file_names(_known_file_names.begin(), _known_file_names.end()), nr_parsed(0)
+	{
+#ifdef __linux__
+		inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotify_fd >= 0 && inotify_add_watch(inotify_fd, dir_name.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+			::close(inotify_fd);
+			inotify_fd = -1;
+		}
+#endif
+		thread = std::thread(&snapshot_tail::run, this);
+	}
+
+	~snapshot_tail()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		cv.notify_all();
+
+		thread.join();
+
+#ifdef __linux__
+		if (inotify_fd >= 0)
+			::close(inotify_fd);
+#endif
+	}
+
+	/// whether changes are reported by the operating system instead of only being detected by scanning
+	bool is_notified() const
+	{
+#ifdef __linux__
+		return inotify_fd >= 0;
+#else
+		return false;
+#endif
+	}
+
+	/// number of snapshots parsed since the tail was started
+	size_t get_nr_parsed() const
+	{
+		return nr_parsed;
+	}
+
+	/// move all parsed snapshots to _entries in the order they were completed, return false if there are none
+	bool fetch(std::vector<entry>& _entries)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (entries.empty())
+			return false;
+
+		for (auto& e : entries)
+			_entries.push_back(std::move(e));
+		entries.clear();
+		return true;
+	}
+};
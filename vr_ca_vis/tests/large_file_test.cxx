@@ -0,0 +1,119 @@
+// Write a cae file whose frame file is larger than 4 GB and read its frames back
+//
+// The frames are generated from their index, so frames behind the 4 GB boundary can be compared with the values
+// they were written from. The test returns 0 if all frames that are read back match and removes the files it wrote.
+//
+// Usage:
+// vr_ca_vis_large_file_test [<file name without extension>]
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../cae_file_format.h"
+#include "../positional_file.h"
+
+typedef cgv::math::fvec<uint16_t, 3> node_type;
+
+static const size_t nr_nodes = size_t(1) << 24;
+static const uint32_t nr_frames = 20;
+
+static void generate_frame(uint32_t ti, std::vector<node_type>& points, std::vector<uint32_t>& group_indices, std::vector<float>& attr_values)
+{
+	points.resize(nr_nodes);
+	group_indices.resize(nr_nodes);
+	attr_values.resize(nr_nodes);
+	for (size_t i = 0; i < nr_nodes; ++i) {
+		points[i] = node_type(uint16_t(i & 0xffff), uint16_t((i >> 16) + ti), uint16_t(ti));
+		group_indices[i] = uint32_t(i / 8 + ti);
+		attr_values[i] = float(i % 1000) + 0.5f * ti;
+	}
+}
+
+static bool run(const std::string& file_name)
+{
+	std::vector<node_type> points;
+	std::vector<uint32_t> group_indices;
+	std::vector<float> attr_values;
+
+	cae::binary_file writer;
+	writer.format.flags = cae::FF_FRAME_BASED | cae::FF_SEPARATE_FRAME_FILE;
+	writer.format.point_coord_type = cae::CT_UINT16;
+	writer.format.group_index_type = cae::CT_UINT32;
+	writer.format.attribute_type = cae::CT_FLT32;
+	writer.nr_attributes = 1;
+	writer.attr_names.push_back("value");
+
+	for (uint32_t ti = 0; ti < nr_frames; ++ti) {
+		generate_frame(ti, points, group_indices, attr_values);
+		if (!writer.append_time_step(file_name, float(ti), points, group_indices, attr_values, false)) {
+			std::cerr << "couldn't append time step " << ti << " to " << file_name << std::endl;
+			return false;
+		}
+	}
+	if (!writer.write_header(file_name + ".cae")) {
+		std::cerr << "couldn't write " << file_name << ".cae" << std::endl;
+		return false;
+	}
+
+	uint64_t file_size = 0;
+	{
+		positional_file caf;
+		if (caf.open(file_name + ".caf"))
+			file_size = caf.get_size();
+	}
+	std::cout << "wrote " << file_name << ".caf with " << file_size << " bytes" << std::endl;
+	if (file_size <= (uint64_t(1) << 32)) {
+		std::cerr << file_name << ".caf is not larger than 4 GB" << std::endl;
+		return false;
+	}
+
+	cae::binary_file reader;
+	if (!reader.read_header(file_name + ".cae")) {
+		std::cerr << "couldn't read " << file_name << ".cae" << std::endl;
+		return false;
+	}
+	if (reader.nr_time_steps != nr_frames || reader.nr_points != uint64_t(nr_frames) * nr_nodes) {
+		std::cerr << "header of " << file_name << ".cae lists " << reader.nr_time_steps << " time steps with "
+			<< reader.nr_points << " points" << std::endl;
+		return false;
+	}
+
+	// the first frame and the frames that start or end behind 4 GB
+	std::vector<node_type> frame_points;
+	std::vector<uint32_t> frame_groups;
+	std::vector<float> frame_attrs;
+	bool success = true;
+	for (uint32_t ti : { 0u, nr_frames - 2, nr_frames - 1 }) {
+		generate_frame(ti, points, group_indices, attr_values);
+		if (!reader.read_time_step(file_name, ti, frame_points, frame_groups, frame_attrs)) {
+			std::cerr << "couldn't read time step " << ti << " of " << file_name << std::endl;
+			success = false;
+		}
+		else if (frame_points != points || frame_groups != group_indices || frame_attrs != attr_values) {
+			std::cerr << "time step " << ti << " of " << file_name << " differs from the written one" << std::endl;
+			success = false;
+		}
+		else
+			std::cout << "read time step " << ti << std::endl;
+	}
+	reader.close_frame_file();
+	return success;
+}
+
+int main(int argc, char** argv)
+{
+	std::string file_name = argc > 1 ? argv[1] : "large_file_test";
+
+	std::remove((file_name + ".cae").c_str());
+	std::remove((file_name + ".caf").c_str());
+
+	bool success = run(file_name);
+
+	std::remove((file_name + ".cae").c_str());
+	std::remove((file_name + ".caf").c_str());
+
+	std::cout << (success ? "passed" : "failed") << std::endl;
+	return success ? 0 : 1;
+}
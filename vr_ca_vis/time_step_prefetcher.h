@@ -0,0 +1,174 @@
+// Prepare time steps that are likely shown next on worker threads
+//
+// The owner requests the time steps it expects to show next, for example the following ones during an animation.
+// Worker threads call the prepare function for each of them, which decodes the cells if needed and builds the grid
+// and the vertex id arrays. When a time step is shown, take hands out its prepared data so that showing it only swaps
+// pointers. Results of time steps that are not requested anymore are dropped.
+//
+// The prepare function runs concurrently with the owner. Before the owner changes data that is read by it, cancel has
+// to be called, which drops all requests and waits for running preparations to finish.
+//
+// Usage:
+// time_step_prefetcher prefetcher([&](uint32_t ti) { ... return prepared; });
+// prefetcher.request({ ti + 1, ti + 2 });
+// std::unique_ptr<prepared_time_step> prepared = prefetcher.take(ti + 1);
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "cell_data.h"
+#include "cells_container.h"
+
+/// data of a time step that is prepared for being shown
+struct prepared_time_step
+{
+	// merged cells of the time step if it is loaded lazily, otherwise the cells are already in memory
+	std::unique_ptr<cell_snapshot> snapshot;
+	// grid and vertex ids of the cells
+	prepared_cells cells;
+};
+
+class time_step_prefetcher
+{
+public:
+	typedef std::function<std::unique_ptr<prepared_time_step>(uint32_t ti)> prepare_function;
+
+private:
+	prepare_function prepare;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+
+	// requested time steps that are not prepared yet in order of the request
+	std::deque<uint32_t> pending;
+	std::set<uint32_t> in_progress;
+	std::map<uint32_t, std::unique_ptr<prepared_time_step>> ready;
+
+	// incremented by cancel, results of preparations started before are dropped
+	uint64_t generation = 0;
+	bool stop = false;
+
+	std::vector<std::thread> threads;
+
+	void work()
+	{
+		for (;;) {
+			uint32_t ti;
+			uint64_t started_generation;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [&] { return stop || !pending.empty(); });
+
+				if (stop)
+					return;
+
+				ti = pending.front();
+				pending.pop_front();
+				in_progress.insert(ti);
+				started_generation = generation;
+			}
+
+			std::unique_ptr<prepared_time_step> prepared = prepare(ti);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				in_progress.erase(ti);
+				if (prepared && started_generation == generation)
+					ready[ti] = std::move(prepared);
+			}
+			cv.notify_all();
+		}
+	}
+
+public:
+	time_step_prefetcher(const time_step_prefetcher&) = delete;
+	time_step_prefetcher& operator=(const time_step_prefetcher&) = delete;
+
+	time_step_prefetcher(const prepare_function& _prepare, unsigned nr_threads = 1) : prepare(_prepare)
+	{
+		if (nr_threads < 1)
+			nr_threads = 1;
+
+		for (unsigned t = 0; t < nr_threads; ++t)
+			threads.emplace_back(&time_step_prefetcher::work, this);
+	}
+
+	~time_step_prefetcher()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		cv.notify_all();
+
+		for (auto& thread : threads)
+			thread.join();
+	}
+
+	/// prepare the given time steps in this order, prepared time steps that are not among them are dropped
+	void request(const std::vector<uint32_t>& time_steps)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			std::set<uint32_t> requested(time_steps.begin(), time_steps.end());
+			for (auto it = ready.begin(); it != ready.end(); ) {
+				if (requested.find(it->first) == requested.end())
+					it = ready.erase(it);
+				else
+					++it;
+			}
+
+			pending.clear();
+			for (uint32_t ti : time_steps)
+				if (ready.find(ti) == ready.end() && in_progress.find(ti) == in_progress.end() &&
+					std::find(pending.begin(), pending.end(), ti) == pending.end())
+					pending.push_back(ti);
+		}
+		cv.notify_all();
+	}
+
+	/// return the prepared data of time step ti and wait if it is being prepared; return nullptr if ti was not
+	/// requested or its preparation failed
+	std::unique_ptr<prepared_time_step> take(uint32_t ti)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&] { return in_progress.find(ti) == in_progress.end(); });
+
+		auto it = ready.find(ti);
+		if (it == ready.end())
+			return nullptr;
+
+		std::unique_ptr<prepared_time_step> prepared = std::move(it->second);
+		ready.erase(it);
+		return prepared;
+	}
+
+	/// drop all requests and prepared time steps and wait until no time step is prepared anymore
+	void cancel()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		pending.clear();
+		ready.clear();
+		++generation;
+		cv.wait(lock, [&] { return in_progress.empty(); });
+	}
+
+	/// number of prepared time steps that are waiting to be shown
+	size_t get_nr_ready()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return ready.size();
+	}
+};
@@ -26,7 +26,17 @@
 #include "clipping_planes_container.h"
 #include "model_parser.h"
 #include "gzip_inflater.h"
+#include "snapshot_loader.h"
+#include "snapshot_metadata.h"
+#include "cell_cache.h"
+#include "snapshot_tail.h"
+#include "frame_cache.h"
+#include "time_step_prefetcher.h"
+#include "ooc_stream.h"
+#include "cell_trajectories.h"
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <limits>
 #include <cgv/utils/dir.h>
 
@@ -94,6 +104,8 @@ protected:
 
 	// cell data
 	std::vector<cell> cells;
+	// cells of all time steps by id, only built if all time steps are loaded
+	cell_trajectories trajectories;
 
 	//std::unordered_map<std::string, cell_type> cell_types;
 	//std::unordered_set<std::string> types;
@@ -146,13 +158,46 @@ protected:
 	uint32_t current_time_step = UINT32_MAX;
 	uint32_t time_step;
 
-	// ooc handling
+	// ooc handling, the time steps of the cell cache ooc_file_name are streamed from disk by ooc with a memory
+	// budget of ooc_budget MB instead of being loaded up front
 	bool ooc_mode;
 	std::string ooc_file_name;
+	unsigned ooc_budget = 1024;
+	std::unique_ptr<ooc_stream> ooc;
 
 	std::string dir_name;
 	std::string file_name;
 
+	// number of threads used to parse snapshots, 0 for one per core
+	unsigned nr_loader_threads = 0;
+
+	// snapshot files of dir_name that are loaded
+	std::vector<std::string> snapshot_file_names;
+	bool snapshots_compressed = false;
+
+	// live tail of dir_name, new snapshots are parsed in the background and appended as new time steps
+	bool live_tail = false;
+	// whether to advance to new time steps if the last time step is shown
+	bool follow_tail = true;
+	std::unique_ptr<snapshot_tail> tail;
+
+	// lazy loading indexes dir_name and parses a time step only when it is shown, the parsed time steps are kept in
+	// a least recently used cache of frame_cache_size frames
+	bool lazy_loading = false;
+	unsigned frame_cache_size = 8;
+	frame_cache frames;
+	// whether the loaded directory is loaded lazily, only changed while no time step is prefetched
+	bool lazy_dir = false;
+	// memory of the shown time step and of all cached frames in MB
+	float frame_memory = 0.f;
+	float frame_cache_memory = 0.f;
+
+	// prefetching prepares the time steps that are likely shown next on a worker thread
+	bool prefetch = true;
+	// direction of the last step, +1 forward and -1 backward
+	int time_direction = 1;
+	std::unique_ptr<time_step_prefetcher> prefetcher;
+
 	// render parameters
 	bool use_boxes;
 	vec3 box_extent;
@@ -216,95 +261,162 @@ protected:
 public:
 	bool read_file(const std::string& file_name)
 	{
-		//if (!read(file_name, cells))
-		//	return false;
+		time_step_start.clear();
+		times.clear();
 
-		//construct_group_information(nr_groups);
-		//update_colors();
-		//return true;
-		return false;
+		if (!cell_cache::read(file_name, cells, time_step_start, times, extent))
+			return false;
+
+		extent_scale = dvec3(1.0) / extent;
+		return true;
 	}
-	bool write_file(const std::string& file_name) const
+	bool write_file(const std::string& file_name, const std::vector<std::string>& snapshot_file_names) const
 	{
-		//return write(file_name, points, group_indices, attr_values);
-		return false;
+		return cell_cache::write(file_name, snapshot_file_names, cells, time_step_start, times, extent);
+	}
+	/// index the cells of all loaded time steps by id
+	void build_trajectories()
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		trajectories.build(cells, time_step_start);
+		auto stop = std::chrono::high_resolution_clock::now();
+		std::cout << "indexed " << trajectories.get_nr_ids() << " cell ids in "
+			<< std::chrono::duration<double>(stop - start).count() << " s" << std::endl;
 	}
 	void reset()
 	{
+		prefetcher->cancel();
+
 		cell_unselected_counter = max_cell_unselected_counter;
 
 		cells_ctr->unset_cells();
 
 		cells.clear();
+		trajectories.clear();
 
 		cell::types.clear();
 
 		cell::centers.clear();
 		cell::nodes.clear();
+		cell::properties.clear();
+
+		frames.clear();
+		lazy_dir = false;
+
+		ooc.reset();
+		ooc_file_name.clear();
 	}
-	bool read_xml_dir(const std::string& dir_name)
+	bool read_snapshots(const std::vector<std::string>& file_names, bool compressed)
 	{
 		time_step_start.clear();
 		times.clear();
 
-		std::vector<std::string> file_names;
-		if (cgv::utils::dir::glob(dir_name, file_names, "*.xml"))
+		// collect snapshots with a valid time first, so that the loader only sees files that will be merged
+		std::vector<std::string> snapshot_file_names;
+		std::vector<float> snapshot_times;
+
+		for (const auto& file_name : file_names)
 		{
-			for (const auto& file_name : file_names)
-			{
-				std::string time_str = cgv::utils::file::get_file_name(file_name);
-				time_str = cgv::utils::file::drop_extension(time_str);
-				time_str = time_str.substr(time_str.size() - 6);
-
-				int time;
-				if (!cgv::utils::is_integer(time_str, time))
-					continue;
-
-				if (times.empty() || times.back() != float(time)) {
-					//std::cout << "t = " << t << " max = " << max_time_step << std::endl;
-					time_step_start.push_back(cells.size());
-					times.push_back(float(time));
-				}
+			float time;
+			if (!snapshot_loader::get_time(file_name, time))
+				continue;
 
-				size_t previous_cell_count = cells.size();
+			snapshot_file_names.push_back(file_name);
+			snapshot_times.push_back(time);
+		}
 
-				model_parser parser(file_name, extent, cells);
-				extent_scale = dvec3(1.0) / extent;
+		// snapshots are parsed in parallel but merged in file order, which gives the same result as a sequential load
+		snapshot_loader::statistics stats = snapshot_loader::load(snapshot_file_names, nr_loader_threads,
+			[&](size_t index, cell_snapshot& snapshot, const snapshot_loader::file_statistics& file_stats) {
+			float time = snapshot_times[index];
 
-				std::cout << "read " << file_name << " with " << cells.size() - previous_cell_count << " cells" << std::endl;
+			if (times.empty() || times.back() != time) {
+				//std::cout << "t = " << t << " max = " << max_time_step << std::endl;
+				time_step_start.push_back(cells.size());
+				times.push_back(time);
 			}
-		}
 
-		return file_names.size() > 0;
+			cell::append(snapshot, cells);
+
+			extent = snapshot.extent;
+			extent_scale = dvec3(1.0) / extent;
+
+			std::cout << "read " << snapshot_file_names[index] << " with " << snapshot.cells.size() << " cells ("
+				<< file_stats.nr_bytes / (1024 * 1024) << " MB at "
+				<< (file_stats.seconds > 0.0 ? file_stats.nr_bytes / (1024.0 * 1024.0) / file_stats.seconds : 0.0) << " MB/s)" << std::endl;
+		});
+
+		if (stats.wall_seconds > 0.0)
+			std::cout << "parsed " << stats.nr_bytes / (1024 * 1024) << " MB in " << stats.wall_seconds << " s ("
+				<< stats.get_throughput() << " MB/s) with " << stats.nr_threads << " threads" << std::endl;
+
+		return snapshot_file_names.size() > 0;
 	}
-	bool read_gz_dir(const std::string& dir_name)
+	/// find uncompressed snapshots or, if there are none, compressed snapshots in dir_name
+	bool find_snapshots(const std::string& dir_name, std::vector<std::string>& file_names, bool& compressed)
 	{
-		std::vector<std::string> file_names;
-		if (cgv::utils::dir::glob(dir_name, file_names, "*.xml.gz"))
-		{
-			for (const auto& file_name : file_names)
-			{
-				std::string xml_file_name = cgv::utils::file::drop_extension(file_name);
+		file_names.clear();
 
-				gzip_inflater(file_name, xml_file_name);
-			}
+		cgv::utils::dir::glob(dir_name, file_names, "*.xml");
+		compressed = false;
+
+		if (file_names.empty()) {
+			cgv::utils::dir::glob(dir_name, file_names, "*.xml.gz");
+			compressed = true;
 		}
 
-		return file_names.size() > 0;
+		return !file_names.empty();
 	}
 	bool read_data_dir_ascii(const std::string& dir_name)
 	{
 		reset();
 
-		std::string fn = dir_name + ".cae";
-		//if (cgv::utils::file::exists(fn))
-		//	if (read_file(fn))
-		//		return true;
+		std::vector<std::string>& file_names = snapshot_file_names;
+		bool& compressed = snapshots_compressed;
+		if (!find_snapshots(dir_name, file_names, compressed))
+			return false;
+
+		// in lazy mode only file names and times are read, time steps are parsed in show_lazy_time_step
+		if (lazy_loading) {
+			time_step_start.clear();
+			times.clear();
+
+			frames.set_capacity(frame_cache_size);
+			if (!frames.index(file_names))
+				return false;
+
+			for (size_t ti = 0; ti < frames.get_nr_time_steps(); ++ti)
+				times.push_back(frames.get_time(ti));
+
+			// the times come from the file names and the lattice extent from a metadata scan of the first snapshot,
+			// which skips its cells, so no snapshot is parsed before the first time step is shown
+			snapshot_metadata metadata;
+			if (metadata.scan(file_names.front())) {
+				extent = metadata.extent;
+				extent_scale = dvec3(1.0) / extent;
+			}
+			lazy_dir = true;
+
+			std::cout << "indexed " << times.size() << " time steps of " << dir_name << " for lazy loading" << std::endl;
+			return true;
+		}
 
-		//attr_names.push_back("b");
-		//nr_attributes = uint32_t(attr_names.size());
+		// the binary cache next to the directory is used as long as none of the snapshots changed
+		bool from_cache = false;
+		if (cell_cache::is_valid(dir_name, file_names)) {
+			auto start = std::chrono::high_resolution_clock::now();
 
-		if (read_xml_dir(dir_name) || read_gz_dir(dir_name) && read_xml_dir(dir_name))
+			from_cache = read_file(dir_name);
+			if (from_cache) {
+				auto stop = std::chrono::high_resolution_clock::now();
+				std::cout << "read " << cells.size() << " cells in " << times.size() << " time steps from cache " << dir_name << ".cae in "
+					<< std::chrono::duration<double>(stop - start).count() << " s" << std::endl;
+			}
+			else
+				reset();
+		}
+
+		if (from_cache || read_snapshots(file_names, compressed))
 		{
 			//for (auto id : group_indices)
 			//{
@@ -329,9 +441,10 @@ public:
 			//std::cout << "read " << file_name << " with "
 			//	<< cells.size() << " points, " << times.size() << " time steps, " << group_colors.size() << " ids, and "
 			//	<< nr_attributes << " attributes" << std::endl;
-			// concatenate
-			//write_file(fn);
+			if (!from_cache && !write_file(dir_name, file_names))
+				std::cerr << "couldn't write cache " << dir_name << ".cae" << std::endl;
 
+			build_trajectories();
 			cells_ctr->set_cell_types(cell::types);
 			return true;
 		}
@@ -340,23 +453,166 @@ public:
 			return false;
 		}
 	}
+	/// start or stop the live tail of dir_name according to live_tail
+	void update_tail()
+	{
+		tail.reset();
+
+		if (!live_tail || dir_name.empty())
+			return;
+
+		tail.reset(new snapshot_tail(dir_name, snapshots_compressed ? "*.xml.gz" : "*.xml", snapshot_file_names));
+		std::cout << "following " << dir_name << (tail->is_notified() ? " with change notifications" : " by scanning") << std::endl;
+	}
+	/// append the snapshots parsed by the live tail since the last call as new time steps
+	void append_tail_snapshots()
+	{
+		std::vector<snapshot_tail::entry> entries;
+		if (!tail || !tail->fetch(entries))
+			return;
+
+		// prefetched time steps refer to the arrays that are extended
+		prefetcher->cancel();
+
+		bool at_last_time_step = time_step + 1 >= times.size();
+
+		// in lazy mode the parsed snapshots go to the frame cache
+		if (lazy_dir) {
+			for (auto& e : entries) {
+				std::cout << "tail " << e.file_name << " with " << e.snapshot->cells.size() << " cells" << std::endl;
+
+				snapshot_file_names.push_back(e.file_name);
+				size_t ti = frames.add_snapshot(e.file_name, e.time, std::move(e.snapshot));
+				if (ti == times.size())
+					times.push_back(e.time);
+				else if (ti == time_step)
+					current_time_step = UINT32_MAX;
+			}
+			update_frame_memory();
+		}
+		else
+			append_tail_cells(entries);
+
+		if (find_control(time_step))
+			find_control(time_step)->set("max", times.size() - 1);
+
+		if (follow_tail && at_last_time_step && !times.empty()) {
+			time_step = uint32_t(times.size() - 1);
+			on_set(&time_step);
+		}
+		else
+			post_redraw();
+	}
+	/// append the cells of snapshots parsed by the live tail as new time steps
+	void append_tail_cells(std::vector<snapshot_tail::entry>& entries)
+	{
+		size_t nr_cells = 0, nr_centers = 0, nr_nodes = 0, nr_properties = 0;
+		for (const auto& e : entries) {
+			nr_cells += e.snapshot->cells.size();
+			nr_centers += e.snapshot->centers.size();
+			nr_nodes += e.snapshot->nodes.size();
+			nr_properties += e.snapshot->properties.size();
+		}
+
+		// growing the arrays moves them, which must not happen while the grid of the shown time step is built from
+		// them; reserving twice the size keeps this to a few times during a simulation
+		auto must_grow = [](size_t size, size_t capacity, size_t count) { return size + count > capacity; };
+		if (must_grow(cells.size(), cells.capacity(), nr_cells) ||
+			must_grow(cell::centers.size(), cell::centers.capacity(), nr_centers) ||
+			must_grow(cell::nodes.size(), cell::nodes.capacity(), nr_nodes) ||
+			must_grow(cell::properties.size(), cell::properties.capacity(), nr_properties)) {
+			cells_ctr->unset_cells();
+			current_time_step = UINT32_MAX;
+
+			cells.reserve(std::max(cells.size() + nr_cells, 2 * cells.size()));
+			cell::centers.reserve(std::max(cell::centers.size() + nr_centers, 2 * cell::centers.size()));
+			cell::nodes.reserve(std::max(cell::nodes.size() + nr_nodes, 2 * cell::nodes.size()));
+			cell::properties.reserve(std::max(cell::properties.size() + nr_properties, 2 * cell::properties.size()));
+		}
+
+		size_t nr_types = cell::types.size();
+
+		for (auto& e : entries) {
+			if (times.empty() || times.back() != e.time) {
+				time_step_start.push_back(cells.size());
+				times.push_back(e.time);
+			}
+			// the last time step grows if the snapshot has the same time
+			else if (time_step + 1 == times.size())
+				current_time_step = UINT32_MAX;
+
+			size_t begin = cells.size();
+			cell::append(*e.snapshot, cells);
+			trajectories.add_cells(uint32_t(times.size() - 1), cells, begin, cells.size());
+			snapshot_file_names.push_back(e.file_name);
+
+			extent = e.snapshot->extent;
+			extent_scale = dvec3(1.0) / extent;
+
+			std::cout << "tail " << e.file_name << " with " << e.snapshot->cells.size() << " cells ("
+				<< e.stats.nr_bytes / (1024 * 1024) << " MB in " << e.stats.seconds << " s)" << std::endl;
+		}
+
+		// new cell types change the type indices of cell::types
+		if (cell::types.size() != nr_types) {
+			cells_ctr->set_cell_types(cell::types);
+			current_time_step = UINT32_MAX;
+		}
+	}
+	/// open the cell cache of file_name for out-of-core playback, only the headers are read here
 	bool open_ooc(const std::string& file_name)
 	{
-		if (!read_header(file_name + ".cae"))
+		reset();
+		time_step_start.clear();
+		times.clear();
+
+		std::unique_ptr<ooc_stream> stream(new ooc_stream());
+		if (!stream->open(file_name, size_t(ooc_budget) << 20))
 			return false;
-		//construct_group_information(nr_groups);
+
+		ooc = std::move(stream);
 		ooc_file_name = file_name;
+		times = ooc->get_times();
+		extent = ooc->get_extent();
+		extent_scale = dvec3(1.0) / extent;
+
+		std::cout << "opened " << file_name << ".cae with " << times.size() << " time steps for out-of-core playback with "
+			<< ooc_budget << " MB read ahead" << std::endl;
 		return true;
 	}
+	/// start reading time step ti and the following ones in the direction of playback
 	bool read_ooc_time_step(const std::string& file_name, unsigned ti)
 	{
-		//if (!read_time_step(file_name, ti, data.points, group_indices, attr_values))
-		//	return false;
-		//update_colors();
+		if (!ooc || file_name != ooc_file_name)
+			return false;
+
+		ooc->set_position(ti, time_direction);
+		return true;
+	}
+	/// open file_name, which names a cell cache with or without its extension, out-of-core or by reading it completely
+	bool open_file(const std::string& file_name)
+	{
+		std::string base_name = file_name;
+		if (cgv::utils::file::get_extension(base_name) == "cae")
+			base_name = cgv::utils::file::drop_extension(base_name);
+		if (cgv::utils::file::get_extension(base_name) == "cells")
+			base_name = cgv::utils::file::drop_extension(base_name);
+
+		if (ooc_mode)
+			return open_ooc(base_name);
+
+		reset();
+		if (!read_file(base_name))
+			return false;
+
+		build_trajectories();
+		cells_ctr->set_cell_types(cell::types);
+		std::cout << "read " << cells.size() << " cells in " << times.size() << " time steps from " << base_name << ".cae" << std::endl;
 		return true;
 	}
 	void step()
 	{
+		time_direction = 1;
 		++time_step;
 		if (time_step >= times.size())
 			time_step = 0;
@@ -364,6 +620,7 @@ public:
 	}
 	void step_back()
 	{
+		time_direction = -1;
 		if (time_step == 0)
 			time_step = uint32_t(times.size() - 1);
 		else
@@ -376,6 +633,7 @@ public:
 			double d = 60.0 * (double)trigger[1] * dt;
 			time_delta += (float)d;
 			if (time_delta >= 1.0f) {
+				time_direction = 1;
 				time_step += (int)time_delta;
 				time_delta -= (int)time_delta;
 				if (time_step >= times.size())
@@ -432,6 +690,8 @@ public:
 #endif
 		connect(cgv::gui::get_animation_trigger().shoot, this, &vr_ca_vis::timer_event);
 
+		prefetcher.reset(new time_step_prefetcher([this](uint32_t ti) { return prepare_time_step(ti); }));
+
 		vr_view_ptr = 0;
 
 		surf_rs.illumination_mode = cgv::render::IlluminationMode::IM_OFF;
@@ -470,13 +730,40 @@ public:
 			if (ooc_mode && !ooc_file_name.empty())
 				read_ooc_time_step(ooc_file_name, time_step);
 		}
+		if (member_ptr == &file_name && !file_name.empty()) {
+			tail.reset();
+			if (!open_file(file_name))
+				std::cerr << "couldn't open " << file_name << std::endl;
+			current_time_step = UINT32_MAX;
+			time_step = 0;
+			on_set(&time_step);
+			post_recreate_gui();
+		}
+		if (member_ptr == &ooc_mode && !file_name.empty())
+			on_set(&file_name);
+		if (member_ptr == &ooc_budget && ooc) {
+			ooc->set_budget(size_t(ooc_budget) << 20);
+			update_frame_memory();
+		}
 		if (member_ptr == &dir_name) {
+			tail.reset();
 			read_data_dir_ascii(dir_name);
+			update_tail();
 			current_time_step = UINT32_MAX;
 			time_step = 0;
 			on_set(&time_step);
 			post_recreate_gui();
 		}
+		if (member_ptr == &live_tail)
+			update_tail();
+		if (member_ptr == &lazy_loading && !dir_name.empty())
+			on_set(&dir_name);
+		if (member_ptr == &prefetch && !prefetch)
+			prefetcher->cancel();
+		if (member_ptr == &frame_cache_size) {
+			frames.set_capacity(frame_cache_size);
+			update_frame_memory();
+		}
 		//if (member_ptr == &opacity) {
 		//	if (use_boxes ? box_style.use_group_color : sphere_style.use_group_color)
 		//		for (auto& c : group_colors) {
@@ -495,7 +782,15 @@ public:
 		return
 			rh.reflect_member("animate", animate) &&
 			rh.reflect_member("file_name", file_name) &&
-			rh.reflect_member("dir_name", dir_name);
+			rh.reflect_member("dir_name", dir_name) &&
+			rh.reflect_member("nr_loader_threads", nr_loader_threads) &&
+			rh.reflect_member("live_tail", live_tail) &&
+			rh.reflect_member("follow_tail", follow_tail) &&
+			rh.reflect_member("lazy_loading", lazy_loading) &&
+			rh.reflect_member("frame_cache_size", frame_cache_size) &&
+			rh.reflect_member("prefetch", prefetch) &&
+			rh.reflect_member("ooc_mode", ooc_mode) &&
+			rh.reflect_member("ooc_budget", ooc_budget);
 	}
 	bool init(cgv::render::context& ctx)
 	{
@@ -545,10 +840,13 @@ public:
 				}
 			}
 		}
+		append_tail_snapshots();
+
 		if (current_time_step != time_step) {
 			current_time_step = time_step;
 
 			compute_visible_points();
+			request_prefetch();
 		}
 	}
 	void clear(cgv::render::context& ctx)
@@ -833,6 +1131,7 @@ public:
 	{
 		add_decorator("bio math", "heading");
 		add_gui("data_dir", dir_name, "directory", "title='Data Directory'");
+		add_gui("cae_file", file_name, "file_name", "title='Open Cell Cache';filter='Cell Cache (cae):*.cae|All Files:*.*'");
 		add_member_control(this, "animate", animate, "toggle", "shortcut='A'");
 		add_member_control(this, "animation_speed", animation_speed, "value_slider", "min=0.1;step=0.00001;max=5;log=true;ticks=true");
 		add_member_control(this, "scale", scale, "value_slider", "min=0.0001;step=0.00001;max=10;log=true;ticks=true");
@@ -882,6 +1181,21 @@ public:
 			align("\b");
 			end_tree_node(surf_rs);
 		}
+		if (begin_tree_node("Loading", nr_loader_threads, false)) {
+			align("\a");
+			add_member_control(this, "nr_loader_threads", nr_loader_threads, "value_slider", "min=0;max=64;ticks=true");
+			add_member_control(this, "live_tail", live_tail, "toggle");
+			add_member_control(this, "follow_tail", follow_tail, "toggle");
+			add_member_control(this, "lazy_loading", lazy_loading, "toggle");
+			add_member_control(this, "frame_cache_size", frame_cache_size, "value_slider", "min=1;max=256;log=true;ticks=true");
+			add_view("frame_MB", frame_memory);
+			add_view("frame_cache_MB", frame_cache_memory);
+			add_member_control(this, "prefetch", prefetch, "toggle");
+			add_member_control(this, "ooc_mode", ooc_mode, "toggle");
+			add_member_control(this, "ooc_budget_MB", ooc_budget, "value_slider", "min=64;max=65536;log=true;ticks=true");
+			align("\b");
+			end_tree_node(nr_loader_threads);
+		}
 		//if (begin_tree_node("Box Rendering", box_style, false)) {
 		//	align("\a");
 		//	add_gui("box_style", box_style);
@@ -892,8 +1206,163 @@ public:
 		inline_object_gui(cells_ctr);
 		inline_object_gui(clipping_planes_ctr);
 	}
+	void update_frame_memory()
+	{
+		frame_cache_memory = float((frames.get_memory() + (ooc ? ooc->get_memory() : 0)) / (1024.0 * 1024.0));
+		update_member(&frame_memory);
+		update_member(&frame_cache_memory);
+	}
+	/// decode the cells of time step ti if it is loaded lazily and build its grid and vertex ids, called by the
+	/// prefetcher on a worker thread
+	std::unique_ptr<prepared_time_step> prepare_time_step(uint32_t ti)
+	{
+		std::unique_ptr<prepared_time_step> prepared(new prepared_time_step());
+
+		if (ooc) {
+			prepared->snapshot = ooc->take(ti);
+			if (!prepared->snapshot)
+				return nullptr;
+
+			const cell_snapshot& s = *prepared->snapshot;
+			prepared->cells.prepare(s.cells, s.nodes, 0, s.cells.size(), s.extent);
+		}
+		else if (lazy_dir) {
+			std::shared_ptr<const frame_cache::frame> f = frames.get(ti);
+			if (!f)
+				return nullptr;
+
+			prepared->snapshot.reset(new cell_snapshot());
+			for (const auto& snapshot : f->snapshots)
+				prepared->snapshot->append(*snapshot);
+
+			const cell_snapshot& s = *prepared->snapshot;
+			prepared->cells.prepare(s.cells, s.nodes, 0, s.cells.size(), s.extent);
+		}
+		else {
+			if (ti >= time_step_start.size())
+				return nullptr;
+
+			size_t start = time_step_start[ti];
+			size_t end = (ti + 1 == time_step_start.size() ? cells.size() : time_step_start[ti + 1]);
+
+			prepared->cells.prepare(cells, cell::nodes, start, end, extent);
+		}
+
+		return prepared;
+	}
+	/// request the time steps that follow in the direction of the last step, two of them if steps follow quickly
+	void request_prefetch()
+	{
+		if (!prefetch || times.size() < 2)
+			return;
+
+		// steps per second of the animation or of scrubbing with the trigger
+		float rate = animate ? 2.f * animation_speed : 60.f * trigger[1];
+		unsigned count = rate > 2.f ? 2 : 1;
+
+		uint32_t nr_time_steps = uint32_t(times.size());
+		std::vector<uint32_t> time_steps;
+
+		uint32_t ti = time_step;
+		for (unsigned i = 0; i < count; ++i) {
+			ti = (ti + nr_time_steps + time_direction) % nr_time_steps;
+			if (ti != time_step)
+				time_steps.push_back(ti);
+		}
+
+		prefetcher->request(time_steps);
+	}
+	/// replace the cells of a lazily loaded directory by the cells of the shown time step
+	void assign_lazy_time_step(cell_snapshot& snapshot)
+	{
+		// the grid must not be built from the arrays while they are replaced
+		cells_ctr->unset_cells();
+
+		size_t nr_types = cell::types.size();
+		cell::assign(snapshot, cells);
+
+		if (cell::types.size() != nr_types)
+			cells_ctr->set_cell_types(cell::types);
+
+		extent = snapshot.extent;
+		extent_scale = dvec3(1.0) / extent;
+
+		frame_memory = float(cells.size() * sizeof(cell) + cell::centers.size() * sizeof(vec3) + cell::nodes.size() * sizeof(lattice_node) +
+			cell::properties.size() * sizeof(float)) / (1024.f * 1024.f);
+		update_frame_memory();
+	}
+	/// replace the cells by the cells of the shown time step, which is parsed if it is not in the frame cache
+	void show_lazy_time_step()
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		bool cached = frames.is_cached(time_step);
+
+		std::shared_ptr<const frame_cache::frame> f = frames.get(time_step, std::max(1u, std::thread::hardware_concurrency()));
+		if (!f)
+			return;
+
+		cell_snapshot snapshot;
+		for (const auto& s : f->snapshots)
+			snapshot.append(*s);
+
+		assign_lazy_time_step(snapshot);
+
+		cells_ctr->set_cells(&cells, 0, cells.size(), extent);
+
+		if (!cached) {
+			auto stop = std::chrono::high_resolution_clock::now();
+			std::cout << "loaded time step " << time_step << " with " << cells.size() << " cells in "
+				<< std::chrono::duration<double>(stop - start).count() << " s, " << frames.get_nr_frames() << " frames with "
+				<< frame_cache_memory << " MB cached" << std::endl;
+		}
+	}
+	/// replace the cells by the cells of the shown time step, which is read from disk if it was not read ahead
+	void show_ooc_time_step()
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		bool read_ahead = ooc->is_loaded(time_step);
+
+		std::unique_ptr<cell_snapshot> snapshot = ooc->take(time_step);
+		if (!snapshot)
+			return;
+
+		assign_lazy_time_step(*snapshot);
+		ooc->recycle(std::move(snapshot));
+
+		cells_ctr->set_cells(&cells, 0, cells.size(), extent);
+
+		if (!read_ahead) {
+			auto stop = std::chrono::high_resolution_clock::now();
+			std::cout << "read time step " << time_step << " with " << cells.size() << " cells in "
+				<< std::chrono::duration<double>(stop - start).count() << " s, " << frame_cache_memory << " MB read ahead" << std::endl;
+		}
+	}
 	void compute_visible_points()
 	{
+		// a prefetched time step only needs to be swapped in
+		std::unique_ptr<prepared_time_step> prepared = prefetch ? prefetcher->take(time_step) : nullptr;
+		if (prepared) {
+			if (prepared->snapshot)
+				assign_lazy_time_step(*prepared->snapshot);
+
+			cells_ctr->set_cells(&cells, prepared->cells);
+
+			// the snapshot holds the arrays of the previous time step now
+			if (ooc)
+				ooc->recycle(std::move(prepared->snapshot));
+			return;
+		}
+
+		if (ooc) {
+			show_ooc_time_step();
+			return;
+		}
+
+		if (lazy_dir) {
+			show_lazy_time_step();
+			return;
+		}
+
 		if (time_step_start.empty())
 			return;
 
@@ -1066,11 +1535,32 @@ public:
 
 		const cell_type& ct = std::next(cell::types.begin(), c.type)->second;
 
+		// history of the cell over all time steps, only known if all time steps are loaded
+		const std::vector<cell_trajectories::entry>& history = trajectories.get_entries(c.id);
+
 		std::ostringstream oss;
 		oss << " id " << cgv::utils::to_string(c.id) << "  \n type " << ct.name;
-		size_t index = c.properties_start_index;
-		for (const auto& p : ct.properties)
-			oss << "  \n " << p << " " << std::setprecision(1) << cell::properties[index];
+		std::vector<uint32_t> series_time_steps;
+		std::vector<float> series;
+		for (size_t pi = 0; pi < ct.properties.size(); ++pi) {
+			// the type is taken from the first snapshot that lists it, cells of other snapshots may have less properties
+			oss << "  \n " << ct.properties[pi] << " ";
+			if (pi < c.properties_end_index - c.properties_start_index)
+				oss << std::setprecision(1) << cell::properties[c.properties_start_index + pi];
+			else
+				oss << "-";
+			trajectories.get_property_series(c.id, pi, cells, series_time_steps, series);
+			if (series.size() > 1) {
+				auto range = std::minmax_element(series.begin(), series.end());
+				oss << " (" << *range.first << " - " << *range.second << ")";
+			}
+		}
+		if (!history.empty()) {
+			const cell& first = cells[history.front().cell_index];
+			oss << "  \n " << history.size() << " time steps, t " << std::setprecision(4) << times[history.front().time_step]
+				<< " - " << times[history.back().time_step];
+			oss << "  \n moved " << length(cell::centers[c.center_index] - cell::centers[first.center_index]);
+		}
 		oss << " ";
 
 		std::string s(oss.str());
@@ -0,0 +1,553 @@
+// Streaming pull parser for the XML written by Morpheus, not a general purpose XML parser
+//
+// The input is requested chunk by chunk from an xml_source. Tags are returned one at a time and their names and
+// attribute values point directly into the current input window, so neither a DOM nor temporary strings are built.
+// Only a token that crosses a chunk boundary is copied into a small buffer together with the beginning of the next
+// chunk. Tokens stay valid only until the next call into the scanner.
+//
+// Usage:
+// xml_file_source source(<file_name>);
+// xml_scanner scanner(source);
+// xml_scanner::tag t;
+//
+// while (scanner.next_tag(t))
+// {
+//    // process t.kind, t.name and t.get_attribute("...")
+// }
+
+#pragma once
+
+#include <cgv/utils/token.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+/// source of consecutive input chunks for the xml_scanner
+class xml_source
+{
+public:
+	virtual ~xml_source() {}
+	/// provide the next chunk of input, the chunk has to stay valid until the next call; return false at the end of input
+	virtual bool next_chunk(const char*& data, size_t& size) = 0;
+};
+
+/// chunk wise reader for uncompressed xml files
+class xml_file_source : public xml_source
+{
+	FILE* fp;
+	std::vector<char> buffer;
+public:
+	xml_file_source(const std::string& file_name, size_t chunk_size = 1 << 20) : buffer(chunk_size)
+	{
+		fp = fopen(file_name.c_str(), "rb");
+	}
+	~xml_file_source()
+	{
+		if (fp)
+			fclose(fp);
+	}
+	bool is_open() const
+	{
+		return fp != NULL;
+	}
+	bool next_chunk(const char*& data, size_t& size)
+	{
+		if (fp == NULL)
+			return false;
+
+		size = fread(&buffer[0], 1, buffer.size(), fp);
+		data = &buffer[0];
+
+		return size > 0;
+	}
+};
+
+/// xml files are mapped into memory window by window and parsed in place, only the current window is resident
+class xml_mapped_source : public xml_source
+{
+	mapped_file file;
+	uint64_t position = 0;
+	size_t window_size;
+public:
+	xml_mapped_source(const std::string& file_name, size_t _window_size = size_t(64) << 20) : window_size(_window_size)
+	{
+		file.open(file_name);
+	}
+	bool is_open() const
+	{
+		return file.is_open();
+	}
+	bool next_chunk(const char*& data, size_t& size)
+	{
+		if (position >= file.get_size()) {
+			file.unmap();
+			return false;
+		}
+
+		uint64_t rest = file.get_size() - position;
+		size = rest < window_size ? size_t(rest) : window_size;
+
+		data = file.map(position, size);
+		if (data == NULL)
+			return false;
+
+		position += size;
+		return true;
+	}
+};
+
+class xml_scanner
+{
+public:
+	enum tag_kind
+	{
+		TK_START,	// <name ...>
+		TK_END,		// </name>
+		TK_EMPTY	// <name .../>
+	};
+
+	struct attribute
+	{
+		cgv::utils::token name;
+		cgv::utils::token value;
+	};
+
+	struct tag
+	{
+		static const unsigned max_nr_attributes = 16;
+
+		tag_kind kind = TK_END;
+		cgv::utils::token name;
+		// position of the '<' in the input
+		uint64_t offset = 0;
+
+		// attributes beyond max_nr_attributes are ignored
+		attribute attributes[max_nr_attributes];
+		unsigned nr_attributes = 0;
+
+		/// return value of attribute with given name or an empty token
+		cgv::utils::token get_attribute(const char* attribute_name) const
+		{
+			for (unsigned i = 0; i < nr_attributes; ++i)
+				if (attributes[i].name == attribute_name)
+					return attributes[i].value;
+
+			return cgv::utils::token();
+		}
+	};
+
+private:
+	xml_source& source;
+
+	// current input window, starts out as an empty string so that it is always a valid range
+	const char* cur = "";
+	const char* end = cur;
+
+	// a token that crosses a chunk boundary is scanned in the buffer, which holds the unconsumed rest of the previous
+	// chunks (carry bytes) followed by the beginning of the current chunk (buffered bytes); scanning continues in the
+	// chunk itself as soon as the carried bytes are consumed
+	static const size_t min_buffered_size = 4096;
+	std::vector<char> buffer;
+	bool window_in_buffer = false;
+	size_t carry = 0;
+	size_t buffered = 0;
+
+	// current chunk of the source
+	const char* chunk = NULL;
+	size_t chunk_size = 0;
+
+	bool eof = false;
+	size_t nr_bytes = 0;
+
+	/// scan the buffer from consumed up to the end of the bytes copied from the chunk
+	void set_buffer_window(size_t consumed)
+	{
+		cur = &buffer[0] + consumed;
+		end = &buffer[0] + carry + buffered;
+		window_in_buffer = true;
+	}
+
+	/// extend the window behind its unconsumed part, return false at the end of input
+	bool fill()
+	{
+		if (window_in_buffer && buffered < chunk_size) {
+			size_t consumed = cur - &buffer[0];
+			if (consumed >= carry) {
+				// the carried bytes are consumed, so the rest of the window is part of the chunk
+				cur = chunk + (consumed - carry);
+				end = chunk + chunk_size;
+				window_in_buffer = false;
+				return true;
+			}
+
+			// the token still starts in the carried bytes, copy more of the chunk behind them
+			size_t count = std::min(chunk_size - buffered, std::max(buffered, size_t(min_buffered_size)));
+			buffer.resize(std::max(buffer.size(), carry + buffered + count));
+			memcpy(&buffer[carry + buffered], chunk + buffered, count);
+			buffered += count;
+			set_buffer_window(consumed);
+			return true;
+		}
+
+		if (eof)
+			return false;
+
+		size_t rest = end - cur;
+
+		// the chunk of the source might be overwritten by next_chunk, so move the rest into the buffer first
+		if (rest > 0) {
+			if (window_in_buffer)
+				memmove(&buffer[0], cur, rest);
+			else {
+				if (buffer.size() < rest)
+					buffer.resize(rest);
+				memcpy(&buffer[0], cur, rest);
+			}
+		}
+
+		carry = rest;
+		buffered = 0;
+		chunk = NULL;
+		chunk_size = 0;
+
+		const char* data;
+		size_t size;
+		if (!source.next_chunk(data, size)) {
+			eof = true;
+
+			if (rest > 0)
+				set_buffer_window(0);
+
+			return false;
+		}
+
+		nr_bytes += size;
+		chunk = data;
+		chunk_size = size;
+
+		if (rest == 0) {
+			// scan directly in the chunk of the source
+			cur = data;
+			end = data + size;
+			window_in_buffer = false;
+		}
+		else {
+			// only the beginning of the chunk is copied, which usually completes the token
+			buffered = std::min(size, std::max(rest, size_t(min_buffered_size)));
+			if (buffer.size() < rest + buffered)
+				buffer.resize(rest + buffered);
+			memcpy(&buffer[rest], data, buffered);
+			set_buffer_window(0);
+		}
+
+		return true;
+	}
+
+	/// make sure that at least count characters are available in the window
+	bool ensure(size_t count)
+	{
+		while (size_t(end - cur) < count)
+			if (!fill())
+				return false;
+
+		return true;
+	}
+
+	/// move behind the next occurrence of pattern
+	bool skip_past(const char* pattern)
+	{
+		size_t length = strlen(pattern);
+
+		for (;;) {
+			const char* p = cur;
+			while (end - p >= ptrdiff_t(length)) {
+				p = static_cast<const char*>(memchr(p, pattern[0], end - p - length + 1));
+				if (p == NULL)
+					break;
+
+				if (memcmp(p, pattern, length) == 0) {
+					cur = p + length;
+					return true;
+				}
+
+				++p;
+			}
+
+			// keep a possible partial match at the end of the window
+			if (size_t(end - cur) >= length)
+				cur = end - length + 1;
+
+			if (!fill())
+				return false;
+		}
+	}
+
+	/// return the position of the '>' that closes the tag starting at p, quoted attribute values are skipped
+	static const char* find_tag_end(const char* p, const char* e)
+	{
+		char quote = 0;
+		for (; p < e; ++p) {
+			if (quote) {
+				if (*p == quote)
+					quote = 0;
+			}
+			else if (*p == '"' || *p == '\'')
+				quote = *p;
+			else if (*p == '>')
+				return p;
+		}
+
+		return NULL;
+	}
+
+	static bool is_space(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	static bool is_name_end(char c)
+	{
+		return is_space(c) || c == '/' || c == '>' || c == '=';
+	}
+
+	/// split the tag in [p, e) with e pointing to the closing '>' into name and attributes
+	static void split_tag(const char* p, const char* e, tag& t)
+	{
+		t.nr_attributes = 0;
+
+		// skip '<'
+		++p;
+
+		if (*p == '/') {
+			t.kind = TK_END;
+			++p;
+		}
+		else {
+			t.kind = (e[-1] == '/') ? TK_EMPTY : TK_START;
+
+			if (t.kind == TK_EMPTY)
+				--e;
+		}
+
+		const char* name_begin = p;
+		while (p < e && !is_name_end(*p))
+			++p;
+
+		t.name = cgv::utils::token(name_begin, p);
+
+		while (p < e) {
+			while (p < e && is_space(*p))
+				++p;
+
+			const char* attr_name_begin = p;
+			while (p < e && !is_name_end(*p))
+				++p;
+
+			const char* attr_name_end = p;
+
+			while (p < e && is_space(*p))
+				++p;
+
+			if (p == e || *p != '=') {
+				// attribute without value or garbage, skip one character to guarantee progress
+				if (p < e && p == attr_name_begin)
+					++p;
+
+				continue;
+			}
+
+			++p;
+
+			while (p < e && is_space(*p))
+				++p;
+
+			if (p == e || (*p != '"' && *p != '\''))
+				continue;
+
+			char quote = *p++;
+
+			const char* value_begin = p;
+			while (p < e && *p != quote)
+				++p;
+
+			if (t.nr_attributes < tag::max_nr_attributes) {
+				attribute& a = t.attributes[t.nr_attributes++];
+				a.name = cgv::utils::token(attr_name_begin, attr_name_end);
+				a.value = cgv::utils::token(value_begin, p);
+			}
+
+			if (p < e)
+				++p;
+		}
+	}
+
+public:
+	xml_scanner() = delete;
+	xml_scanner(const xml_scanner&) = delete;
+
+	xml_scanner(xml_source& _source) : source(_source)
+	{
+	}
+
+	/// number of input bytes requested from the source so far
+	size_t get_nr_bytes() const
+	{
+		return nr_bytes;
+	}
+
+	/// position in the input up to which it is consumed
+	uint64_t get_offset() const
+	{
+		// the window ends at the last byte requested unless only the beginning of the chunk is in the buffer
+		uint64_t pending = window_in_buffer ? uint64_t(chunk_size - buffered) : 0;
+		return uint64_t(nr_bytes) - pending - uint64_t(end - cur);
+	}
+
+	/// move to the next start, end or empty element tag skipping text, comments, declarations and processing instructions
+	bool next_tag(tag& t)
+	{
+		for (;;) {
+			const char* lt = static_cast<const char*>(memchr(cur, '<', end - cur));
+			if (lt == NULL) {
+				cur = end;
+				if (!fill())
+					return false;
+
+				continue;
+			}
+
+			cur = lt;
+
+			if (!ensure(2))
+				return false;
+
+			if (cur[1] == '?') {
+				if (!skip_past("?>"))
+					return false;
+
+				continue;
+			}
+
+			if (cur[1] == '!') {
+				if (!ensure(4))
+					return false;
+
+				bool success;
+				if (memcmp(cur, "<!--", 4) == 0)
+					success = skip_past("-->");
+				else if (ensure(9) && memcmp(cur, "<![CDATA[", 9) == 0)
+					success = skip_past("]]>");
+				else
+					success = skip_past(">");
+
+				if (!success)
+					return false;
+
+				continue;
+			}
+
+			// make sure the complete tag is inside the window, tags are short so rescanning after a fill is cheap
+			const char* gt;
+			while ((gt = find_tag_end(cur + 1, end)) == NULL)
+				if (!fill())
+					return false;
+
+			split_tag(cur, gt, t);
+			t.offset = get_offset();
+
+			cur = gt + 1;
+
+			return true;
+		}
+	}
+
+	/// skip the content of a start tag including its end tag, does nothing for empty and end tags
+	bool skip_element(const tag& t)
+	{
+		if (t.kind != TK_START)
+			return true;
+
+		tag child;
+
+		size_t depth = 1;
+		while (next_tag(child)) {
+			if (child.kind == TK_START)
+				++depth;
+			else if (child.kind == TK_END && --depth == 0)
+				return true;
+		}
+
+		return false;
+	}
+
+	/// call handle for each child element of a start tag, handle returns false if it did not consume the child completely
+	template <typename F>
+	bool for_each_child(const tag& parent, F handle)
+	{
+		if (parent.kind != TK_START)
+			return true;
+
+		tag child;
+
+		while (next_tag(child)) {
+			if (child.kind == TK_END)
+				return true;
+
+			if (!handle(child) && !skip_element(child))
+				return false;
+		}
+
+		return false;
+	}
+
+	/// return the text up to the next tag in one piece, meant for short texts
+	bool read_text(cgv::utils::token& text)
+	{
+		size_t offset = 0;
+
+		for (;;) {
+			const char* lt = static_cast<const char*>(memchr(cur + offset, '<', end - cur - offset));
+			if (lt != NULL) {
+				text = cgv::utils::token(cur, lt);
+				cur = lt;
+				return true;
+			}
+
+			offset = end - cur;
+			if (!fill()) {
+				text = cgv::utils::token(cur, end);
+				cur = end;
+				return false;
+			}
+		}
+	}
+
+	/// stream the text up to the next tag in pieces to consume(begin, end, last), which returns the position up
+	/// to which it consumed the text; unconsumed characters are passed again together with the following input
+	template <typename F>
+	bool scan_text(F consume)
+	{
+		for (;;) {
+			const char* lt = static_cast<const char*>(memchr(cur, '<', end - cur));
+			if (lt != NULL) {
+				consume(cur, lt, true);
+				cur = lt;
+				return true;
+			}
+
+			cur = consume(cur, end, false);
+
+			if (!fill()) {
+				consume(cur, end, true);
+				cur = end;
+				return false;
+			}
+		}
+	}
+};